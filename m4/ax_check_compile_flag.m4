@@ -0,0 +1 @@
+../autoconf-archive/m4/ax_check_compile_flag.m4
\ No newline at end of file
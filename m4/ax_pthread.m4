@@ -0,0 +1 @@
+../autoconf-archive/m4/ax_pthread.m4
\ No newline at end of file
@@ -140,6 +140,39 @@ TEST_F(BitRingTest, Separation)
     EXPECT_EQ(mid-min, queryBitRingMemberSeparation(mBitRing, min-0));
 }
 
+/* -------------------------------------------------------------------------- */
+TEST_F(BitRingTest, Precedence)
+{
+    int min = queryBitRingMin(mBitRing);
+    int max = queryBitRingMax(mBitRing);
+    int mid = (min + max) / 2;
+
+    EXPECT_EQ(-1, queryBitRingMemberPrecedence(mBitRing, min-1));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_EQ(-1, queryBitRingMemberPrecedence(mBitRing, max+1));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(queryBitRingMemberPrecedence(mBitRing, mid));
+
+    EXPECT_FALSE(addBitRingMember(mBitRing, mid));
+
+    EXPECT_EQ(1, queryBitRingMemberPrecedence(mBitRing, mid+1));
+    EXPECT_EQ(max-min+1, queryBitRingMemberPrecedence(mBitRing, mid-0));
+    EXPECT_EQ(max-min, queryBitRingMemberPrecedence(mBitRing, mid-1));
+
+    EXPECT_FALSE(addBitRingMember(mBitRing, max));
+
+    EXPECT_EQ(max-mid, queryBitRingMemberPrecedence(mBitRing, max));
+    EXPECT_EQ(mid-min+1, queryBitRingMemberPrecedence(mBitRing, mid));
+    EXPECT_EQ(1, queryBitRingMemberPrecedence(mBitRing, min));
+
+    EXPECT_FALSE(addBitRingMember(mBitRing, min));
+
+    EXPECT_EQ(1, queryBitRingMemberPrecedence(mBitRing, min));
+    EXPECT_EQ(mid-min, queryBitRingMemberPrecedence(mBitRing, mid));
+}
+
 /* -------------------------------------------------------------------------- */
 TEST_F(BitRingTest, InitInvalid)
 {
@@ -232,6 +265,79 @@ TEST_F(BitRingTest, InitDuplicate)
     EXPECT_TRUE(queryBitRingMembership(mBitRing, 2));
 }
 
+/* -------------------------------------------------------------------------- */
+TEST_F(BitRingTest, InitHashInvalid)
+{
+    struct BitRingHash hash = { .mHash = 10, .mMax = 6 };
+
+    EXPECT_FALSE(initBitRing(mBitRing, 1, 7, "H"));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initBitRingHash(mBitRing, 1, 7, "HH", &hash));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initBitRingHash(mBitRing, 1, 7, "H(2-4", &hash));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initBitRingHash(mBitRing, 1, 7, "H(2)", &hash));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initBitRingHash(mBitRing, 1, 7, "H(4-2)", &hash));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initBitRingHash(mBitRing, 1, 7, "H(0-2)", &hash));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initBitRingHash(mBitRing, 1, 7, "H(2-8)", &hash));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initBitRingHash(mBitRing, 1, 7, "H/0", &hash));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initBitRingHash(mBitRing, 1, 7, "H-2", &hash));
+    EXPECT_EQ(EINVAL, errno);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(BitRingTest, InitHash)
+{
+    struct BitRingHash hash = { .mHash = 10, .mMax = 6 };
+
+    EXPECT_EQ(mBitRing, initBitRingHash(mBitRing, 1, 7, "H", &hash));
+    EXPECT_EQ(1U, queryBitRingPopulation(mBitRing));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 5));
+
+    EXPECT_EQ(mBitRing, initBitRingHash(mBitRing, 1, 7, "H(2-4)", &hash));
+    EXPECT_EQ(1U, queryBitRingPopulation(mBitRing));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 3));
+
+    EXPECT_EQ(mBitRing, initBitRingHash(mBitRing, 1, 7, "H/3", &hash));
+    EXPECT_EQ(2U, queryBitRingPopulation(mBitRing));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 2));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 5));
+
+    EXPECT_EQ(mBitRing, initBitRingHash(mBitRing, 1, 7, "H(1-7)/4", &hash));
+    EXPECT_EQ(2U, queryBitRingPopulation(mBitRing));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 3));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 7));
+
+    EXPECT_EQ(mBitRing, initBitRingHash(mBitRing, 1, 7, "H(6-7)/4", &hash));
+    EXPECT_EQ(1U, queryBitRingPopulation(mBitRing));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 6));
+
+    EXPECT_EQ(mBitRing, initBitRingHash(mBitRing, 1, 7, "1,H,7", &hash));
+    EXPECT_EQ(3U, queryBitRingPopulation(mBitRing));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 1));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 5));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 7));
+
+    hash.mHash = 11;
+
+    EXPECT_EQ(mBitRing, initBitRingHash(mBitRing, 1, 7, "H", &hash));
+    EXPECT_EQ(1U, queryBitRingPopulation(mBitRing));
+    EXPECT_TRUE(queryBitRingMembership(mBitRing, 6));
+}
+
 /* -------------------------------------------------------------------------- */
 
 #include "_test_.h"
@@ -287,8 +287,7 @@ TEST_F(CivilTimeTest, AdvanceTime)
     EXPECT_EQ(0, queryCivilTimeClock(civilTime).mHour);
     EXPECT_EQ(0, queryCivilTimeClock(civilTime).mMinute);
 
-    EXPECT_EQ(-1, advanceCivilTimeYear(civilTime, 2001));
-    EXPECT_EQ(EAGAIN, errno);
+    EXPECT_EQ(1, advanceCivilTimeYear(civilTime, 2001));
     /* Sun Apr  2 03:00:00 PDT 2000 */
     EXPECT_EQ(954669600, queryCivilTimeUtc(civilTime));
     EXPECT_EQ(2000, queryCivilTimeCalendar(civilTime).mYear);
@@ -298,8 +297,7 @@ TEST_F(CivilTimeTest, AdvanceTime)
     EXPECT_EQ(3-1, queryCivilTimeClock(civilTime).mHour);
     EXPECT_EQ(0, queryCivilTimeClock(civilTime).mMinute);
 
-    EXPECT_EQ(-1, advanceCivilTimeYear(civilTime, 2001));
-    EXPECT_EQ(EAGAIN, errno);
+    EXPECT_EQ(1, advanceCivilTimeYear(civilTime, 2001));
     /* Sun Apr  2 03:00:00 PDT 2000 */
     EXPECT_EQ(954669600, queryCivilTimeUtc(civilTime));
     EXPECT_EQ(2000, queryCivilTimeCalendar(civilTime).mYear);
@@ -309,8 +307,7 @@ TEST_F(CivilTimeTest, AdvanceTime)
     EXPECT_EQ(3-0, queryCivilTimeClock(civilTime).mHour);
     EXPECT_EQ(0, queryCivilTimeClock(civilTime).mMinute);
 
-    EXPECT_EQ(-1, advanceCivilTimeYear(civilTime, 2001));
-    EXPECT_EQ(EAGAIN, errno);
+    EXPECT_EQ(1, advanceCivilTimeYear(civilTime, 2001));
     /* Sun Oct 29 01:00:00 PST 2000 */
     EXPECT_EQ(972810000, queryCivilTimeUtc(civilTime));
     EXPECT_EQ(2000, queryCivilTimeCalendar(civilTime).mYear);
@@ -320,8 +317,7 @@ TEST_F(CivilTimeTest, AdvanceTime)
     EXPECT_EQ(0 - 1 - 1, queryCivilTimeClock(civilTime).mHour);
     EXPECT_EQ(0, queryCivilTimeClock(civilTime).mMinute);
 
-    EXPECT_EQ(-1, advanceCivilTimeYear(civilTime, 2001));
-    EXPECT_EQ(EAGAIN, errno);
+    EXPECT_EQ(1, advanceCivilTimeYear(civilTime, 2001));
     /* Sun Oct 29 02:00:00 PST 2000 */
     EXPECT_EQ(972813600, queryCivilTimeUtc(civilTime));
     EXPECT_EQ(2000, queryCivilTimeCalendar(civilTime).mYear);
@@ -342,6 +338,51 @@ TEST_F(CivilTimeTest, AdvanceTime)
     EXPECT_EQ(0, queryCivilTimeClock(civilTime).mMinute);
 }
 
+/* -------------------------------------------------------------------------- */
+TEST_F(CivilTimeTest, AdvanceSecond)
+{
+    static char TZ[] = "TZ=US/Pacific";
+
+    putenv(TZ);
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 949301880));
+    /* Sun Jan 30 22:58:00 PST 2000 */
+    EXPECT_EQ(0, queryCivilTimeClock(civilTime).mSecond);
+
+    EXPECT_FALSE(advanceCivilTimeSecond(civilTime, 15));
+    /* Sun Jan 30 22:58:15 PST 2000 */
+    EXPECT_EQ(949301880 + 15, queryCivilTimeUtc(civilTime));
+    EXPECT_EQ(58, queryCivilTimeClock(civilTime).mMinute);
+    EXPECT_EQ(15, queryCivilTimeClock(civilTime).mSecond);
+    EXPECT_EQ(15, queryCivilTimeWallClock(civilTime).mSecond);
+
+    EXPECT_EQ(-1, advanceCivilTimeSecond(civilTime, 15));
+    EXPECT_EQ(ERANGE, errno);
+
+    EXPECT_EQ(-1, advanceCivilTimeSecond(civilTime, 60));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(advanceCivilTimeSecond(civilTime, 59));
+    /* Sun Jan 30 22:58:59 PST 2000 */
+    EXPECT_EQ(949301880 + 59, queryCivilTimeUtc(civilTime));
+
+    /* Advancing a coarser field starts at the beginning of the minute. */
+
+    EXPECT_FALSE(advanceCivilTimeMinute(civilTime, 59));
+    /* Sun Jan 30 22:59:00 PST 2000 */
+    EXPECT_EQ(949301940, queryCivilTimeUtc(civilTime));
+    EXPECT_EQ(0, queryCivilTimeClock(civilTime).mSecond);
+
+    EXPECT_FALSE(advanceCivilTimeSecond(civilTime, 30));
+    EXPECT_FALSE(advanceCivilTimeHour(civilTime, 23));
+    /* Sun Jan 30 23:00:00 PST 2000 */
+    EXPECT_EQ(949302000, queryCivilTimeUtc(civilTime));
+    EXPECT_EQ(0, queryCivilTimeClock(civilTime).mMinute);
+    EXPECT_EQ(0, queryCivilTimeClock(civilTime).mSecond);
+}
+
 /* -------------------------------------------------------------------------- */
 TEST_F(CivilTimeTest, AdvanceTimeSpringDST)
 {
@@ -370,6 +411,23 @@ TEST_F(CivilTimeTest, AdvanceTimeSpringDST)
     EXPECT_EQ(Sunday, queryCivilTimeCalendar(civilTime).mWeekDay);
     EXPECT_EQ(3-1, queryCivilTimeClock(civilTime).mHour);
     EXPECT_EQ(1, queryCivilTimeClock(civilTime).mMinute);
+
+    /* The artificial time also reports the local time that applies. */
+
+    struct Calendar calendar;
+    struct Clock clock;
+
+    EXPECT_EQ(1, queryCivilTimeArtificial(civilTime, &calendar, &clock));
+    EXPECT_EQ(2000, calendar.mYear);
+    EXPECT_EQ(4, calendar.mMonth);
+    EXPECT_EQ(2, calendar.mDay);
+    EXPECT_EQ(Sunday, calendar.mWeekDay);
+    EXPECT_EQ(3, clock.mHour);
+    EXPECT_EQ(1, clock.mMinute);
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 954669600 + 3600));
+    /* Sun Apr  2 04:00:00 PDT 2000 */
+    EXPECT_EQ(0, queryCivilTimeArtificial(civilTime, &calendar, &clock));
 }
 
 /* -------------------------------------------------------------------------- */
@@ -400,6 +458,72 @@ TEST_F(CivilTimeTest, AdvanceTimeFallDST)
     EXPECT_EQ(Sunday, queryCivilTimeCalendar(civilTime).mWeekDay);
     EXPECT_EQ(0 - 1 - 1, queryCivilTimeClock(civilTime).mHour);
     EXPECT_EQ(1, queryCivilTimeClock(civilTime).mMinute);
+
+    /* Masked time is not artificial. */
+
+    struct Calendar calendar;
+    struct Clock clock;
+
+    EXPECT_EQ(0, queryCivilTimeArtificial(civilTime, &calendar, &clock));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(CivilTimeTest, InitSince)
+{
+    static char TZ[] = "TZ=US/Pacific";
+
+    putenv(TZ);
+
+    struct CivilTime since_, *since = &since_;
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+    struct CivilTime expected_, *expected = &expected_;
+
+    /* Civil times initialised from an earlier civil time match those
+     * initialised afresh, both within the same interval, and after the
+     * spring and fall daylight savings changes.
+     */
+
+    /* Wed Mar  1 00:00:00 PST 2000 */
+    /* Sun Apr  2 03:00:00 PDT 2000 */
+    /* Sun Oct 29 01:00:00 PST 2000 */
+    static const time_t Times[] = { 951897600, 954669600, 972810000 };
+
+    for (size_t tx = 0; tx < sizeof(Times)/sizeof(Times[0]); ++tx) {
+
+        EXPECT_EQ(since, initCivilTime(since, Times[tx]));
+
+        for (time_t ix = 0; ix < 300 * 24; ix += 7) {
+            time_t time = Times[tx] + ix * (60 * 60) + ix % 60 * 60;
+
+            EXPECT_EQ(civilTime, initCivilTimeSince(civilTime, time, since));
+            EXPECT_EQ(expected, initCivilTime(expected, time));
+
+            struct Calendar calendar = queryCivilTimeCalendar(civilTime);
+            struct Calendar expectedCalendar = queryCivilTimeCalendar(expected);
+
+            struct Clock clock = queryCivilTimeClock(civilTime);
+            struct Clock expectedClock = queryCivilTimeClock(expected);
+
+            EXPECT_EQ(
+                queryCivilTimeUtc(expected),
+                queryCivilTimeUtc(civilTime)) << time;
+            EXPECT_EQ(
+                queryCivilTimeTransition(expected),
+                queryCivilTimeTransition(civilTime)) << time;
+            EXPECT_EQ(expectedCalendar.mYear, calendar.mYear) << time;
+            EXPECT_EQ(expectedCalendar.mMonth, calendar.mMonth) << time;
+            EXPECT_EQ(expectedCalendar.mDay, calendar.mDay) << time;
+            EXPECT_EQ(expectedCalendar.mWeekDay, calendar.mWeekDay) << time;
+            EXPECT_EQ(expectedClock.mHour, clock.mHour) << time;
+            EXPECT_EQ(expectedClock.mMinute, clock.mMinute) << time;
+        }
+    }
+
+    EXPECT_EQ(since, initCivilTime(since, Times[0]));
+
+    errno = 0;
+    EXPECT_FALSE(initCivilTimeSince(civilTime, Times[0] + 1, since));
+    EXPECT_EQ(EINVAL, errno);
 }
 
 /* -------------------------------------------------------------------------- */
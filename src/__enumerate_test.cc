@@ -0,0 +1,229 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "enumerate.h"
+
+#include "civiltime.h"
+#include "schedule.h"
+
+#include "gtest/gtest.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <vector>
+
+/* -------------------------------------------------------------------------- */
+class EnumerateTest : public ::testing::Test
+{
+    void SetUp()
+    {
+        static char TZ[] = "TZ=US/Pacific";
+
+        putenv(TZ);
+    }
+
+protected:
+
+    std::vector<time_t> iterateSchedule_(
+        const struct Schedule *aSchedule, time_t aSince, time_t aUntil) {
+
+        std::vector<time_t> occurrences;
+
+        struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+        struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+        if (initCivilTime(civilTime, aSince) &&
+                initScheduleIterator(iterator, aSchedule, civilTime)) {
+
+            while (1) {
+                time_t scheduled = nextScheduleOccurrence(iterator);
+                if (-1 == scheduled || scheduled >= aUntil)
+                    break;
+                occurrences.push_back(scheduled);
+            }
+        }
+
+        return occurrences;
+    }
+
+    std::vector<time_t> enumerateSchedule_(
+        const struct Schedule *aSchedule,
+        time_t aSince,
+        time_t aUntil,
+        unsigned aWorkers) {
+
+        std::vector<time_t> occurrences;
+
+        struct ScheduleEnumeration enumeration_, *enumeration = &enumeration_;
+
+        if (initScheduleEnumeration(
+                enumeration, aSchedule, aSince, aUntil, aWorkers)) {
+
+            occurrences.assign(
+                enumeration->mOccurrences,
+                enumeration->mOccurrences + enumeration->mLength);
+
+            closeScheduleEnumeration(enumeration);
+        }
+
+        return occurrences;
+    }
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(EnumerateTest, Arguments)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct ScheduleEnumeration enumeration_, *enumeration = &enumeration_;
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "* * * * *"));
+
+    errno = 0;
+    EXPECT_FALSE(initScheduleEnumeration(
+        enumeration, schedule, 946713601, 946713660, 1));
+    EXPECT_EQ(EINVAL, errno);
+
+    errno = 0;
+    EXPECT_FALSE(initScheduleEnumeration(
+        enumeration, schedule, 946713660, 946713600, 1));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_EQ(enumeration, initScheduleEnumeration(
+        enumeration, schedule, 946713600, 946713600, 1));
+    EXPECT_EQ(0u, enumeration->mLength);
+    closeScheduleEnumeration(enumeration);
+
+    EXPECT_EQ(enumeration, initScheduleEnumeration(
+        enumeration, schedule, 946713600, 946713660, 4));
+    EXPECT_EQ(1u, enumeration->mLength);
+    EXPECT_EQ(946713600, enumeration->mOccurrences[0]);
+    closeScheduleEnumeration(enumeration);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(EnumerateTest, Year)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    time_t since = 946713600;
+
+    /* Mon Jan  1 00:00:00 PST 2001 */
+    time_t until = 978336000;
+
+    /* Months start at the chunk boundaries, the spring daylight savings
+     * change skips 02:00 to 02:59 on Apr 2, and the fall daylight savings
+     * change repeats 01:00 to 01:59 on Oct 29.
+     */
+
+    static const struct {
+        const char *mSchedule;
+        size_t mLength;
+    } Schedules[] = {
+        { "0 0 1 * *",           12 },
+        { "30 1 * * *",          366 },
+        { "30 2 * * *",          366 },
+        { "*/20 1-2 * * *",      366 * 6 },
+        { "*/7 0-3 1,2,29,30 * *", 0 },
+        { "1 1-22 2-28 2-11 *",  0 },
+    };
+
+    for (size_t sx = 0; sx < sizeof(Schedules)/sizeof(Schedules[0]); ++sx) {
+
+        if (!initSchedule(schedule, Schedules[sx].mSchedule))
+            continue;
+
+        std::vector<time_t> expected =
+            iterateSchedule_(schedule, since, until);
+
+        if (Schedules[sx].mLength)
+            EXPECT_EQ(Schedules[sx].mLength, expected.size())
+                << Schedules[sx].mSchedule;
+
+        EXPECT_EQ(expected, enumerateSchedule_(schedule, since, until, 1))
+            << Schedules[sx].mSchedule;
+        EXPECT_EQ(expected, enumerateSchedule_(schedule, since, until, 4))
+            << Schedules[sx].mSchedule;
+        EXPECT_EQ(expected, enumerateSchedule_(schedule, since, until, 16))
+            << Schedules[sx].mSchedule;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(EnumerateTest, Seams)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    /* Split the enumeration at each minute across the fall daylight
+     * savings change, including within the repeated hour, and check
+     * that the occurrences on either side are neither duplicated nor
+     * dropped.
+     */
+
+    /* Sun Oct 29 00:00:00 PDT 2000 */
+    time_t since = 972802800;
+
+    /* Sun Oct 29 04:00:00 PST 2000 */
+    time_t until = 972820800;
+
+    static const char *Schedules[] = {
+        "*/10 * * * *",
+        "*/10 1 * * *",
+        "0,30 0-3 * * *",
+    };
+
+    for (size_t sx = 0; sx < sizeof(Schedules)/sizeof(Schedules[0]); ++sx) {
+
+        EXPECT_EQ(schedule, initSchedule(schedule, Schedules[sx]));
+
+        std::vector<time_t> expected =
+            iterateSchedule_(schedule, since, until);
+
+        for (time_t seam = since; seam <= until; seam += 60) {
+            std::vector<time_t> occurrences =
+                enumerateSchedule_(schedule, since, seam, 1);
+
+            std::vector<time_t> remaining =
+                enumerateSchedule_(schedule, seam, until, 1);
+
+            occurrences.insert(
+                occurrences.end(), remaining.begin(), remaining.end());
+
+            EXPECT_EQ(expected, occurrences)
+                << Schedules[sx] << " " << seam;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
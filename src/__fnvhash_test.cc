@@ -0,0 +1,66 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "fnvhash.h"
+
+#include "gtest/gtest.h"
+
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+TEST(FnvHashTest, Vectors)
+{
+    /* Published FNV-1a test vectors, which fix the hash stored in
+     * schedule caches.
+     */
+
+    EXPECT_EQ(FNV_OFFSET_BASIS, queryFnvHash(FNV_OFFSET_BASIS, "", 0));
+    EXPECT_EQ(UINT64_C(0xaf63dc4c8601ec8c),
+              queryFnvHash(FNV_OFFSET_BASIS, "a", 1));
+    EXPECT_EQ(UINT64_C(0x85944171f73967e8),
+              queryFnvHash(FNV_OFFSET_BASIS, "foobar", 6));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST(FnvHashTest, Concatenation)
+{
+    static const char Text[] = "0 * * * * hourly";
+
+    uint64_t whole = queryFnvHash(FNV_OFFSET_BASIS, Text, strlen(Text));
+
+    for (size_t ix = 0; ix <= strlen(Text); ++ix) {
+        uint64_t hash = queryFnvHash(FNV_OFFSET_BASIS, Text, ix);
+
+        EXPECT_EQ(whole, queryFnvHash(hash, Text + ix, strlen(Text) - ix));
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
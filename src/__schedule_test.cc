@@ -30,11 +30,16 @@
 #include "schedule.h"
 
 #include "civiltime.h"
+#include "macros.h"
 
 #include "gtest/gtest.h"
 
 #include <errno.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #ifndef RUNNING_ON_VALGRIND
 #include <valgrind/valgrind.h>
@@ -56,7 +61,8 @@ protected:
         struct Schedule *aSchedule,
         time_t aTime,
         time_t aJitterPeriod = 0,
-        int *aJitter = 0) {
+        int *aJitter = 0,
+        time_t aHorizon = 0) {
 
         int rc = -1;
 
@@ -67,7 +73,8 @@ protected:
         if (!initCivilTime(civilTime, aTime))
             goto Finally;
 
-        scheduled = querySchedule(aSchedule, civilTime, aJitterPeriod, aJitter);
+        scheduled = querySchedule(
+            aSchedule, civilTime, aHorizon, aJitterPeriod, aJitter);
         if (-1 == scheduled)
             goto Finally;
 
@@ -94,6 +101,29 @@ TEST_F(ScheduleTest, Fields)
     EXPECT_EQ(EINVAL, errno);
 
     EXPECT_TRUE(initSchedule(schedule, "* * * * *"));
+
+    EXPECT_FALSE(initSchedule(schedule, " * * * * * *"));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initSchedule(schedule, "* * * * * * * *"));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initSchedule(schedule, "60 * * * * *"));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_TRUE(initSchedule(schedule, "* * * * * *"));
+
+    EXPECT_FALSE(initSchedule(schedule, "0 * * * * * 1969"));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initSchedule(schedule, "0 * * * * * 2000-2064"));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initSchedule(schedule, "0 * * * * * */2"));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_TRUE(initSchedule(schedule, "* * * * * * *"));
+    EXPECT_TRUE(initSchedule(schedule, "0 * * * * * 2000-2063"));
 }
 
 /* -------------------------------------------------------------------------- */
@@ -147,6 +177,82 @@ TEST_F(ScheduleTest, SpillOver)
     EXPECT_EQ(981104460, testSchedule_(schedule, 975481140));
 }
 
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, WeekDays)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    /* Mon Jan  3 00:00:00 PST 2000 */
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 * * 1"));
+    EXPECT_EQ(946886400, testSchedule_(schedule, 946713600));
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    /* Mon Jan  3 00:00:00 PST 2000 */
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 * * 1-5"));
+    EXPECT_EQ(946886400, testSchedule_(schedule, 946713600));
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    /* Sun Jan  2 00:00:00 PST 2000 */
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 * * 7"));
+    EXPECT_EQ(946800000, testSchedule_(schedule, 946713600));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Shapes)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "* * * * *"));
+    EXPECT_EQ(ScheduleShapeMinutes, schedule->mShape);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "*/5 * * * *"));
+    EXPECT_EQ(ScheduleShapeMinutes, schedule->mShape);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 * * * *"));
+    EXPECT_EQ(ScheduleShapeMinutes, schedule->mShape);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 2 * * *"));
+    EXPECT_EQ(ScheduleShapeHours, schedule->mShape);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 2 * * 0"));
+    EXPECT_EQ(ScheduleShapeWeekDays, schedule->mShape);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 2 1 * *"));
+    EXPECT_EQ(ScheduleShapeGeneral, schedule->mShape);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 2 * 4 *"));
+    EXPECT_EQ(ScheduleShapeGeneral, schedule->mShape);
+
+    /* Verify that schedules that would be computed directly are
+     * deferred to the search when a daylight savings change intervenes.
+     */
+
+    /* Sat Apr  1 12:00:00 PST 2000 */
+    /* Sun Apr  2 02:30:00 PDT 2000 Artificial */
+    /* Sun Apr  2 03:30:00 PDT 2000 */
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 2 * * *"));
+    EXPECT_EQ(954671400, testSchedule_(schedule, 954619200));
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 2 * * 0"));
+    EXPECT_EQ(954671400, testSchedule_(schedule, 954619200));
+
+    /* Sat Oct 28 12:00:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PDT 2000 */
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 1 * * *"));
+    EXPECT_EQ(972808200, testSchedule_(schedule, 972759600));
+
+    /* Sun Oct 29 01:31:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PST 2000 Skipped */
+    /* Mon Oct 30 01:30:00 PST 2000 */
+    EXPECT_EQ(972898200, testSchedule_(schedule, 972808260));
+
+    /* Sun Oct 29 01:31:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PST 2000 Not Skipped */
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 * * * *"));
+    EXPECT_EQ(972811800, testSchedule_(schedule, 972808260));
+}
+
 /* -------------------------------------------------------------------------- */
 TEST_F(ScheduleTest, SpringDST_0200)
 {
@@ -430,146 +536,1891 @@ TEST_F(ScheduleTest, FallDST)
 }
 
 /* -------------------------------------------------------------------------- */
-TEST_F(ScheduleTest, OneSidedJitter_1_Hour)
+TEST_F(ScheduleTest, Iterator)
 {
     struct Schedule schedule_, *schedule = &schedule_;
 
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    struct ScheduleIterator iterator_, *iterator = &iterator_;
+
     EXPECT_EQ(schedule, initSchedule(schedule, "0 * * * *"));
 
-    time_t now, deadline, scheduled;
+    /* Sun Oct 29 00:01:00 PDT 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 972802860));
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
 
-    /* Sat Jan  1 00:00:00 PST 2000 */
-    now = 946713600;
+    /* Sun Oct 29 01:00:00 PDT 2000 */
+    /* Sun Oct 29 01:00:00 PST 2000 Not Skipped */
+    /* Sun Oct 29 02:00:00 PST 2000 */
+    /* Sun Oct 29 03:00:00 PST 2000 */
+    EXPECT_EQ(972806400, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(972810000, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(972813600, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(972817200, nextScheduleOccurrence(iterator));
 
-    time_t jitterPeriod = 5 * 60; /* 5 minute limit */
+    EXPECT_EQ(schedule, initSchedule(schedule, "0,30 1,2,3 29 10 *"));
 
-    int sum = 0;
-    int sumsq = 0;
-    int trials = RUNNING_ON_VALGRIND ? 1 : 1000;
+    /* Sat Jul  1 22:59:00 PDT 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 962517480+60));
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
 
-    for (int ix = 0; ix < trials; ++ix) {
-        int jitter;
-        deadline = testSchedule_(schedule, now, jitterPeriod, &jitter);
-        scheduled = testSchedule_(schedule, now, 0);
-        EXPECT_LE(now, deadline);
-        EXPECT_EQ(deadline - jitter, scheduled);
+    /* Sun Oct 29 01:00:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PDT 2000 */
+    /* Sun Oct 29 01:00:00 PST 2000 Skipped */
+    /* Sun Oct 29 01:30:00 PST 2000 Skipped */
+    /* Sun Oct 29 02:00:00 PST 2000 */
+    /* Sun Oct 29 02:30:00 PST 2000 */
+    /* Sun Oct 29 03:00:00 PST 2000 */
+    /* Sun Oct 29 03:30:00 PST 2000 */
+    /* Mon Oct 29 01:00:00 PDT 2001 */
+    EXPECT_EQ(972806400, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(972808200, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(972813600, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(972815400, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(972817200, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(972819000, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(1004346000, nextScheduleOccurrence(iterator));
 
-        int delay = deadline - now;
+    EXPECT_EQ(schedule, initSchedule(schedule, "0,30 1,2,3 1,2 4,5 *"));
 
-        sum += delay;
-        sumsq += delay * delay;
-    }
+    /* Sun Apr  2 01:01:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 954666000+60));
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
 
-    if (!RUNNING_ON_VALGRIND) {
-        int observedPeriod = 5 * 60;
+    /* Sun Apr  2 01:30:00 PST 2000 */
+    /* Sun Apr  2 02:00:00 PDT 2000 Artificial */
+    /* Sun Apr  2 03:00:00 PDT 2000 */
+    /* Sun Apr  2 03:30:00 PDT 2000 */
+    /* Mon May  1 01:00:00 PDT 2000 */
+    EXPECT_EQ(954667800, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(954669600, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(954671400, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(957168000, nextScheduleOccurrence(iterator));
+}
 
-        int mean = sum / trials;
-        int var = sumsq / trials - mean * mean;
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Steps)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
 
-        int jitterPeriodStdDev = observedPeriod / 4.24264; /* sqrt(18) */
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
 
-        EXPECT_LE((jitterPeriodStdDev-2) * (jitterPeriodStdDev-2), var);
-        EXPECT_GE((jitterPeriodStdDev+2) * (jitterPeriodStdDev+2), var);
+    struct ScheduleIterator iterator_, *iterator = &iterator_;
 
-        EXPECT_LE(observedPeriod / 3 - 3, mean);
-        EXPECT_GE(observedPeriod / 3 + 3, mean);
-    }
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
+
+    /* Schedules that are computed directly do not search. */
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 * * * *"));
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
+    EXPECT_EQ(946713600, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(0u, iterator->mSteps);
+
+    /* Each field is checked once if the schedule matches immediately. */
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 1 1 *"));
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
+    EXPECT_EQ(946713600, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(4u, iterator->mSteps);
+
+    /* Each field is checked, advanced, and checked again. */
+
+    /* Wed Feb  2 01:01:00 PST 2000 */
+    EXPECT_EQ(schedule, initSchedule(schedule, "1 1-22 2-28 2-11 *"));
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
+    EXPECT_EQ(949482060, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(8u, iterator->mSteps);
+
+    /* Resuming steps past the minute, and carries into the hour. */
+
+    /* Wed Feb  2 02:01:00 PST 2000 */
+    EXPECT_EQ(949485660, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(8u + 8u, iterator->mSteps);
 }
 
 /* -------------------------------------------------------------------------- */
-TEST_F(ScheduleTest, OneSidedJitter_3_Minutes)
+TEST_F(ScheduleTest, Horizon)
 {
     struct Schedule schedule_, *schedule = &schedule_;
 
-    EXPECT_EQ(schedule, initSchedule(schedule, "*/3 * * * *"));
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
 
-    time_t now, deadline, scheduled;
+    struct ScheduleIterator iterator_, *iterator = &iterator_;
 
     /* Sat Jan  1 00:00:00 PST 2000 */
-    now = 946713600;
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
 
-    time_t jitterPeriod = 3 * 60;
+    /* Wed Feb  2 01:01:00 PST 2000 */
+    EXPECT_EQ(schedule, initSchedule(schedule, "1 1-22 2-28 2-11 *"));
 
-    int sum = 0;
-    int sumsq = 0;
-    int trials = RUNNING_ON_VALGRIND ? 1 : 1000;
+    EXPECT_EQ(949482060, testSchedule_(
+        schedule, 946713600, 0, 0, 949482060 - 946713600));
 
-    for (int ix = 0; ix < trials; ++ix) {
-        int jitter;
-        deadline = testSchedule_(schedule, now, jitterPeriod, &jitter);
-        scheduled = testSchedule_(schedule, now, 0);
-        EXPECT_LE(now, deadline);
-        EXPECT_EQ(deadline - jitter, scheduled);
+    errno = 0;
+    EXPECT_EQ(-1, testSchedule_(
+        schedule, 946713600, 0, 0, 949482060 - 946713600 - 60));
+    EXPECT_EQ(ENOENT, errno);
 
-        int delay = deadline - now;
+    /* The step limit is exhausted before the occurrence is found. */
 
-        sum += delay;
-        sumsq += delay * delay;
-    }
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
+    EXPECT_EQ(iterator, limitScheduleIterator(iterator, 0, 7));
+    errno = 0;
+    EXPECT_EQ(-1, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(ETIMEDOUT, errno);
 
-    if (!RUNNING_ON_VALGRIND) {
-        int observedPeriod = 3 * 60 / 2;
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
+    EXPECT_EQ(iterator, limitScheduleIterator(iterator, 0, 8));
+    EXPECT_EQ(949482060, nextScheduleOccurrence(iterator));
 
-        sum = trials * observedPeriod / 3;
+    /* Schedules that are computed directly also observe the horizon. */
 
-        int mean = sum / trials;
-        int var = sumsq / trials - mean * mean;
+    /* Sat Jan  1 01:00:00 PST 2000 */
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 * * * *"));
 
-        int jitterPeriodStdDev = observedPeriod / 4.24264; /* sqrt(18) */
+    EXPECT_EQ(946717200, testSchedule_(schedule, 946713660, 0, 0, 3540));
 
-        EXPECT_LE((jitterPeriodStdDev-3) * (jitterPeriodStdDev-3), var);
-        EXPECT_GE((jitterPeriodStdDev+3) * (jitterPeriodStdDev+3), var);
+    errno = 0;
+    EXPECT_EQ(-1, testSchedule_(schedule, 946713660, 0, 0, 3480));
+    EXPECT_EQ(ENOENT, errno);
 
-        EXPECT_LE(observedPeriod / 3 - 2, mean);
-        EXPECT_GE(observedPeriod / 3 + 2, mean);
-    }
+    /* Schedules that never occur terminate at the horizon. */
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 30 2 *"));
+
+    errno = 0;
+    EXPECT_EQ(-1, testSchedule_(schedule, 946713600, 0, 0, 366 * 86400));
+    EXPECT_EQ(ENOENT, errno);
+
+    /* The horizon does not affect the jitter. */
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 * * * *"));
+
+    int jitter = INT_MIN;
+    time_t deadline = testSchedule_(
+        schedule, 946713660, 5 * 60, &jitter, 3540);
+    EXPECT_EQ(946717200, deadline - jitter);
+    EXPECT_GE(5 * 60, abs(jitter));
 }
 
 /* -------------------------------------------------------------------------- */
-TEST_F(ScheduleTest, TwoSidedJitter_1_Minute)
+TEST_F(ScheduleTest, Match)
 {
     struct Schedule schedule_, *schedule = &schedule_;
 
-    EXPECT_EQ(schedule, initSchedule(schedule, "*/3 * * * *"));
+    struct Schedule hourly_, *hourly = &hourly_;
 
-    time_t now, deadline, scheduled;
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
 
-    /* Sat Jan  1 00:02:00 PST 2000 */
-    now = 946713600 + 2 * 60;
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 1 * * *"));
+    EXPECT_EQ(hourly, initSchedule(hourly, "30 * * * *"));
 
-    time_t jitterPeriod = 3 * 60;
+    /* Sun Oct 29 01:30:00 PDT 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 972808200));
+    EXPECT_TRUE(matchSchedule(schedule, civilTime));
+    EXPECT_TRUE(matchSchedule(hourly, civilTime));
 
-    int sum = 0;
-    int sumsq = 0;
-    int trials = RUNNING_ON_VALGRIND ? 1 : 1000;
+    /* Sun Oct 29 01:31:00 PDT 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 972808260));
+    EXPECT_FALSE(matchSchedule(schedule, civilTime));
+    EXPECT_FALSE(matchSchedule(hourly, civilTime));
 
-    for (int ix = 0; ix < trials; ++ix) {
-        int jitter;
-        deadline = testSchedule_(schedule, now, jitterPeriod, &jitter);
-        scheduled = testSchedule_(schedule, now, 0);
-        EXPECT_LE(now, deadline);
-        EXPECT_EQ(deadline - jitter, scheduled);
+    /* Sun Oct 29 01:30:00 PST 2000 Repeated */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 972811800));
+    EXPECT_FALSE(matchSchedule(schedule, civilTime));
+    EXPECT_TRUE(matchSchedule(hourly, civilTime));
 
-        int delay = deadline - now;
+    /* The skipped hour is matched both as the artificial 02:00, and as
+     * the local 03:00 that actually applies, as for the search.
+     */
 
-        sum += delay;
-        sumsq += delay * delay;
+    static const char *Skipped[] = { "0 2 * * *", "0 3 * * *" };
+
+    for (size_t sx = 0; sx < sizeof(Skipped)/sizeof(Skipped[0]); ++sx) {
+
+        EXPECT_EQ(schedule, initSchedule(schedule, Skipped[sx]));
+
+        /* Sun Apr  1 03:00:00 PDT 2001 */
+        time_t skipped = 986119200;
+        int match = -1;
+
+        EXPECT_EQ(skipped, testSchedule_(schedule, skipped - 60));
+
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, skipped));
+        EXPECT_TRUE(matchSchedule(schedule, civilTime)) << Skipped[sx];
+
+        EXPECT_EQ(0, matchScheduleTimes(schedule, &skipped, 1, &match));
+        EXPECT_TRUE(match) << Skipped[sx];
+
+        /* Sun Apr  1 04:00:00 PDT 2001 */
+        time_t after = skipped + 3600;
+
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, after));
+        EXPECT_FALSE(matchSchedule(schedule, civilTime)) << Skipped[sx];
+
+        EXPECT_EQ(0, matchScheduleTimes(schedule, &after, 1, &match));
+        EXPECT_FALSE(match) << Skipped[sx];
     }
 
-    if (!RUNNING_ON_VALGRIND) {
-        int observedPeriod = 1 * 60;
+    /* Each minute across the spring and fall daylight savings changes
+     * matches exactly when the schedule is next scheduled at that minute.
+     */
 
-        int mean = sum / trials;
-        int var = sumsq / trials - mean * mean;
+    static const char *Schedules[] = {
+        "30 1 * * *",
+        "30 2 * * *",
+        "*/15 * * * *",
+        "0,30 1,2,3 * * 0",
+        "0 3 * * *",
+        "30 3 * * *",
+    };
 
-        int jitterPeriodStdDev = observedPeriod / 2.44949; /* sqrt(6) */
+    /* Sat Apr  1 22:00:00 PST 2000 */
+    /* Sat Oct 28 22:00:00 PDT 2000 */
+    static const time_t Times[] = { 954655200, 972795600 };
 
-        EXPECT_LE((jitterPeriodStdDev-3) * (jitterPeriodStdDev-3), var);
-        EXPECT_GE((jitterPeriodStdDev+3) * (jitterPeriodStdDev+3), var);
+    for (size_t sx = 0; sx < sizeof(Schedules)/sizeof(Schedules[0]); ++sx) {
 
-        EXPECT_LE(observedPeriod - 4, mean);
-        EXPECT_GE(observedPeriod + 4, mean);
+        EXPECT_EQ(schedule, initSchedule(schedule, Schedules[sx]));
+
+        for (size_t tx = 0; tx < sizeof(Times)/sizeof(Times[0]); ++tx) {
+
+            time_t times[8 * 60];
+            int matches[8 * 60];
+
+            for (size_t ix = 0; ix < sizeof(times)/sizeof(times[0]); ++ix)
+                times[ix] = Times[tx] + 60 * ix;
+
+            EXPECT_EQ(0, matchScheduleTimes(
+                schedule, times, sizeof(times)/sizeof(times[0]), matches));
+
+            for (size_t ix = 0; ix < sizeof(times)/sizeof(times[0]); ++ix) {
+
+                EXPECT_EQ(civilTime, initCivilTime(civilTime, times[ix]));
+
+                int scheduled = times[ix] == testSchedule_(schedule, times[ix]);
+
+                EXPECT_EQ(scheduled, matchSchedule(schedule, civilTime))
+                    << Schedules[sx] << " " << times[ix];
+                EXPECT_EQ(scheduled, matches[ix])
+                    << Schedules[sx] << " " << times[ix];
+            }
+        }
+    }
+
+    time_t unaligned = 972808201;
+    int match;
+
+    errno = 0;
+    EXPECT_EQ(-1, matchScheduleTimes(schedule, &unaligned, 1, &match));
+    EXPECT_EQ(EINVAL, errno);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Fingerprint)
+{
+    static const char *Equivalent[][2] = {
+        { "*/15 * * * *", "0,15,30,45 * * * *" },
+        { "0-59/15 * * * *", "45,30,15,0 * * * *" },
+        { "0 0 * * 7", "0 0 * * 0" },
+        { "0 0 * * 0-7", "0 0 * * 0-6" },
+        { "0 9-17 * * 1-5", "0 9,10,11,12,13,14,15,16,17 * * 1,2,3,4,5" },
+        { "* * * * *", "* * * * *" },
+    };
+
+    static const char *Distinct[][2] = {
+        { "* * * * *", "*/1 * * * *" },
+        { "* * * * *", "0-59 * * * *" },
+        { "0 * * * *", "0 0-23 * * *" },
+        { "0 0 * * *", "0 0 1-31 * *" },
+        { "0 0 * * *", "0 0 * 1-12 *" },
+        { "0 0 * * *", "0 0 * * 0-6" },
+        { "1 0 * * *", "0 1 * * *" },
+        { "0 0 1 * *", "0 0 * 1 *" },
+        { "0 0 1 * *", "0 0 * * 1" },
+    };
+
+    struct Schedule lhs_, *lhs = &lhs_;
+    struct Schedule rhs_, *rhs = &rhs_;
+
+    struct ScheduleFingerprint lhsPrint, rhsPrint;
+
+    for (size_t ix = 0; ix < sizeof(Equivalent)/sizeof(Equivalent[0]); ++ix) {
+        EXPECT_EQ(lhs, initSchedule(lhs, Equivalent[ix][0]));
+        EXPECT_EQ(rhs, initSchedule(rhs, Equivalent[ix][1]));
+
+        EXPECT_EQ(&lhsPrint, queryScheduleFingerprint(lhs, &lhsPrint));
+        EXPECT_EQ(&rhsPrint, queryScheduleFingerprint(rhs, &rhsPrint));
+
+        EXPECT_EQ(0, compareScheduleFingerprints(&lhsPrint, &rhsPrint))
+            << Equivalent[ix][0] << " " << Equivalent[ix][1];
+    }
+
+    for (size_t ix = 0; ix < sizeof(Distinct)/sizeof(Distinct[0]); ++ix) {
+        EXPECT_EQ(lhs, initSchedule(lhs, Distinct[ix][0]));
+        EXPECT_EQ(rhs, initSchedule(rhs, Distinct[ix][1]));
+
+        EXPECT_EQ(&lhsPrint, queryScheduleFingerprint(lhs, &lhsPrint));
+        EXPECT_EQ(&rhsPrint, queryScheduleFingerprint(rhs, &rhsPrint));
+
+        int order = compareScheduleFingerprints(&lhsPrint, &rhsPrint);
+
+        EXPECT_NE(0, order)
+            << Distinct[ix][0] << " " << Distinct[ix][1];
+        EXPECT_EQ(-order, compareScheduleFingerprints(&rhsPrint, &lhsPrint));
+    }
+
+    /* The optional sections are told apart by their tags, and not only
+     * by their content, so seconds that happen to encode the same words
+     * as an excluded date do not collide.
+     */
+
+    struct ScheduleExclusion exclusion_, *exclusion = &exclusion_;
+
+    EXPECT_EQ(exclusion, initScheduleExclusion(exclusion));
+    EXPECT_EQ(0, addScheduleExclusionDates(exclusion, "2000-01-01"));
+
+    EXPECT_EQ(lhs, initSchedule(lhs, "1,2,38,39,40,42,43,44,46 * * * * *"));
+    EXPECT_EQ(rhs, initSchedule(rhs, "* * * * *"));
+    EXPECT_EQ(rhs, excludeSchedule(rhs, exclusion));
+
+    EXPECT_EQ(&lhsPrint, queryScheduleFingerprint(lhs, &lhsPrint));
+    EXPECT_EQ(&rhsPrint, queryScheduleFingerprint(rhs, &rhsPrint));
+
+    EXPECT_NE(0, compareScheduleFingerprints(&lhsPrint, &rhsPrint));
+
+    closeScheduleExclusion(exclusion);
+
+    /* Every single member schedule for each field is distinct. */
+
+    static const char *Fields[] = {
+        "%d * * * *", "* %d * * *", "* * %d * *", "* * * %d *", "* * * * %d",
+    };
+
+    static const int Ranges[][2] = {
+        { 0, 59 }, { 0, 23 }, { 1, 31 }, { 1, 12 }, { 0, 6 },
+    };
+
+    enum { NumPrints = 60 + 24 + 31 + 12 + 7 };
+
+    struct ScheduleFingerprint prints[NumPrints];
+
+    size_t numPrints = 0;
+
+    for (size_t fx = 0; fx < sizeof(Fields)/sizeof(Fields[0]); ++fx) {
+        for (int value = Ranges[fx][0]; value <= Ranges[fx][1]; ++value) {
+            char schedule[32];
+
+            snprintf(schedule, sizeof(schedule), Fields[fx], value);
+
+            EXPECT_EQ(lhs, initSchedule(lhs, schedule));
+            EXPECT_EQ(
+                &prints[numPrints],
+                queryScheduleFingerprint(lhs, &prints[numPrints]));
+
+            for (size_t px = 0; px < numPrints; ++px)
+                EXPECT_NE(0, compareScheduleFingerprints(
+                    &prints[px], &prints[numPrints])) << schedule;
+
+            ++numPrints;
+        }
     }
+
+    EXPECT_EQ(NumPrints, numPrints);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Jobs)
+{
+    struct Schedule backup_, *backup = &backup_;
+    struct Schedule poll_, *poll = &poll_;
+
+    EXPECT_EQ(backup, initSchedule(backup, "30 2 * * *"));
+    EXPECT_EQ(poll, initSchedule(poll, "*/15 * * * *"));
+
+    static const struct ScheduleJob Jobs[] = {
+        { "backup", backup },
+        { "backup-daily", backup },
+        { "poll", poll },
+    };
+
+    EXPECT_EQ(backup, queryScheduleJob(Jobs, NUMBEROF(Jobs), "backup"));
+    EXPECT_EQ(backup, queryScheduleJob(Jobs, NUMBEROF(Jobs), "backup-daily"));
+    EXPECT_EQ(poll, queryScheduleJob(Jobs, NUMBEROF(Jobs), "poll"));
+
+    errno = 0;
+    EXPECT_FALSE(queryScheduleJob(Jobs, NUMBEROF(Jobs), "back"));
+    EXPECT_EQ(ENOENT, errno);
+
+    errno = 0;
+    EXPECT_FALSE(queryScheduleJob(Jobs, 0, "backup"));
+    EXPECT_EQ(ENOENT, errno);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Queries)
+{
+    static const char *Schedules[] = {
+        "30 1 * * *",
+        "30 2 * * *",
+        "*/15 * * * *",
+        "0,15,30,45 * * * *",
+        "0 * * * *",
+        "0,30 1,2,3 * * 0",
+        "0,30 1-3 * * 7",
+        "15 2 * * 0",
+        "0 0 29 2 *",
+        "45 3 29 2 *",
+        "0 12 1,15 * 1",
+        "30 2 1,15 * 1",
+        "0 0 * 4,10 *",
+    };
+
+    enum { NumSchedules = sizeof(Schedules)/sizeof(Schedules[0]) };
+
+    struct Schedule schedules[NumSchedules];
+
+    for (size_t sx = 0; sx < NumSchedules; ++sx)
+        EXPECT_EQ(&schedules[sx], initSchedule(&schedules[sx], Schedules[sx]));
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    time_t scheduled[NumSchedules];
+
+    EXPECT_EQ(0, querySchedules(schedules, 0, civilTime, scheduled));
+
+    /* Each minute across the spring and fall daylight savings changes
+     * gives the same result as querying each schedule in turn.
+     */
+
+    /* Sat Apr  1 22:00:00 PST 2000 */
+    /* Sat Oct 28 22:00:00 PDT 2000 */
+    static const time_t Times[] = { 954655200, 972795600 };
+
+    for (size_t tx = 0; tx < sizeof(Times)/sizeof(Times[0]); ++tx) {
+        for (time_t ix = 0; ix < 8 * 60; ++ix) {
+
+            time_t time = Times[tx] + 60 * ix;
+
+            EXPECT_EQ(civilTime, initCivilTime(civilTime, time));
+
+            EXPECT_EQ(0, querySchedules(
+                schedules, NumSchedules, civilTime, scheduled));
+
+            for (size_t sx = 0; sx < NumSchedules; ++sx) {
+                EXPECT_EQ(testSchedule_(&schedules[sx], time), scheduled[sx])
+                    << Schedules[sx] << " " << time;
+            }
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static struct Schedule *
+newQueriesSchedules_(size_t aLength)
+{
+    static const char *Schedules[] = {
+        "*/5 * * * *",
+        "0 * * * *",
+        "30 2 * * *",
+        "0 9-17 * * 1-5",
+        "15 4 1 * *",
+        "0 0 1 1 *",
+        "0 0 29 2 *",
+    };
+
+    static const size_t NumExpressions = sizeof(Schedules)/sizeof(Schedules[0]);
+
+    struct Schedule *schedules = new struct Schedule[aLength];
+
+    for (size_t sx = 0; sx < aLength; ++sx) {
+        const char *schedule = Schedules[sx % NumExpressions];
+
+        EXPECT_EQ(&schedules[sx], initSchedule(&schedules[sx], schedule));
+    }
+
+    return schedules;
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, QueriesMany)
+{
+    enum { NumSchedules = 2000 };
+
+    struct Schedule *schedules = newQueriesSchedules_(NumSchedules);
+
+    time_t *scheduled = new time_t[NumSchedules];
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Sat Oct 28 22:00:00 PDT 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 972795600));
+
+    EXPECT_EQ(0, querySchedules(
+        schedules, NumSchedules, civilTime, scheduled));
+
+    for (size_t sx = 0; sx < NumSchedules; ++sx) {
+        EXPECT_EQ(querySchedule(&schedules[sx], civilTime, 0, 0, 0),
+                  scheduled[sx]);
+    }
+
+    delete[] scheduled;
+    delete[] schedules;
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, DISABLED_QueriesBenchmark)
+{
+    /* Compare the time taken to query each schedule in turn against the
+     * time taken by a batched query. Run explicitly using
+     * --gtest_also_run_disabled_tests.
+     */
+
+    enum { NumSchedules = 2000 };
+
+    struct Schedule *schedules = newQueriesSchedules_(NumSchedules);
+
+    time_t *queried = new time_t[NumSchedules];
+    time_t *scheduled = new time_t[NumSchedules];
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Sat Oct 28 22:00:00 PDT 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 972795600));
+
+    int trials = 10;
+
+    struct timespec start, split, stop;
+
+    EXPECT_EQ(0, clock_gettime(CLOCK_MONOTONIC, &start));
+
+    for (int tx = 0; tx < trials; ++tx) {
+        for (size_t sx = 0; sx < NumSchedules; ++sx) {
+            queried[sx] = querySchedule(&schedules[sx], civilTime, 0, 0, 0);
+        }
+    }
+
+    EXPECT_EQ(0, clock_gettime(CLOCK_MONOTONIC, &split));
+
+    for (int tx = 0; tx < trials; ++tx) {
+        EXPECT_EQ(0, querySchedules(
+            schedules, NumSchedules, civilTime, scheduled));
+    }
+
+    EXPECT_EQ(0, clock_gettime(CLOCK_MONOTONIC, &stop));
+
+    for (size_t sx = 0; sx < NumSchedules; ++sx)
+        EXPECT_EQ(queried[sx], scheduled[sx]);
+
+    double looped =
+        (split.tv_sec - start.tv_sec) * 1e3 +
+        (split.tv_nsec - start.tv_nsec) / 1e6;
+    double batched =
+        (stop.tv_sec - split.tv_sec) * 1e3 +
+        (stop.tv_nsec - split.tv_nsec) / 1e6;
+
+    printf("querySchedule  %d x %d: %.3f ms\n", trials, NumSchedules, looped);
+    printf("querySchedules %d x %d: %.3f ms\n", trials, NumSchedules, batched);
+
+    delete[] scheduled;
+    delete[] queried;
+    delete[] schedules;
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Collision)
+{
+    static const char *Schedules[] = {
+        "30 1 * * *",
+        "30 * * * *",
+        "*/15 1-3 * * *",
+        "*/10 * * * *",
+        "0 2 * * *",
+        "0 3 * * 0",
+        "0,30 * 2 4 *",
+        "0 0 29 2 *",
+    };
+
+    enum { NumSchedules = sizeof(Schedules)/sizeof(Schedules[0]) };
+
+    struct Schedule schedules[NumSchedules];
+
+    for (size_t sx = 0; sx < NumSchedules; ++sx)
+        EXPECT_EQ(&schedules[sx], initSchedule(&schedules[sx], Schedules[sx]));
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Each minute across the spring and fall daylight savings changes
+     * finds the earliest occurrence common to both schedules, or fails
+     * if there is no collision within the horizon. Occurrences rather
+     * than matches are compared because the first minute after the
+     * spring change is an occurrence of both the skipped hour and the
+     * following hour.
+     */
+
+    /* Sun Apr  2 00:00:00 PST 2000 */
+    /* Sun Oct 29 00:00:00 PDT 2000 */
+    static const time_t Times[] = { 954662400, 972802800 };
+
+    enum { Minutes = 4 * 60, Horizon = 12 * 60 };
+
+    for (size_t tx = 0; tx < sizeof(Times)/sizeof(Times[0]); ++tx) {
+
+        static int matches[Minutes + Horizon + 1][NumSchedules];
+
+        memset(matches, 0, sizeof(matches));
+
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, Times[tx]));
+
+        for (size_t sx = 0; sx < NumSchedules; ++sx) {
+            struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+            EXPECT_EQ(iterator,
+                initScheduleIterator(iterator, &schedules[sx], civilTime));
+            EXPECT_EQ(iterator,
+                limitScheduleIterator(iterator, 60 * (Minutes + Horizon), 0));
+
+            while (1) {
+                time_t scheduled = nextScheduleOccurrence(iterator);
+                if (-1 == scheduled)
+                    break;
+
+                matches[(scheduled - Times[tx]) / 60][sx] = 1;
+            }
+        }
+
+        for (size_t lx = 0; lx < NumSchedules; ++lx) {
+            for (size_t rx = lx + 1; rx < NumSchedules; ++rx) {
+                for (time_t ix = 0; ix < Minutes; ix += 5) {
+                    time_t time = Times[tx] + 60 * ix;
+
+                    time_t expected = -1;
+                    for (time_t jx = ix; jx <= ix + Horizon; ++jx) {
+                        if (matches[jx][lx] && matches[jx][rx]) {
+                            expected = Times[tx] + 60 * jx;
+                            break;
+                        }
+                    }
+
+                    EXPECT_EQ(civilTime, initCivilTime(civilTime, time));
+
+                    errno = 0;
+                    EXPECT_EQ(expected, queryScheduleCollision(
+                        &schedules[lx], &schedules[rx],
+                        civilTime, 60 * Horizon))
+                        << Schedules[lx] << " " << Schedules[rx] << " " << time;
+                    if (-1 == expected)
+                        EXPECT_EQ(ENOENT, errno);
+
+                    EXPECT_EQ(expected, queryScheduleCollision(
+                        &schedules[rx], &schedules[lx],
+                        civilTime, 60 * Horizon))
+                        << Schedules[rx] << " " << Schedules[lx] << " " << time;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(ScheduleTest, Gap)
+{
+    static const char *Schedules[] = {
+        "* * * * *",
+        "0-29 * * * *",
+        "* 1-3 * * *",
+        "* 2 * * *",
+        "* 3 * * *",
+        "* 0-22 * * *",
+        "*/2 * * * *",
+        "* * * * 0",
+        "* * 2,29 * *",
+        "* * * 4,10 *",
+        "* * L * *",
+    };
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Each minute across the spring and fall daylight savings changes
+     * finds the earliest minute at which the schedule does not match,
+     * or fails if there is no such minute within the horizon.
+     */
+
+    /* Sun Apr  2 00:00:00 PST 2000 */
+    /* Sun Oct 29 00:00:00 PDT 2000 */
+    static const time_t Times[] = { 954662400, 972802800 };
+
+    enum { Minutes = 4 * 60, Horizon = 12 * 60 };
+
+    for (size_t tx = 0; tx < sizeof(Times)/sizeof(Times[0]); ++tx) {
+
+        static struct CivilTime civilTimes[Minutes + Horizon + 1];
+
+        for (time_t ix = 0; ix <= Minutes + Horizon; ++ix)
+            EXPECT_EQ(
+                &civilTimes[ix],
+                initCivilTime(&civilTimes[ix], Times[tx] + 60 * ix));
+
+        for (size_t sx = 0; sx < sizeof(Schedules)/sizeof(Schedules[0]); ++sx) {
+            struct Schedule schedule_, *schedule = &schedule_;
+
+            EXPECT_EQ(schedule, initSchedule(schedule, Schedules[sx]));
+
+            static int matches[Minutes + Horizon + 1];
+
+            for (time_t ix = 0; ix <= Minutes + Horizon; ++ix)
+                matches[ix] = matchSchedule(schedule, &civilTimes[ix]);
+
+            for (time_t ix = 0; ix < Minutes; ix += 5) {
+                time_t time = Times[tx] + 60 * ix;
+
+                time_t expected = -1;
+                for (time_t jx = ix; jx <= ix + Horizon; ++jx) {
+                    if (!matches[jx]) {
+                        expected = Times[tx] + 60 * jx;
+                        break;
+                    }
+                }
+
+                errno = 0;
+                EXPECT_EQ(
+                    expected,
+                    queryScheduleGap(schedule, &civilTimes[ix], 60 * Horizon))
+                    << Schedules[sx] << " " << time;
+                if (-1 == expected)
+                    EXPECT_EQ(ENOENT, errno) << Schedules[sx] << " " << time;
+            }
+        }
+    }
+
+    /* A schedule that matches for months finds the first minute that it
+     * does not match without visiting each minute.
+     */
+
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "* * * 1-11 *"));
+
+    /* Mon Jan  1 00:00:00 PST 2001 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 978336000));
+
+    /* Sat Dec  1 00:00:00 PST 2001 */
+    EXPECT_EQ(1007193600, queryScheduleGap(schedule, civilTime, 0));
+
+    errno = 0;
+    EXPECT_EQ(-1, queryScheduleGap(schedule, civilTime, 24 * 60 * 60));
+    EXPECT_EQ(ENOENT, errno);
+
+    errno = 0;
+    EXPECT_EQ(-1, queryScheduleGap(schedule, civilTime, -1));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "* * * * *"));
+
+    errno = 0;
+    EXPECT_EQ(-1, queryScheduleGap(schedule, civilTime, 0));
+    EXPECT_EQ(ENOENT, errno);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "*/10 * * * * *"));
+
+    errno = 0;
+    EXPECT_EQ(-1, queryScheduleGap(schedule, civilTime, 0));
+    EXPECT_EQ(EINVAL, errno);
+}
+
+TEST_F(ScheduleTest, Previous)
+{
+    static const char *Schedules[] = {
+        "* * * * *",
+        "30 1 * * *",
+        "0 2 * * *",
+        "*/15 1-3 * * *",
+        "0 3 * * 0",
+        "0,30 1,2 2,29 4,10 *",
+        "59 23 * * 6",
+    };
+
+    enum { NumSchedules = sizeof(Schedules)/sizeof(Schedules[0]) };
+
+    struct Schedule schedules[NumSchedules];
+
+    for (size_t sx = 0; sx < NumSchedules; ++sx)
+        EXPECT_EQ(&schedules[sx], initSchedule(&schedules[sx], Schedules[sx]));
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Each minute across the spring and fall daylight savings changes
+     * finds the most recent occurrence produced by a forward search,
+     * or fails if there is no occurrence within the horizon.
+     */
+
+    /* Sun Apr  2 00:00:00 PST 2000 */
+    /* Sun Oct 29 00:00:00 PDT 2000 */
+    static const time_t Times[] = { 954662400, 972802800 };
+
+    enum { Minutes = 4 * 60, Horizon = 12 * 60 };
+
+    for (size_t tx = 0; tx < sizeof(Times)/sizeof(Times[0]); ++tx) {
+
+        static int matches[Minutes + Horizon][NumSchedules];
+
+        memset(matches, 0, sizeof(matches));
+
+        time_t since = Times[tx] - 60 * Horizon;
+
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, since));
+
+        for (size_t sx = 0; sx < NumSchedules; ++sx) {
+            struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+            EXPECT_EQ(iterator,
+                initScheduleIterator(iterator, &schedules[sx], civilTime));
+            EXPECT_EQ(iterator,
+                limitScheduleIterator(
+                    iterator, 60 * (Minutes + Horizon - 1), 0));
+
+            while (1) {
+                time_t scheduled = nextScheduleOccurrence(iterator);
+                if (-1 == scheduled)
+                    break;
+
+                matches[(scheduled - since) / 60][sx] = 1;
+            }
+        }
+
+        for (size_t sx = 0; sx < NumSchedules; ++sx) {
+            for (time_t ix = Horizon; ix < Minutes + Horizon; ix += 5) {
+                time_t time = since + 60 * ix;
+
+                time_t expected = -1;
+                for (time_t jx = ix; jx >= ix - Horizon; --jx) {
+                    if (matches[jx][sx]) {
+                        expected = since + 60 * jx;
+                        break;
+                    }
+                }
+
+                EXPECT_EQ(civilTime, initCivilTime(civilTime, time));
+
+                errno = 0;
+                EXPECT_EQ(expected, querySchedulePrevious(
+                    &schedules[sx], civilTime, 60 * Horizon))
+                    << Schedules[sx] << " " << time;
+                if (-1 == expected)
+                    EXPECT_EQ(ENOENT, errno);
+            }
+        }
+    }
+
+    /* Without a horizon, the search proceeds back to an occurrence
+     * in a preceding leap year.
+     */
+
+    struct Schedule schedule;
+
+    EXPECT_EQ(&schedule, initSchedule(&schedule, "0 0 29 2 *"));
+
+    /* Sun Apr  2 00:00:00 PST 2000 */
+    /* Tue Feb 29 00:00:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 954662400));
+    EXPECT_EQ(951811200, querySchedulePrevious(&schedule, civilTime, 0));
+
+    /* Tue Feb 29 00:00:00 PST 2000 */
+    /* Thu Feb 29 00:00:00 PST 1996 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 951811200 - 60));
+    EXPECT_EQ(825580800, querySchedulePrevious(&schedule, civilTime, 0));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Seconds)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct ScheduleFingerprint lhs, rhs;
+
+    /* Selecting only the start of each minute is the same as omitting
+     * the seconds, but a wildcard selects every second.
+     */
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 */5 * * * *"));
+    EXPECT_EQ(0u, queryBitRingPopulation(&schedule->mSeconds));
+    queryScheduleFingerprint(schedule, &lhs);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "*/5 * * * *"));
+    EXPECT_EQ(0u, queryBitRingPopulation(&schedule->mSeconds));
+    queryScheduleFingerprint(schedule, &rhs);
+
+    EXPECT_EQ(0, compareScheduleFingerprints(&lhs, &rhs));
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "* */5 * * * *"));
+    EXPECT_EQ(60u, queryBitRingPopulation(&schedule->mSeconds));
+    queryScheduleFingerprint(schedule, &lhs);
+
+    EXPECT_NE(0, compareScheduleFingerprints(&lhs, &rhs));
+
+    static const char *Schedules[] = {
+        "* * * * * *",
+        "*/15 * * * * *",
+        "5,55 30 1,2 * * *",
+        "*/20 * 2 * * *",
+        "59 59 * * * *",
+        "30 0 3 * * 0",
+    };
+
+    enum { NumSchedules = sizeof(Schedules)/sizeof(Schedules[0]) };
+
+    struct Schedule schedules[NumSchedules];
+
+    for (size_t sx = 0; sx < NumSchedules; ++sx)
+        EXPECT_EQ(&schedules[sx], initSchedule(&schedules[sx], Schedules[sx]));
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Each schedule occurs at each selected second of the minutes selected
+     * by the schedule without its seconds. Search from times part way
+     * through minutes across the spring and fall daylight savings changes.
+     */
+
+    /* Sun Apr  2 00:00:00 PST 2000 */
+    /* Sun Oct 29 00:00:00 PDT 2000 */
+    static const time_t Times[] = { 954662400, 972802800 };
+
+    enum { Seconds = 4 * 60 * 60, Horizon = 20 * 60 };
+
+    for (size_t tx = 0; tx < sizeof(Times)/sizeof(Times[0]); ++tx) {
+
+        static int matches[Seconds + Horizon + 1][NumSchedules];
+
+        memset(matches, 0, sizeof(matches));
+
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, Times[tx]));
+
+        for (size_t sx = 0; sx < NumSchedules; ++sx) {
+            struct Schedule minutes = schedules[sx];
+
+            minutes.mSeconds.mRing = 0;
+
+            struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+            EXPECT_EQ(iterator,
+                initScheduleIterator(iterator, &minutes, civilTime));
+            EXPECT_EQ(iterator,
+                limitScheduleIterator(iterator, Seconds + Horizon, 0));
+
+            while (1) {
+                time_t scheduled = nextScheduleOccurrence(iterator);
+                if (-1 == scheduled)
+                    break;
+
+                for (int second = 0; second < 60; ++second) {
+                    time_t offset = scheduled - Times[tx] + second;
+
+                    if (offset <= Seconds + Horizon &&
+                            queryBitRingMembership(
+                                &schedules[sx].mSeconds, second))
+                        matches[offset][sx] = 1;
+                }
+            }
+        }
+
+        for (size_t sx = 0; sx < NumSchedules; ++sx) {
+            for (time_t ix = Horizon; ix < Seconds; ix += 11 * 60 + 13) {
+                time_t time = Times[tx] + ix;
+
+                EXPECT_EQ(civilTime, initCivilTime(civilTime, time - ix % 60));
+                if (ix % 60)
+                    EXPECT_EQ(0, advanceCivilTimeSecond(civilTime, ix % 60));
+
+                struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+                EXPECT_EQ(iterator,
+                    initScheduleIterator(iterator, &schedules[sx], civilTime));
+                EXPECT_EQ(iterator,
+                    limitScheduleIterator(iterator, Horizon, 0));
+
+                for (time_t jx = ix; jx <= ix + Horizon; ++jx) {
+                    if (matches[jx][sx]) {
+                        EXPECT_EQ(Times[tx] + jx,
+                            nextScheduleOccurrence(iterator))
+                            << Schedules[sx] << " " << time;
+                    }
+                }
+
+                errno = 0;
+                EXPECT_EQ(-1, nextScheduleOccurrence(iterator))
+                    << Schedules[sx] << " " << time;
+                EXPECT_EQ(ENOENT, errno);
+
+                time_t expected = -1;
+                for (time_t jx = ix; jx >= ix - Horizon; --jx) {
+                    if (matches[jx][sx]) {
+                        expected = Times[tx] + jx;
+                        break;
+                    }
+                }
+
+                errno = 0;
+                EXPECT_EQ(expected,
+                    querySchedulePrevious(&schedules[sx], civilTime, Horizon))
+                    << Schedules[sx] << " " << time;
+                if (-1 == expected)
+                    EXPECT_EQ(ENOENT, errno);
+            }
+        }
+    }
+
+    /* Schedules are queried together from part way through a minute. */
+
+    time_t scheduled[NumSchedules];
+
+    /* Sun Apr  2 01:59:31 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 954669600 - 60));
+    EXPECT_EQ(0, advanceCivilTimeSecond(civilTime, 31));
+    EXPECT_EQ(0, querySchedules(
+        schedules, NumSchedules, civilTime, scheduled));
+
+    for (size_t sx = 0; sx < NumSchedules; ++sx) {
+        EXPECT_EQ(
+            querySchedule(&schedules[sx], civilTime, 0, 0, 0), scheduled[sx])
+            << Schedules[sx];
+    }
+
+    EXPECT_EQ(954669600 - 29, scheduled[0]);
+    EXPECT_EQ(954669600 - 15, scheduled[1]);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Years)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+    struct ScheduleFingerprint lhs, rhs;
+
+    /* A wildcard is the same as omitting the years. */
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 30 12 1 * * *"));
+    queryScheduleFingerprint(schedule, &lhs);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "30 12 1 * *"));
+    queryScheduleFingerprint(schedule, &rhs);
+
+    EXPECT_EQ(0, compareScheduleFingerprints(&lhs, &rhs));
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 30 12 1 * * 2001,2003"));
+    EXPECT_EQ(ScheduleShapeGeneral, schedule->mShape);
+    queryScheduleFingerprint(schedule, &lhs);
+
+    EXPECT_NE(0, compareScheduleFingerprints(&lhs, &rhs));
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
+
+    /* The search passes directly to the first selected year, and skips
+     * the years that are not selected.
+     */
+
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
+
+    /* Mon Jan  1 12:30:00 PST 2001 */
+    EXPECT_EQ(978381000, nextScheduleOccurrence(iterator));
+    EXPECT_GT(20u, iterator->mSteps);
+
+    for (int ix = 1; ix < 12 + 12; ++ix) {
+        errno = 0;
+        EXPECT_NE(-1, nextScheduleOccurrence(iterator)) << errno;
+    }
+
+    /* Mon Dec  1 12:30:00 PST 2003 */
+    EXPECT_EQ(1070310600, iterator->mScheduled);
+
+    /* There are no further occurrences once the years are exhausted. */
+
+    unsigned long steps = iterator->mSteps;
+
+    errno = 0;
+    EXPECT_EQ(-1, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(ENOENT, errno);
+    EXPECT_GT(steps + 10u, iterator->mSteps);
+
+    /* Sun Feb 29 00:00:00 PST 2004 */
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 0 29 2 * 2001-2010"));
+    EXPECT_EQ(1078041600, querySchedule(schedule, civilTime, 0, 0, 0));
+
+    /* The most recent occurrence lies in the most recent selected year. */
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 0 1 1 * 2001,2003"));
+
+    /* Wed Jun  1 00:00:00 PDT 2005 */
+    /* Wed Jan  1 00:00:00 PST 2003 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 1117609200));
+    EXPECT_EQ(1041408000, querySchedulePrevious(schedule, civilTime, 0));
+
+    /* Fri Jun  1 00:00:00 PDT 2001 */
+    /* Mon Jan  1 00:00:00 PST 2001 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 991378800));
+    EXPECT_EQ(978336000, querySchedulePrevious(schedule, civilTime, 0));
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
+    errno = 0;
+    EXPECT_EQ(-1, querySchedulePrevious(schedule, civilTime, 0));
+    EXPECT_EQ(ENOENT, errno);
+
+    /* Wed Jan  1 00:00:00 PST 2003 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 1041408000));
+    EXPECT_TRUE(matchSchedule(schedule, civilTime));
+
+    /* Tue Jan  1 00:00:00 PST 2002 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 1009872000));
+    EXPECT_FALSE(matchSchedule(schedule, civilTime));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Window)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+    struct ScheduleFingerprint lhs, rhs;
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    static const time_t Time = 946713600;
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "*/15 * * * *"));
+    queryScheduleFingerprint(schedule, &lhs);
+
+    EXPECT_FALSE(boundSchedule(schedule, -1, 0));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(boundSchedule(schedule, Time + 60, Time));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_EQ(schedule, boundSchedule(schedule, 0, 0));
+    queryScheduleFingerprint(schedule, &rhs);
+
+    EXPECT_EQ(0, compareScheduleFingerprints(&lhs, &rhs));
+
+    EXPECT_EQ(schedule,
+        boundSchedule(schedule, Time + 7 * 60 + 30, Time + 50 * 60));
+    queryScheduleFingerprint(schedule, &rhs);
+
+    EXPECT_NE(0, compareScheduleFingerprints(&lhs, &rhs));
+
+    /* Occurrences before the window opens are skipped, and there are no
+     * further occurrences after the window closes.
+     */
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, Time));
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
+
+    EXPECT_EQ(Time + 15 * 60, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(Time + 30 * 60, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(Time + 45 * 60, nextScheduleOccurrence(iterator));
+
+    errno = 0;
+    EXPECT_EQ(-1, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(ENOENT, errno);
+
+    /* A search that starts after the window has closed finds nothing,
+     * even if the schedule is not otherwise computed by a search.
+     */
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, Time + 60 * 60));
+    errno = 0;
+    EXPECT_EQ(-1, querySchedule(schedule, civilTime, 0, 0, 0));
+    EXPECT_EQ(ENOENT, errno);
+
+    EXPECT_EQ(Time + 45 * 60, querySchedulePrevious(schedule, civilTime, 0));
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, Time + 10 * 60));
+    errno = 0;
+    EXPECT_EQ(-1, querySchedulePrevious(schedule, civilTime, 0));
+    EXPECT_EQ(ENOENT, errno);
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, Time));
+    EXPECT_FALSE(matchSchedule(schedule, civilTime));
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, Time + 15 * 60));
+    EXPECT_TRUE(matchSchedule(schedule, civilTime));
+
+    time_t times[] = { Time, Time + 15 * 60, Time + 60 * 60 };
+    int matches[NUMBEROF(times)];
+
+    EXPECT_EQ(0, matchScheduleTimes(schedule, times, NUMBEROF(times), matches));
+    EXPECT_FALSE(matches[0]);
+    EXPECT_TRUE(matches[1]);
+    EXPECT_FALSE(matches[2]);
+
+    /* Schedules that differ only in their windows are queried apart, and
+     * a schedule whose window has closed has no occurrence.
+     */
+
+    struct Schedule schedules[3];
+
+    EXPECT_EQ(&schedules[0], initSchedule(&schedules[0], "*/15 * * * *"));
+    EXPECT_EQ(&schedules[1], initSchedule(&schedules[1], "*/15 * * * *"));
+    EXPECT_EQ(&schedules[2], initSchedule(&schedules[2], "*/15 * * * *"));
+
+    EXPECT_EQ(&schedules[1], boundSchedule(&schedules[1], Time + 60, 0));
+    EXPECT_EQ(&schedules[2], boundSchedule(&schedules[2], 0, Time - 60));
+
+    time_t scheduled[NUMBEROF(schedules)];
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, Time));
+    EXPECT_EQ(0, querySchedules(
+        schedules, NUMBEROF(schedules), civilTime, scheduled));
+
+    EXPECT_EQ(Time, scheduled[0]);
+    EXPECT_EQ(Time + 15 * 60, scheduled[1]);
+    EXPECT_EQ(-1, scheduled[2]);
+
+    /* The window bounds schedules with seconds to the second. */
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "*/10 * * * * *"));
+    EXPECT_EQ(schedule, boundSchedule(schedule, Time + 5, Time + 35));
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, Time));
+    EXPECT_EQ(Time + 10, querySchedule(schedule, civilTime, 0, 0, 0));
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, Time + 60));
+    EXPECT_EQ(Time + 30, querySchedulePrevious(schedule, civilTime, 0));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Exclusion)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+    struct ScheduleFingerprint lhs, rhs;
+
+    struct ScheduleExclusion exclusion_, *exclusion = &exclusion_;
+    struct ScheduleExclusion other_, *other = &other_;
+
+    EXPECT_EQ(exclusion, initScheduleExclusion(exclusion));
+    EXPECT_EQ(other, initScheduleExclusion(other));
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 9 * * 1-5"));
+    EXPECT_EQ(ScheduleShapeWeekDays, schedule->mShape);
+    queryScheduleFingerprint(schedule, &lhs);
+
+    /* An empty calendar leaves the schedule unchanged, and equivalent
+     * calendars produce the same fingerprint.
+     */
+
+    EXPECT_EQ(schedule, excludeSchedule(schedule, exclusion));
+    EXPECT_EQ(ScheduleShapeWeekDays, schedule->mShape);
+    queryScheduleFingerprint(schedule, &rhs);
+
+    EXPECT_EQ(0, compareScheduleFingerprints(&lhs, &rhs));
+
+    EXPECT_EQ(0, addScheduleExclusionDates(
+        exclusion, "2000-12-25..2001-01-02"));
+    EXPECT_EQ(0, addScheduleExclusionDates(
+        other, "2000-12-25..2001-01-02"));
+
+    EXPECT_EQ(schedule, excludeSchedule(schedule, exclusion));
+    EXPECT_EQ(ScheduleShapeGeneral, schedule->mShape);
+    queryScheduleFingerprint(schedule, &lhs);
+
+    EXPECT_NE(0, compareScheduleFingerprints(&lhs, &rhs));
+
+    EXPECT_EQ(schedule, excludeSchedule(schedule, other));
+    queryScheduleFingerprint(schedule, &rhs);
+
+    EXPECT_EQ(0, compareScheduleFingerprints(&lhs, &rhs));
+
+    /* Fri Dec 22 00:00:00 PST 2000 */
+    static const time_t Time = 977472000;
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, Time));
+    EXPECT_EQ(iterator, initScheduleIterator(iterator, schedule, civilTime));
+
+    /* Fri Dec 22 09:00:00 PST 2000 */
+    EXPECT_EQ(977504400, nextScheduleOccurrence(iterator));
+
+    /* Wed Jan  3 09:00:00 PST 2001 */
+    EXPECT_EQ(978541200, nextScheduleOccurrence(iterator));
+    EXPECT_EQ(978541200 + 86400, nextScheduleOccurrence(iterator));
+
+    /* Wed Jan  3 00:00:00 PST 2001 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 978508800));
+    EXPECT_EQ(977504400, querySchedulePrevious(schedule, civilTime, 0));
+
+    /* Mon Dec 25 09:00:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 977763600));
+    EXPECT_FALSE(matchSchedule(schedule, civilTime));
+
+    time_t times[] = { 977504400, 977763600, 978541200 };
+    int matches[NUMBEROF(times)];
+
+    EXPECT_EQ(0, matchScheduleTimes(schedule, times, NUMBEROF(times), matches));
+    EXPECT_TRUE(matches[0]);
+    EXPECT_FALSE(matches[1]);
+    EXPECT_TRUE(matches[2]);
+
+    /* Schedules that differ only in their exclusions are queried apart. */
+
+    struct Schedule schedules[2];
+
+    EXPECT_EQ(&schedules[0], initSchedule(&schedules[0], "0 9 * * *"));
+    EXPECT_EQ(&schedules[1], initSchedule(&schedules[1], "0 9 * * *"));
+
+    EXPECT_EQ(&schedules[1], excludeSchedule(&schedules[1], exclusion));
+
+    time_t scheduled[NUMBEROF(schedules)];
+
+    /* Mon Dec 25 00:00:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 977731200));
+    EXPECT_EQ(0, querySchedules(
+        schedules, NUMBEROF(schedules), civilTime, scheduled));
+
+    EXPECT_EQ(977763600, scheduled[0]);
+    EXPECT_EQ(978541200, scheduled[1]);
+
+    /* Compare against a schedule without exclusions, skipping the
+     * occurrences on excluded days, including across the daylight
+     * savings changes.
+     */
+
+    for (int month = 1; month <= 12; ++month) {
+        for (int day = 1; day <= 28; day += 1 + month % 3)
+            EXPECT_EQ(0, addScheduleExclusionDate(exclusion, 2000, month, day));
+    }
+
+    EXPECT_EQ(0, addScheduleExclusionDates(exclusion, "2000-04-02"));
+    EXPECT_EQ(0, addScheduleExclusionDates(exclusion, "2000-10-29"));
+
+    static const char *Schedules[] = {
+        "30 2 * * *",
+        "*/20 1 * * *",
+        "0 9 * * 1-5",
+        "0 12 1,15 * 0",
+        "15 * 2-28/3 * *",
+    };
+
+    for (unsigned sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+        struct Schedule excluded;
+
+        EXPECT_EQ(schedule, initSchedule(schedule, Schedules[sx]));
+        EXPECT_EQ(&excluded, initSchedule(&excluded, Schedules[sx]));
+        EXPECT_EQ(&excluded, excludeSchedule(&excluded, exclusion));
+
+        struct ScheduleIterator expected;
+
+        /* Sat Jan  1 00:00:00 PST 2000 */
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
+        EXPECT_EQ(&expected,
+            initScheduleIterator(&expected, schedule, civilTime));
+        EXPECT_EQ(iterator,
+            initScheduleIterator(iterator, &excluded, civilTime));
+
+        for (unsigned ix = 0; ix < 200; ) {
+            time_t occurrence = nextScheduleOccurrence(&expected);
+            EXPECT_NE(-1, occurrence);
+
+            struct tm tm;
+            EXPECT_TRUE(localtime_r(&occurrence, &tm));
+
+            if (matchScheduleExclusion(
+                    exclusion, tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday))
+                continue;
+
+            EXPECT_EQ(occurrence, nextScheduleOccurrence(iterator))
+                << Schedules[sx] << " " << ix;
+
+            if (occurrence != iterator->mScheduled)
+                break;
+
+            ++ix;
+        }
+    }
+
+    closeScheduleExclusion(other);
+    closeScheduleExclusion(exclusion);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+nearestWeekDay_(const struct tm *aTm, int aLastDay, int aDay)
+{
+    /* Find the weekday nearest to the specified day, without leaving
+     * the month, or 0 if the month is too short.
+     */
+
+    if (aDay > aLastDay)
+        return 0;
+
+    int weekDay = (aTm->tm_wday + aDay - aTm->tm_mday + 35) % 7;
+
+    if (6 == weekDay)
+        return 1 == aDay ? 3 : aDay - 1;
+
+    if (0 == weekDay)
+        return aLastDay == aDay ? aDay - 2 : aDay + 1;
+
+    return aDay;
+}
+
+static int
+selectMonthDay_(unsigned aCase, const struct tm *aTm, int aLastDay)
+{
+    int day = aTm->tm_mday;
+    int weekDay = aTm->tm_wday;
+
+    int lastWeekDay = aLastDay;
+    while (1) {
+        int wd = (weekDay + lastWeekDay - day + 35) % 7;
+        if (wd && 6 != wd)
+            break;
+        --lastWeekDay;
+    }
+
+    switch (aCase) {
+    case 0: return day == aLastDay;
+    case 1: return day == lastWeekDay;
+    case 2: return day == nearestWeekDay_(aTm, aLastDay, 15);
+    case 3: return
+        day == nearestWeekDay_(aTm, aLastDay, 1) ||
+        day == nearestWeekDay_(aTm, aLastDay, 31);
+    case 4: return 5 == weekDay && 2 == (day - 1) / 7;
+    case 5: return 0 == weekDay && day + 7 > aLastDay;
+    case 6: return day == aLastDay || 1 == weekDay;
+    case 7: return 13 == day || (5 == weekDay && 1 == (day - 1) / 7);
+    case 8: return day == aLastDay || (5 == weekDay && 4 == (day - 1) / 7);
+    }
+
+    return 0;
+}
+
+TEST_F(ScheduleTest, MonthDays)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+    struct ScheduleFingerprint lhs, rhs;
+
+    static const char *Invalid[] = {
+        "0 0 0W * *",
+        "0 0 32W * *",
+        "0 0 W * *",
+        "0 0 L-1 * *",
+        "0 0 *,L * *",
+        "0 0 LW,*/2 * *",
+        "0 0 L * *,5L",
+        "0 0 * * 8L",
+        "0 0 * * 5#",
+        "0 0 * * 5#0",
+        "0 0 * * 5#6",
+        "0 0 * * 5#1#2",
+        "0 0 * * L",
+    };
+
+    for (unsigned ix = 0; ix < NUMBEROF(Invalid); ++ix) {
+        errno = 0;
+        EXPECT_FALSE(initSchedule(schedule, Invalid[ix])) << Invalid[ix];
+        EXPECT_EQ(EINVAL, errno) << Invalid[ix];
+    }
+
+    /* The month days are kept in a canonical form, regardless of their
+     * order, or their mixture with the other days.
+     */
+
+    static const char *Same[][2] = {
+        { "0 0 L,1,15W * *", "0 0 15W,1,L * *" },
+        { "0 0 * * 0#1,0L", "0 0 * * 7L,7#1" },
+        { "0 0 * * 1-5,5#3", "0 0 * * 5#3,1-5" },
+    };
+
+    for (unsigned ix = 0; ix < NUMBEROF(Same); ++ix) {
+        EXPECT_EQ(schedule, initSchedule(schedule, Same[ix][0]));
+        EXPECT_EQ(ScheduleShapeGeneral, schedule->mShape);
+        queryScheduleFingerprint(schedule, &lhs);
+
+        EXPECT_EQ(schedule, initSchedule(schedule, Same[ix][1]));
+        queryScheduleFingerprint(schedule, &rhs);
+
+        EXPECT_EQ(0, compareScheduleFingerprints(&lhs, &rhs)) << Same[ix][0];
+    }
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 L * *"));
+    queryScheduleFingerprint(schedule, &lhs);
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 LW * *"));
+    queryScheduleFingerprint(schedule, &rhs);
+
+    EXPECT_NE(0, compareScheduleFingerprints(&lhs, &rhs));
+
+    /* Compare the occurrences over two years, including the daylight
+     * savings changes and a leap year, with the days computed directly
+     * from the calendar. Combinations with the other days of the month,
+     * or days of the week, are selected by either.
+     */
+
+    static const char *Schedules[] = {
+        "0 12 L * *",
+        "0 12 LW * *",
+        "0 12 15W * *",
+        "0 12 1W,31W * *",
+        "0 12 * * 5#3",
+        "0 12 * * 0L",
+        "0 12 L * 1",
+        "0 12 13 * 5#2",
+        "0 12 L * 5#5",
+    };
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    static const time_t Time = 946713600;
+
+    for (unsigned sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+
+        EXPECT_EQ(schedule, initSchedule(schedule, Schedules[sx]));
+
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, Time));
+        EXPECT_EQ(iterator,
+            initScheduleIterator(iterator, schedule, civilTime));
+
+        time_t previous = -1;
+
+        for (int day = 0; day < 2 * 365 + 1; ++day) {
+            struct tm tm = { };
+
+            tm.tm_year = 2000 - 1900;
+            tm.tm_mday = 1 + day;
+            tm.tm_hour = 12;
+            tm.tm_isdst = -1;
+
+            time_t noon = mktime(&tm);
+            EXPECT_NE(-1, noon);
+
+            struct tm lastTm = tm;
+
+            lastTm.tm_mon += 1;
+            lastTm.tm_mday = 0;
+            lastTm.tm_isdst = -1;
+            EXPECT_NE(-1, mktime(&lastTm));
+
+            if (!selectMonthDay_(sx, &tm, lastTm.tm_mday))
+                continue;
+
+            EXPECT_EQ(noon, nextScheduleOccurrence(iterator))
+                << Schedules[sx] << " " << day;
+
+            if (noon != iterator->mScheduled)
+                break;
+
+            EXPECT_EQ(civilTime, initCivilTime(civilTime, noon));
+            EXPECT_TRUE(matchSchedule(schedule, civilTime));
+
+            EXPECT_EQ(civilTime, initCivilTime(civilTime, noon + 60));
+            EXPECT_EQ(noon, querySchedulePrevious(schedule, civilTime, 0));
+
+            if (-1 != previous) {
+                EXPECT_EQ(civilTime, initCivilTime(civilTime, noon - 60));
+                EXPECT_EQ(
+                    previous, querySchedulePrevious(schedule, civilTime, 0))
+                    << Schedules[sx] << " " << day;
+            }
+
+            previous = noon;
+        }
+
+        EXPECT_NE(-1, previous);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, OneSidedJitter_1_Hour)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 * * * *"));
+
+    time_t now, deadline, scheduled;
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    now = 946713600;
+
+    time_t jitterPeriod = 5 * 60; /* 5 minute limit */
+
+    int sum = 0;
+    int sumsq = 0;
+    int trials = RUNNING_ON_VALGRIND ? 1 : 1000;
+
+    for (int ix = 0; ix < trials; ++ix) {
+        int jitter;
+        deadline = testSchedule_(schedule, now, jitterPeriod, &jitter);
+        scheduled = testSchedule_(schedule, now, 0);
+        EXPECT_LE(now, deadline);
+        EXPECT_EQ(deadline - jitter, scheduled);
+
+        int delay = deadline - now;
+
+        sum += delay;
+        sumsq += delay * delay;
+    }
+
+    if (!RUNNING_ON_VALGRIND) {
+        int observedPeriod = 5 * 60;
+
+        int mean = sum / trials;
+        int var = sumsq / trials - mean * mean;
+
+        int jitterPeriodStdDev = observedPeriod / 4.24264; /* sqrt(18) */
+
+        EXPECT_LE((jitterPeriodStdDev-2) * (jitterPeriodStdDev-2), var);
+        EXPECT_GE((jitterPeriodStdDev+2) * (jitterPeriodStdDev+2), var);
+
+        EXPECT_LE(observedPeriod / 3 - 3, mean);
+        EXPECT_GE(observedPeriod / 3 + 3, mean);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, OneSidedJitter_3_Minutes)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "*/3 * * * *"));
+
+    time_t now, deadline, scheduled;
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    now = 946713600;
+
+    time_t jitterPeriod = 3 * 60;
+
+    int sum = 0;
+    int sumsq = 0;
+    int trials = RUNNING_ON_VALGRIND ? 1 : 1000;
+
+    for (int ix = 0; ix < trials; ++ix) {
+        int jitter;
+        deadline = testSchedule_(schedule, now, jitterPeriod, &jitter);
+        scheduled = testSchedule_(schedule, now, 0);
+        EXPECT_LE(now, deadline);
+        EXPECT_EQ(deadline - jitter, scheduled);
+
+        int delay = deadline - now;
+
+        sum += delay;
+        sumsq += delay * delay;
+    }
+
+    if (!RUNNING_ON_VALGRIND) {
+        int observedPeriod = 3 * 60 / 2;
+
+        sum = trials * observedPeriod / 3;
+
+        int mean = sum / trials;
+        int var = sumsq / trials - mean * mean;
+
+        int jitterPeriodStdDev = observedPeriod / 4.24264; /* sqrt(18) */
+
+        EXPECT_LE((jitterPeriodStdDev-3) * (jitterPeriodStdDev-3), var);
+        EXPECT_GE((jitterPeriodStdDev+3) * (jitterPeriodStdDev+3), var);
+
+        EXPECT_LE(observedPeriod / 3 - 2, mean);
+        EXPECT_GE(observedPeriod / 3 + 2, mean);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, TwoSidedJitter_1_Minute)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "*/3 * * * *"));
+
+    time_t now, deadline, scheduled;
+
+    /* Sat Jan  1 00:02:00 PST 2000 */
+    now = 946713600 + 2 * 60;
+
+    time_t jitterPeriod = 3 * 60;
+
+    int sum = 0;
+    int sumsq = 0;
+    int trials = RUNNING_ON_VALGRIND ? 1 : 1000;
+
+    for (int ix = 0; ix < trials; ++ix) {
+        int jitter;
+        deadline = testSchedule_(schedule, now, jitterPeriod, &jitter);
+        scheduled = testSchedule_(schedule, now, 0);
+        EXPECT_LE(now, deadline);
+        EXPECT_EQ(deadline - jitter, scheduled);
+
+        int delay = deadline - now;
+
+        sum += delay;
+        sumsq += delay * delay;
+    }
+
+    if (!RUNNING_ON_VALGRIND) {
+        int observedPeriod = 1 * 60;
+
+        int mean = sum / trials;
+        int var = sumsq / trials - mean * mean;
+
+        int jitterPeriodStdDev = observedPeriod / 2.44949; /* sqrt(6) */
+
+        EXPECT_LE((jitterPeriodStdDev-3) * (jitterPeriodStdDev-3), var);
+        EXPECT_GE((jitterPeriodStdDev+3) * (jitterPeriodStdDev+3), var);
+
+        EXPECT_LE(observedPeriod - 4, mean);
+        EXPECT_GE(observedPeriod + 4, mean);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTest, Hash)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+    struct Schedule other_, *other = &other_;
+
+    struct ScheduleFingerprint lhs, rhs;
+
+    /* Without a key there is nothing to choose values from. */
+
+    EXPECT_FALSE(initSchedule(schedule, "H * * * *"));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initScheduleKey(schedule, "H(5-60) * * * *", "backup"));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initScheduleKey(schedule, "0 * * * * * H", "backup"));
+    EXPECT_EQ(EINVAL, errno);
+
+    /* Each field chooses a single value within its range, and the choice
+     * is stable for each key.
+     */
+
+    static const char *Keys[] = { "backup", "report", "" };
+
+    for (unsigned kx = 0; kx < NUMBEROF(Keys); ++kx) {
+        const char *key = Keys[kx];
+
+        EXPECT_EQ(schedule, initScheduleKey(schedule, "H H H H H H", key));
+        EXPECT_EQ(other, initScheduleKey(other, "H H H H H H", key));
+
+        queryScheduleFingerprint(schedule, &lhs);
+        queryScheduleFingerprint(other, &rhs);
+        EXPECT_EQ(0, compareScheduleFingerprints(&lhs, &rhs)) << key;
+
+        EXPECT_EQ(1U, queryBitRingPopulation(&schedule->mSeconds));
+
+        for (unsigned fx = 0; fx < ScheduleKinds; ++fx) {
+            EXPECT_EQ(1U, queryBitRingPopulation(&schedule->mSchedules[fx]))
+                << key << " " << fx;
+        }
+
+        EXPECT_GT(UINT64_C(1) << 28, schedule->mSchedules[ScheduleDays].mRing);
+        EXPECT_FALSE(queryBitRingMembership(
+            &schedule->mSchedules[ScheduleWeekDays], 7));
+
+        /* A stepped choice starts within the first step, and a ranged
+         * choice stays within the range.
+         */
+
+        EXPECT_EQ(schedule,
+            initScheduleKey(schedule, "H/15 H(10-17) * * *", key));
+
+        const struct BitRing *minuteRing =
+            &schedule->mSchedules[ScheduleMinutes];
+        const struct BitRing *hourRing =
+            &schedule->mSchedules[ScheduleHours];
+
+        EXPECT_EQ(4U, queryBitRingPopulation(minuteRing));
+        EXPECT_EQ(1U, queryBitRingPopulation(hourRing));
+
+        int minute = __builtin_ctzll(minuteRing->mRing) + minuteRing->mMin;
+        int hour = __builtin_ctzll(hourRing->mRing) + hourRing->mMin;
+
+        EXPECT_GT(15, minute);
+        for (int mx = 0; mx < 60; mx += 15)
+            EXPECT_TRUE(queryBitRingMembership(minuteRing, minute + mx));
+
+        EXPECT_LE(10, hour);
+        EXPECT_GE(17, hour);
+    }
+
+    /* Hashed values can be mixed with other values, including days that
+     * depend on the month.
+     */
+
+    EXPECT_EQ(schedule, initScheduleKey(schedule, "0 0 H,L * *", "backup"));
+    EXPECT_EQ(ScheduleShapeGeneral, schedule->mShape);
+    EXPECT_TRUE(schedule->mMonthDays.mLastDay);
+    EXPECT_EQ(1U, queryBitRingPopulation(&schedule->mSchedules[ScheduleDays]));
+
+    /* Identical expressions spread across the hour and the day for
+     * different keys, but the day of the month stays within the days of
+     * every month, and the day of the week stays within the canonical
+     * range.
+     */
+
+    uint64_t minutes = 0;
+    uint64_t hours = 0;
+
+    unsigned aligned = 0;
+
+    for (unsigned kx = 0; kx < 1000; ++kx) {
+        char key[32];
+
+        snprintf(key, sizeof(key), "job-%u", kx);
+
+        EXPECT_EQ(schedule, initScheduleKey(schedule, "H H H * H", key));
+
+        const struct BitRing *minuteRing =
+            &schedule->mSchedules[ScheduleMinutes];
+        const struct BitRing *hourRing =
+            &schedule->mSchedules[ScheduleHours];
+        const struct BitRing *dayRing =
+            &schedule->mSchedules[ScheduleWeekDays];
+
+        EXPECT_EQ(1U, queryBitRingPopulation(minuteRing));
+        EXPECT_EQ(1U, queryBitRingPopulation(hourRing));
+        EXPECT_EQ(1U, queryBitRingPopulation(dayRing));
+
+        minutes |= minuteRing->mRing;
+        hours |= hourRing->mRing;
+
+        /* Fields chosen from the same hash, rather than independently,
+         * would always agree modulo the common factor of their ranges.
+         */
+
+        int minute = __builtin_ctzll(minuteRing->mRing);
+        int hour = __builtin_ctzll(hourRing->mRing);
+
+        if (minute % 12 == hour % 12)
+            ++aligned;
+
+        EXPECT_EQ(schedule, initScheduleKey(schedule, "H * H * *", key));
+
+        const struct BitRing *monthDayRing =
+            &schedule->mSchedules[ScheduleDays];
+
+        EXPECT_EQ(1U, queryBitRingPopulation(monthDayRing));
+        EXPECT_GT(UINT64_C(1) << 28, monthDayRing->mRing);
+    }
+
+    EXPECT_EQ((UINT64_C(1) << 60) - 1, minutes);
+    EXPECT_EQ((UINT64_C(1) << 24) - 1, hours);
+    EXPECT_GT(200U, aligned);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -0,0 +1,189 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "schedulecache.h"
+
+#include "macros.h"
+
+#include "gtest/gtest.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+class ScheduleCacheTest : public ::testing::Test
+{
+    void SetUp()
+    {
+        strcpy(mDir, "/tmp/schedulecache.XXXXXX");
+        ASSERT_TRUE(mkdtemp(mDir));
+
+        snprintf(mPath, sizeof(mPath), "%s/cache", mDir);
+    }
+
+    void TearDown()
+    {
+        unlink(mPath);
+        rmdir(mDir);
+    }
+
+protected:
+
+    char mDir[64];
+    char mPath[128];
+};
+
+/* -------------------------------------------------------------------------- */
+static const char *Schedules[] = {
+    "* * * * *",
+    "*/15 * * * *",
+    "0,15,30,45 * * * *",
+    "30 2 * * *",
+    "0 9-17 * * 1-5",
+    "0 0 29 2 *",
+    "59 23 31 12 7",
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCacheTest, Empty)
+{
+    struct ScheduleCache cache_, *cache = &cache_;
+
+    EXPECT_EQ(0, writeScheduleCache(mPath, Schedules, 0));
+
+    EXPECT_EQ(cache, initScheduleCache(cache, mPath));
+    EXPECT_EQ(0u, cache->mLength);
+    EXPECT_TRUE(matchScheduleCache(cache, Schedules, 0));
+    EXPECT_FALSE(matchScheduleCache(cache, Schedules, 1));
+
+    closeScheduleCache(cache);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCacheTest, Entries)
+{
+    struct ScheduleCache cache_, *cache = &cache_;
+
+    EXPECT_EQ(0, writeScheduleCache(mPath, Schedules, NUMBEROF(Schedules)));
+
+    EXPECT_EQ(cache, initScheduleCache(cache, mPath));
+    EXPECT_EQ(NUMBEROF(Schedules), cache->mLength);
+
+    for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+        struct Schedule schedule;
+        struct SchedulePack expected, actual;
+
+        EXPECT_EQ(&schedule, initSchedule(&schedule, Schedules[sx]));
+        EXPECT_EQ(&expected, initSchedulePack(&expected, &schedule));
+
+        EXPECT_EQ(&actual, queryScheduleCachePack(cache, sx, &actual));
+        EXPECT_EQ(0, memcmp(&expected, &actual, sizeof(actual)))
+            << Schedules[sx];
+    }
+
+    struct SchedulePack pack;
+
+    errno = 0;
+    EXPECT_FALSE(queryScheduleCachePack(cache, NUMBEROF(Schedules), &pack));
+    EXPECT_EQ(EINVAL, errno);
+
+    /* The cache is current only for the expressions that produced it. */
+
+    const char *schedules[NUMBEROF(Schedules)];
+
+    memcpy(schedules, Schedules, sizeof(schedules));
+
+    EXPECT_TRUE(matchScheduleCache(cache, schedules, NUMBEROF(schedules)));
+    EXPECT_FALSE(matchScheduleCache(cache, schedules, NUMBEROF(schedules)-1));
+
+    schedules[2] = "0-45/15 * * * *";
+    EXPECT_FALSE(matchScheduleCache(cache, schedules, NUMBEROF(schedules)));
+
+    closeScheduleCache(cache);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCacheTest, Invalid)
+{
+    struct ScheduleCache cache_, *cache = &cache_;
+
+    static const char *Invalid[] = { "* * * *" };
+
+    errno = 0;
+    EXPECT_EQ(-1, writeScheduleCache(mPath, Invalid, NUMBEROF(Invalid)));
+    EXPECT_EQ(EINVAL, errno);
+
+    errno = 0;
+    EXPECT_FALSE(initScheduleCache(cache, mPath));
+    EXPECT_EQ(ENOENT, errno);
+
+    EXPECT_EQ(0, writeScheduleCache(mPath, Schedules, NUMBEROF(Schedules)));
+
+    size_t size =
+        sizeof(struct ScheduleCacheHeader) +
+        NUMBEROF(Schedules) * sizeof(struct ScheduleCacheEntry);
+
+    /* Each corrupted byte, and each truncation, is detected. */
+
+    for (size_t ix = 0; ix < size; ++ix) {
+
+        int fd = open(mPath, O_RDWR);
+        EXPECT_NE(-1, fd);
+
+        unsigned char byte;
+        EXPECT_EQ(1, pread(fd, &byte, 1, ix));
+
+        unsigned char corrupt = byte ^ 0x01;
+        EXPECT_EQ(1, pwrite(fd, &corrupt, 1, ix));
+
+        errno = 0;
+        EXPECT_FALSE(initScheduleCache(cache, mPath)) << ix;
+        EXPECT_EQ(EINVAL, errno);
+
+        EXPECT_EQ(1, pwrite(fd, &byte, 1, ix));
+        EXPECT_EQ(0, close(fd));
+    }
+
+    for (size_t ix = 0; ix < size; ix += 8) {
+        EXPECT_EQ(0, truncate(mPath, ix));
+
+        errno = 0;
+        EXPECT_FALSE(initScheduleCache(cache, mPath)) << ix;
+        EXPECT_EQ(EINVAL, errno);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
@@ -0,0 +1,289 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "schedulecomposite.h"
+
+#include "civiltime.h"
+#include "macros.h"
+
+#include "gtest/gtest.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <vector>
+
+/* -------------------------------------------------------------------------- */
+class ScheduleCompositeTest : public ::testing::Test
+{
+    void SetUp()
+    {
+        static char TZ[] = "TZ=US/Pacific";
+
+        putenv(TZ);
+    }
+};
+
+/* -------------------------------------------------------------------------- */
+static const char *Composites[] = {
+    "* * * * *",
+    "!* * * * *",
+    "*/15 * * * * & * 1-3 * * *",
+    "*/15 * * * * | 30 2 * * *",
+    "* 9-17 * * 1-5 & !* 12 * * *",
+    "!(0 * * * * | 30 * * * *)",
+    "!0 * * * * & !30 * * * *",
+    "0,30 * * * * & !30 1 * * *",
+    "0 0 * * 0 | 0 0 1 * * & !0 0 * 10 *",
+    "(0 0 * * 0 | 0 0 1 * *) & !0 0 * 10 *",
+    "*/7 * * * * & */11 * * * *",
+    "* 2 * * * & !30-59 * * * *",
+    "30 1 * * * & * * 29 10 *",
+    "0 0 29 2 * & * * * * 1",
+    "0 0 * * * & !* * * * *",
+    "!!  5   4 * * *  ",
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCompositeTest, Parse)
+{
+    struct ScheduleComposite composite_, *composite = &composite_;
+
+    for (size_t cx = 0; cx < NUMBEROF(Composites); ++cx) {
+        EXPECT_EQ(composite, initScheduleComposite(composite, Composites[cx]))
+            << Composites[cx];
+        closeScheduleComposite(composite);
+    }
+
+    static const char *Invalid[] = {
+        "",
+        "!",
+        "()",
+        "* * * *",
+        "* * * * * &",
+        "& * * * * *",
+        "* * * * * | | * * * * *",
+        "(* * * * *",
+        "* * * * *)",
+        "!(* * * * *) * * * * *",
+        "60 * * * * | * * * * *",
+    };
+
+    for (size_t ix = 0; ix < NUMBEROF(Invalid); ++ix) {
+        errno = 0;
+        EXPECT_FALSE(initScheduleComposite(composite, Invalid[ix]))
+            << Invalid[ix];
+        EXPECT_EQ(EINVAL, errno) << Invalid[ix];
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCompositeTest, Match)
+{
+    struct ScheduleComposite composite_, *composite = &composite_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Mon Oct 23 12:15:00 PDT 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 972328500));
+
+    static const struct {
+        const char *mComposite;
+        int mMatch;
+    } Matches[] = {
+        { "* * * * *", 1 },
+        { "!* * * * *", 0 },
+        { "* 9-17 * * 1-5 & !* 12 * * *", 0 },
+        { "* 9-17 * * 1-5 & !* 13 * * *", 1 },
+        { "* * * * 0 | 15 12 * * *", 1 },
+        { "* * * * 0 | 16 12 * * *", 0 },
+        { "!(* * * * 0 | 16 12 * * *)", 1 },
+        { "!* * * * 0 & 15 * * * *", 1 },
+    };
+
+    for (size_t mx = 0; mx < NUMBEROF(Matches); ++mx) {
+        EXPECT_EQ(
+            composite, initScheduleComposite(composite, Matches[mx].mComposite));
+        EXPECT_EQ(
+            Matches[mx].mMatch, matchScheduleComposite(composite, civilTime))
+            << Matches[mx].mComposite;
+        closeScheduleComposite(composite);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCompositeTest, Query)
+{
+    struct ScheduleComposite composite_, *composite = &composite_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Each minute across the spring and fall daylight savings changes
+     * finds the same occurrence as stepping minute by minute, or fails
+     * if there is no occurrence within the horizon.
+     */
+
+    /* Sun Apr  2 00:00:00 PST 2000 */
+    /* Sun Oct 29 00:00:00 PDT 2000 */
+    static const time_t Times[] = { 954662400, 972802800 };
+
+    static const time_t Minutes = 4 * 60;
+    static const time_t Horizon = 12 * 60;
+
+    for (size_t cx = 0; cx < NUMBEROF(Composites); ++cx) {
+        EXPECT_EQ(composite, initScheduleComposite(composite, Composites[cx]));
+
+        for (size_t tx = 0; tx < NUMBEROF(Times); ++tx) {
+
+            std::vector<int> matches(Minutes + Horizon + 1);
+
+            for (size_t ix = 0; ix < matches.size(); ++ix) {
+                time_t time = Times[tx] + 60 * ix;
+
+                EXPECT_EQ(civilTime, initCivilTime(civilTime, time));
+                matches[ix] = matchScheduleComposite(composite, civilTime);
+            }
+
+            for (time_t ix = 0; ix < Minutes; ++ix) {
+                time_t time = Times[tx] + 60 * ix;
+
+                time_t expected = -1;
+                for (time_t jx = ix; jx <= ix + Horizon; ++jx) {
+                    if (matches[jx]) {
+                        expected = Times[tx] + 60 * jx;
+                        break;
+                    }
+                }
+
+                EXPECT_EQ(civilTime, initCivilTime(civilTime, time));
+
+                errno = 0;
+                EXPECT_EQ(
+                    expected,
+                    queryScheduleComposite(composite, civilTime, 60 * Horizon))
+                    << Composites[cx] << " " << time;
+                if (-1 == expected)
+                    EXPECT_EQ(ENOENT, errno) << Composites[cx] << " " << time;
+            }
+        }
+
+        closeScheduleComposite(composite);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCompositeTest, Unlimited)
+{
+    struct ScheduleComposite composite_, *composite = &composite_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
+
+    /* The next leap day that falls on a Monday is far in the future,
+     * but is found with an unlimited horizon.
+     */
+
+    EXPECT_EQ(
+        composite, initScheduleComposite(composite, "0 0 29 2 * & 0 0 * * 1"));
+
+    /* Mon Feb 29 00:00:00 PST 2016 */
+    EXPECT_EQ(1456732800, queryScheduleComposite(composite, civilTime, 0));
+
+    errno = 0;
+    EXPECT_EQ(-1, queryScheduleComposite(composite, civilTime, -1));
+    EXPECT_EQ(EINVAL, errno);
+
+    closeScheduleComposite(composite);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCompositeTest, SpringDST)
+{
+    struct ScheduleComposite composite_, *composite = &composite_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Sun Apr  1 01:01:00 PST 2001 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 986115660));
+
+    /* The hour skipped by the spring change is matched by 0 3 * * *
+     * at 03:00 PDT, so the negation excludes that occurrence.
+     */
+
+    EXPECT_EQ(
+        composite, initScheduleComposite(composite, "0 * * * * & !0 3 * * *"));
+
+    /* Sun Apr  1 04:00:00 PDT 2001 */
+    EXPECT_EQ(986122800, queryScheduleComposite(composite, civilTime, 0));
+
+    closeScheduleComposite(composite);
+
+    EXPECT_EQ(
+        composite, initScheduleComposite(composite, "0 * * * * & !0 2 * * *"));
+
+    /* Sun Apr  1 04:00:00 PDT 2001 */
+    EXPECT_EQ(986122800, queryScheduleComposite(composite, civilTime, 0));
+
+    closeScheduleComposite(composite);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCompositeTest, LongNot)
+{
+    struct ScheduleComposite composite_, *composite = &composite_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Mon Jan  1 00:00:00 PST 2001 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 978336000));
+
+    /* The negation does not match for eleven months, which is found
+     * from the months of the schedule rather than minute by minute.
+     */
+
+    EXPECT_EQ(
+        composite,
+        initScheduleComposite(composite, "* * * * * & !* * * 1-11 *"));
+
+    /* Sat Dec  1 00:00:00 PST 2001 */
+    EXPECT_EQ(1007193600, queryScheduleComposite(composite, civilTime, 0));
+
+    errno = 0;
+    EXPECT_EQ(-1, queryScheduleComposite(composite, civilTime, 24 * 60 * 60));
+    EXPECT_EQ(ENOENT, errno);
+
+    closeScheduleComposite(composite);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
@@ -0,0 +1,283 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "schedulecxx.h"
+
+#include "gtest/gtest.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <new>
+
+/* -------------------------------------------------------------------------- */
+/* Count allocations so that the tests can verify that stepping through
+ * occurrences does not allocate.
+ */
+
+static unsigned long Allocations;
+
+void *
+operator new(std::size_t aSize)
+{
+    ++Allocations;
+
+    void *ptr = malloc(aSize ? aSize : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void
+operator delete(void *aPtr) noexcept
+{
+    free(aPtr);
+}
+
+void
+operator delete(void *aPtr, std::size_t) noexcept
+{
+    free(aPtr);
+}
+
+/* -------------------------------------------------------------------------- */
+class ScheduleCxxTest : public ::testing::Test
+{
+    void SetUp()
+    {
+        static char TZ[] = "TZ=US/Pacific";
+
+        putenv(TZ);
+    }
+
+protected:
+
+    static crontime::Seconds seconds_(time_t aTime)
+    {
+        return crontime::Seconds(std::chrono::seconds(aTime));
+    }
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCxxTest, Schedule)
+{
+    crontime::CronSchedule schedule("30 1 * * *");
+
+    struct Schedule expected;
+
+    EXPECT_EQ(&expected, initSchedule(&expected, "30 1 * * *"));
+    EXPECT_EQ(
+        expected.mSchedules[ScheduleHours].mRing,
+        schedule.schedule().mSchedules[ScheduleHours].mRing);
+
+    crontime::CronSchedule copy(std::string("30 1 * * *"));
+
+    EXPECT_EQ(
+        copy.schedule().mSchedules[ScheduleMinutes].mRing,
+        schedule.schedule().mSchedules[ScheduleMinutes].mRing);
+
+    try {
+        crontime::CronSchedule invalid("30 1 * *");
+        ADD_FAILURE();
+    } catch (const std::system_error &exc) {
+        EXPECT_EQ(EINVAL, exc.code().value());
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCxxTest, Next)
+{
+    crontime::CronSchedule schedule("30 1 * * *");
+
+    /* Sun Oct 29 00:00:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PDT 2000 */
+    EXPECT_EQ(seconds_(972808200), schedule.next(seconds_(972802800)));
+
+    /* Sun Oct 29 00:00:01 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PDT 2000 */
+    EXPECT_EQ(seconds_(972808200), schedule.next(seconds_(972802801)));
+
+    EXPECT_TRUE(schedule.match(seconds_(972808200)));
+    EXPECT_FALSE(schedule.match(seconds_(972808201)));
+    EXPECT_FALSE(schedule.match(seconds_(972808260)));
+
+    try {
+        schedule.next(seconds_(972802800), std::chrono::seconds(60));
+        ADD_FAILURE();
+    } catch (const std::system_error &exc) {
+        EXPECT_EQ(ENOENT, exc.code().value());
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCxxTest, Occurrences)
+{
+    static const char *Schedules[] = {
+        "30 1 * * *",
+        "*/15 1-3 * * *",
+        "0 0 29 2 *",
+    };
+
+    /* Sat Oct 28 22:00:00 PDT 2000 */
+    time_t since = 972795600;
+
+    for (size_t sx = 0; sx < sizeof(Schedules)/sizeof(Schedules[0]); ++sx) {
+
+        crontime::CronSchedule schedule(Schedules[sx]);
+
+        struct CivilTime civilTime;
+        struct ScheduleIterator iterator;
+
+        EXPECT_EQ(&civilTime, initCivilTime(&civilTime, since));
+        EXPECT_EQ(
+            &iterator,
+            initScheduleIterator(&iterator, &schedule.schedule(), &civilTime));
+
+        crontime::Occurrences occurrences =
+            schedule.occurrences(seconds_(since));
+
+        unsigned long allocations = Allocations;
+
+        int count = 0;
+
+        for (crontime::Seconds scheduled : occurrences) {
+            EXPECT_EQ(
+                nextScheduleOccurrence(&iterator),
+                scheduled.time_since_epoch().count()) << Schedules[sx];
+            if (++count == 20)
+                break;
+        }
+
+        EXPECT_EQ(20, count);
+        EXPECT_EQ(allocations, Allocations);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCxxTest, Horizon)
+{
+    crontime::CronSchedule schedule("30 1 * * *");
+
+    /* Sat Oct 28 22:00:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PST 2000 */
+    /* Mon Oct 30 01:30:00 PST 2000 */
+    crontime::Occurrences occurrences = schedule.occurrences(
+        seconds_(972795600), std::chrono::seconds(2 * 24 * 60 * 60));
+
+    crontime::Occurrences::iterator it = occurrences.begin();
+
+    EXPECT_TRUE(it != occurrences.end());
+    EXPECT_EQ(seconds_(972808200), *it++);
+    EXPECT_TRUE(it != occurrences.end());
+    EXPECT_EQ(seconds_(972898200), *it);
+    EXPECT_TRUE(++it == occurrences.end());
+
+    /* A schedule that never occurs is bounded by the horizon. */
+
+    crontime::CronSchedule never("0 0 30 2 *");
+
+    crontime::Occurrences none = never.occurrences(
+        seconds_(972795600), std::chrono::seconds(366 * 24 * 60 * 60));
+
+    EXPECT_TRUE(none.begin() == none.end());
+
+    crontime::Occurrences empty;
+
+    EXPECT_TRUE(empty.begin() == empty.end());
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleCxxTest, Seconds)
+{
+    /* A schedule that selects seconds is searched from the specified
+     * second, rather than from the start of the next minute.
+     */
+
+    crontime::CronSchedule schedule("*/10 * * * * *");
+
+    /* Sat Sep  8 18:46:45 PDT 2001 */
+    EXPECT_EQ(seconds_(1000000010), schedule.next(seconds_(1000000005)));
+    EXPECT_EQ(seconds_(1000000010), schedule.next(seconds_(1000000010)));
+    EXPECT_EQ(seconds_(1000000020), schedule.next(seconds_(1000000011)));
+
+    EXPECT_TRUE(schedule.match(seconds_(1000000010)));
+    EXPECT_FALSE(schedule.match(seconds_(1000000011)));
+
+    crontime::Occurrences occurrences =
+        schedule.occurrences(seconds_(1000000005));
+
+    crontime::Occurrences::iterator it = occurrences.begin();
+
+    EXPECT_EQ(seconds_(1000000010), *it++);
+    EXPECT_EQ(seconds_(1000000020), *it++);
+    EXPECT_EQ(seconds_(1000000030), *it);
+}
+
+/* -------------------------------------------------------------------------- */
+#if __cplusplus >= 202002L
+TEST_F(ScheduleCxxTest, Views)
+{
+    crontime::CronSchedule schedule("*/15 * * * *");
+
+    static_assert(std::ranges::input_range<crontime::Occurrences>);
+    static_assert(std::ranges::view<crontime::Occurrences>);
+
+    /* Sat Oct 28 22:00:00 PDT 2000 */
+    std::chrono::sys_seconds since = seconds_(972795600);
+
+    int count = 0;
+
+    for (std::chrono::sys_seconds scheduled :
+            schedule.occurrences(since) | std::views::take(4)) {
+        EXPECT_EQ(since + std::chrono::minutes(15 * count++), scheduled);
+    }
+
+    EXPECT_EQ(4, count);
+
+    count = 0;
+
+    for (std::chrono::sys_seconds scheduled :
+            schedule.occurrences(since) |
+            std::views::take_while(
+                [since](std::chrono::sys_seconds aScheduled) {
+                    return aScheduled < since + std::chrono::hours(1);
+                })) {
+        EXPECT_EQ(since + std::chrono::minutes(15 * count++), scheduled);
+    }
+
+    EXPECT_EQ(4, count);
+}
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
@@ -0,0 +1,208 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "scheduleexclusion.h"
+
+#include "macros.h"
+
+#include "gtest/gtest.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+TEST(ScheduleExclusionTest, Date)
+{
+    struct ScheduleExclusion exclusion_, *exclusion = &exclusion_;
+
+    EXPECT_EQ(exclusion, initScheduleExclusion(exclusion));
+    EXPECT_EQ(0u, exclusion->mLength);
+
+    EXPECT_EQ(-1, addScheduleExclusionDate(exclusion, 0, 1, 1));
+    EXPECT_EQ(EINVAL, errno);
+    EXPECT_EQ(-1, addScheduleExclusionDate(exclusion, 2000, 0, 1));
+    EXPECT_EQ(EINVAL, errno);
+    EXPECT_EQ(-1, addScheduleExclusionDate(exclusion, 2000, 13, 1));
+    EXPECT_EQ(EINVAL, errno);
+    EXPECT_EQ(-1, addScheduleExclusionDate(exclusion, 2000, 1, 0));
+    EXPECT_EQ(EINVAL, errno);
+    EXPECT_EQ(-1, addScheduleExclusionDate(exclusion, 2000, 4, 31));
+    EXPECT_EQ(EINVAL, errno);
+    EXPECT_EQ(-1, addScheduleExclusionDate(exclusion, 2001, 2, 29));
+    EXPECT_EQ(EINVAL, errno);
+    EXPECT_EQ(-1, addScheduleExclusionDate(exclusion, 1900, 2, 29));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_EQ(0u, exclusion->mLength);
+
+    /* Years are kept in order regardless of the order of the dates. */
+
+    EXPECT_EQ(0, addScheduleExclusionDate(exclusion, 2000, 2, 29));
+    EXPECT_EQ(0, addScheduleExclusionDate(exclusion, 1999, 12, 31));
+    EXPECT_EQ(0, addScheduleExclusionDate(exclusion, 2001, 1, 1));
+    EXPECT_EQ(0, addScheduleExclusionDate(exclusion, 2000, 1, 1));
+    EXPECT_EQ(0, addScheduleExclusionDate(exclusion, 2000, 1, 1));
+
+    EXPECT_EQ(3u, exclusion->mLength);
+    EXPECT_EQ(1999, exclusion->mYears[0].mYear);
+    EXPECT_EQ(2000, exclusion->mYears[1].mYear);
+    EXPECT_EQ(2001, exclusion->mYears[2].mYear);
+
+    EXPECT_EQ(0x40000000u, queryScheduleExclusionMonth(exclusion, 1999, 12));
+    EXPECT_EQ(0x10000000u, queryScheduleExclusionMonth(exclusion, 2000, 2));
+    EXPECT_EQ(0x00000001u, queryScheduleExclusionMonth(exclusion, 2000, 1));
+    EXPECT_EQ(0u, queryScheduleExclusionMonth(exclusion, 2000, 3));
+    EXPECT_EQ(0u, queryScheduleExclusionMonth(exclusion, 2002, 1));
+    EXPECT_EQ(0u, queryScheduleExclusionMonth(exclusion, 2000, 0));
+
+    EXPECT_TRUE(matchScheduleExclusion(exclusion, 2000, 2, 29));
+    EXPECT_TRUE(matchScheduleExclusion(exclusion, 1999, 12, 31));
+    EXPECT_FALSE(matchScheduleExclusion(exclusion, 2000, 2, 28));
+    EXPECT_FALSE(matchScheduleExclusion(exclusion, 1998, 12, 31));
+    EXPECT_FALSE(matchScheduleExclusion(exclusion, 2000, 1, 0));
+    EXPECT_FALSE(matchScheduleExclusion(exclusion, 2000, 1, 32));
+
+    closeScheduleExclusion(exclusion);
+    EXPECT_EQ(0u, exclusion->mLength);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST(ScheduleExclusionTest, Dates)
+{
+    struct ScheduleExclusion exclusion_, *exclusion = &exclusion_;
+
+    EXPECT_EQ(exclusion, initScheduleExclusion(exclusion));
+
+    static const char *Invalid[] = {
+        "",
+        "2000",
+        "2000-1-1",
+        "2000-01-1",
+        "2000-01-01 ",
+        "2000-01-32",
+        "2000-02-30",
+        "2000/01/01",
+        "2000-01-01..",
+        "2000-01-01..2000-01",
+        "2000-01-02..2000-01-01",
+        "2000-01-01...2000-01-02",
+    };
+
+    for (unsigned ix = 0; ix < NUMBEROF(Invalid); ++ix) {
+        errno = 0;
+        EXPECT_EQ(-1, addScheduleExclusionDates(exclusion, Invalid[ix]))
+            << Invalid[ix];
+        EXPECT_EQ(EINVAL, errno) << Invalid[ix];
+    }
+
+    EXPECT_EQ(0u, exclusion->mLength);
+
+    EXPECT_EQ(0, addScheduleExclusionDates(exclusion, "2000-07-04"));
+    EXPECT_EQ(0x00000008u, queryScheduleExclusionMonth(exclusion, 2000, 7));
+
+    /* Ranges are inclusive, and cross the ends of months and years. */
+
+    EXPECT_EQ(0, addScheduleExclusionDates(
+        exclusion, "2000-12-24..2001-01-02"));
+    EXPECT_EQ(0x7f800000u, queryScheduleExclusionMonth(exclusion, 2000, 12));
+    EXPECT_EQ(0x00000003u, queryScheduleExclusionMonth(exclusion, 2001, 1));
+
+    EXPECT_EQ(0, addScheduleExclusionDates(
+        exclusion, "2004-02-28..2004-03-01"));
+    EXPECT_EQ(0x18000000u, queryScheduleExclusionMonth(exclusion, 2004, 2));
+    EXPECT_EQ(0x00000001u, queryScheduleExclusionMonth(exclusion, 2004, 3));
+
+    EXPECT_EQ(0, addScheduleExclusionDates(
+        exclusion, "2005-06-01..2005-06-01"));
+    EXPECT_EQ(0x00000001u, queryScheduleExclusionMonth(exclusion, 2005, 6));
+
+    EXPECT_EQ(4u, exclusion->mLength);
+
+    closeScheduleExclusion(exclusion);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST(ScheduleExclusionTest, Read)
+{
+    struct ScheduleExclusion exclusion_, *exclusion = &exclusion_;
+
+    char calendar[] =
+        "# Holidays\n"
+        "\n"
+        "2000-01-17\n"
+        "  2000-02-21  \n"
+        "\t2000-12-25..2000-12-26\n"
+        "2000-05-29";
+
+    FILE *file = fmemopen(calendar, strlen(calendar), "r");
+    EXPECT_TRUE(file);
+
+    unsigned long lineNo = 1;
+
+    EXPECT_EQ(exclusion, initScheduleExclusion(exclusion));
+    EXPECT_EQ(0, readScheduleExclusion(exclusion, file, &lineNo));
+    EXPECT_EQ(0u, lineNo);
+
+    fclose(file);
+
+    EXPECT_EQ(1u, exclusion->mLength);
+    EXPECT_TRUE(matchScheduleExclusion(exclusion, 2000, 1, 17));
+    EXPECT_TRUE(matchScheduleExclusion(exclusion, 2000, 2, 21));
+    EXPECT_TRUE(matchScheduleExclusion(exclusion, 2000, 5, 29));
+    EXPECT_TRUE(matchScheduleExclusion(exclusion, 2000, 12, 25));
+    EXPECT_TRUE(matchScheduleExclusion(exclusion, 2000, 12, 26));
+    EXPECT_FALSE(matchScheduleExclusion(exclusion, 2000, 12, 27));
+
+    closeScheduleExclusion(exclusion);
+
+    /* The line of the first date that cannot be parsed is reported. */
+
+    char invalid[] =
+        "2000-01-17\n"
+        "\n"
+        "2000-01-17 # Holiday\n";
+
+    file = fmemopen(invalid, strlen(invalid), "r");
+    EXPECT_TRUE(file);
+
+    EXPECT_EQ(exclusion, initScheduleExclusion(exclusion));
+    errno = 0;
+    EXPECT_EQ(-1, readScheduleExclusion(exclusion, file, &lineNo));
+    EXPECT_EQ(EINVAL, errno);
+    EXPECT_EQ(3u, lineNo);
+
+    fclose(file);
+
+    closeScheduleExclusion(exclusion);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
@@ -0,0 +1,335 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "scheduleindex.h"
+
+#include "civiltime.h"
+#include "macros.h"
+
+#include "gtest/gtest.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+/* -------------------------------------------------------------------------- */
+class ScheduleIndexTest : public ::testing::Test
+{
+    void SetUp()
+    {
+        static char TZ[] = "TZ=US/Pacific";
+
+        putenv(TZ);
+    }
+
+protected:
+
+    static int matchScheduleIndexJob_(
+        const struct ScheduleIndex *aIndex,
+        const ScheduleIndexT *aMatches,
+        size_t aJob) {
+
+        size_t bits = sizeof(*aMatches) * 8;
+
+        return aJob / bits < aIndex->mWords &&
+            !! (aMatches[aJob / bits] & ((ScheduleIndexT) 1 << aJob % bits));
+    }
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleIndexTest, AddRemove)
+{
+    struct ScheduleIndex index_, *index = &index_;
+
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    EXPECT_EQ(index, initScheduleIndex(index));
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 * * *"));
+    EXPECT_EQ(0, addScheduleIndexJob(index, 1000, schedule));
+
+    const ScheduleIndexT *matches = matchScheduleIndex(index, civilTime);
+    EXPECT_TRUE(matchScheduleIndexJob_(index, matches, 1000));
+    EXPECT_FALSE(matchScheduleIndexJob_(index, matches, 999));
+
+    /* Replacing the schedule of a job removes the previous schedule. */
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 1 * * *"));
+    EXPECT_EQ(0, addScheduleIndexJob(index, 1000, schedule));
+
+    matches = matchScheduleIndex(index, civilTime);
+    EXPECT_FALSE(matchScheduleIndexJob_(index, matches, 1000));
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "* * * * *"));
+    EXPECT_EQ(0, addScheduleIndexJob(index, 1000, schedule));
+    EXPECT_EQ(0, addScheduleIndexJob(index, 3, schedule));
+
+    matches = matchScheduleIndex(index, civilTime);
+    EXPECT_TRUE(matchScheduleIndexJob_(index, matches, 1000));
+    EXPECT_TRUE(matchScheduleIndexJob_(index, matches, 3));
+
+    removeScheduleIndexJob(index, 1000);
+    removeScheduleIndexJob(index, 5000);
+
+    matches = matchScheduleIndex(index, civilTime);
+    EXPECT_FALSE(matchScheduleIndexJob_(index, matches, 1000));
+    EXPECT_TRUE(matchScheduleIndexJob_(index, matches, 3));
+
+    closeScheduleIndex(index);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleIndexTest, Match)
+{
+    struct ScheduleIndex index_, *index = &index_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    static const char *Schedules[] = {
+        "* * * * *",
+        "30 1 * * *",
+        "30 * * * *",
+        "*/15 1-3 * * *",
+        "0 0 1 * *",
+        "0 0 * * 0",
+        "0 0 1 * 0",
+        "0,30 * 29 10 *",
+        "0,30 * * 10 0",
+        "0 0-23 * * 1-5",
+        "5 4 * 4 *",
+        "5 4 2-3 * *",
+        "0 3 * * *",
+        "30 3 2 4 *",
+    };
+
+    struct Schedule schedules[NUMBEROF(Schedules)];
+
+    EXPECT_EQ(index, initScheduleIndex(index));
+
+    for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+        EXPECT_EQ(&schedules[sx], initSchedule(&schedules[sx], Schedules[sx]));
+        EXPECT_EQ(0, addScheduleIndexJob(index, sx * 7, &schedules[sx]));
+    }
+
+    /* Each minute around the spring and fall daylight savings changes
+     * matches the same jobs as matching each schedule separately.
+     */
+
+    /* Sat Apr  1 22:00:00 PST 2000 */
+    /* Sat Oct 28 22:00:00 PDT 2000 */
+    static const time_t Times[] = { 954655200, 972795600 };
+
+    for (size_t tx = 0; tx < NUMBEROF(Times); ++tx) {
+        for (time_t time = Times[tx];
+                time < Times[tx] + 8 * 60 * 60; time += 60) {
+
+            EXPECT_EQ(civilTime, initCivilTime(civilTime, time));
+
+            const ScheduleIndexT *matches =
+                matchScheduleIndex(index, civilTime);
+
+            for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+                EXPECT_EQ(
+                    matchSchedule(&schedules[sx], civilTime),
+                    matchScheduleIndexJob_(index, matches, sx * 7))
+                    << Schedules[sx] << " " << time;
+            }
+        }
+    }
+
+    /* The hour skipped by spring forward matches the local time that
+     * actually applies. Sun Apr  2 03:00:00 PDT 2000
+     */
+
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 954669600));
+    EXPECT_TRUE(matchScheduleIndexJob_(
+        index, matchScheduleIndex(index, civilTime), 12 * 7));
+
+    closeScheduleIndex(index);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleIndexTest, Candidates)
+{
+    struct ScheduleIndex index_, *index = &index_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    static const char *Schedules[] = {
+        "* * * * *",
+        "30 1 * * *",
+        "30 * * * *",
+        "0 * * * *",
+        "*/15 1-3 * * *",
+        "0 0 1 * *",
+        "0 0 2 * *",
+        "0 0 * * 0",
+        "0 0 * * 1",
+        "0 0 1 * 0",
+        "0,30 * 29 10 *",
+        "0,30 * * 10 0",
+        "0 0-23 * * 1-5",
+        "5 4 * 4 *",
+        "5 4 * 5 *",
+        "5 4 2-3 * *",
+    };
+
+    struct Schedule schedules[NUMBEROF(Schedules)];
+
+    EXPECT_EQ(index, initScheduleIndex(index));
+
+    for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+        EXPECT_EQ(&schedules[sx], initSchedule(&schedules[sx], Schedules[sx]));
+        EXPECT_EQ(0, addScheduleIndexJob(index, sx, &schedules[sx]));
+    }
+
+    /* Every pair of schedules that collides within the next week is
+     * a candidate, and schedules that cannot share a minute, hour, or
+     * day are not candidates.
+     */
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
+
+    ScheduleIndexT candidates[1];
+
+    size_t pruned = 0;
+
+    for (size_t lx = 0; lx < NUMBEROF(Schedules); ++lx) {
+
+        size_t population = queryScheduleIndexCandidates(
+            index, &schedules[lx], candidates);
+
+        size_t members = 0;
+
+        for (size_t rx = 0; rx < NUMBEROF(Schedules); ++rx) {
+            int candidate = matchScheduleIndexJob_(index, candidates, rx);
+
+            members += candidate;
+
+            if (!candidate) {
+                ++pruned;
+
+                errno = 0;
+                EXPECT_EQ(-1, queryScheduleCollision(
+                    &schedules[lx], &schedules[rx],
+                    civilTime, 7 * 24 * 60 * 60))
+                    << Schedules[lx] << " " << Schedules[rx];
+                EXPECT_EQ(ENOENT, errno);
+            }
+        }
+
+        EXPECT_EQ(members, population);
+        EXPECT_TRUE(matchScheduleIndexJob_(index, candidates, lx));
+    }
+
+    EXPECT_LT(0u, pruned);
+
+    static const struct {
+        size_t mLhs;
+        size_t mRhs;
+    } Pruned[] = {
+        { 2, 3 },   /* 30 * * * *, 0 * * * * */
+        { 5, 6 },   /* 0 0 1 * *, 0 0 2 * * */
+        { 7, 8 },   /* 0 0 * * 0, 0 0 * * 1 */
+        { 13, 14 }, /* 5 4 * 4 *, 5 4 * 5 * */
+    };
+
+    for (size_t px = 0; px < NUMBEROF(Pruned); ++px) {
+        queryScheduleIndexCandidates(
+            index, &schedules[Pruned[px].mLhs], candidates);
+        EXPECT_FALSE(
+            matchScheduleIndexJob_(index, candidates, Pruned[px].mRhs))
+            << Schedules[Pruned[px].mLhs] << " " << Schedules[Pruned[px].mRhs];
+    }
+
+    closeScheduleIndex(index);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleIndexTest, CandidatesMonthDays)
+{
+    struct ScheduleIndex index_, *index = &index_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* A schedule that selects days by the month days can fall on any
+     * day, so it is a candidate for jobs of every day of the month,
+     * and of every day of the week.
+     */
+
+    static const char *Schedules[] = {
+        "0 0 15 * 5#3",
+        "0 0 17 * *",
+        "0 0 * * 1",
+        "0 0 L * *",
+        "0 1 17 * *",
+    };
+
+    struct Schedule schedules[NUMBEROF(Schedules)];
+
+    EXPECT_EQ(index, initScheduleIndex(index));
+
+    for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+        EXPECT_EQ(&schedules[sx], initSchedule(&schedules[sx], Schedules[sx]));
+        EXPECT_EQ(0, addScheduleIndexJob(index, sx, &schedules[sx]));
+    }
+
+    ScheduleIndexT candidates[1];
+
+    EXPECT_EQ(4u, queryScheduleIndexCandidates(
+        index, &schedules[0], candidates));
+    EXPECT_TRUE(matchScheduleIndexJob_(index, candidates, 1));
+    EXPECT_TRUE(matchScheduleIndexJob_(index, candidates, 2));
+    EXPECT_TRUE(matchScheduleIndexJob_(index, candidates, 3));
+    EXPECT_FALSE(matchScheduleIndexJob_(index, candidates, 4));
+
+    EXPECT_EQ(4u, queryScheduleIndexCandidates(
+        index, &schedules[3], candidates));
+    EXPECT_TRUE(matchScheduleIndexJob_(index, candidates, 0));
+    EXPECT_TRUE(matchScheduleIndexJob_(index, candidates, 1));
+    EXPECT_TRUE(matchScheduleIndexJob_(index, candidates, 2));
+
+    /* Sat Jan  1 00:00:00 PST 2000
+     * Fri Mar 17 00:00:00 PST 2000
+     */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
+    EXPECT_EQ(953280000, queryScheduleCollision(
+        &schedules[0], &schedules[1], civilTime, 366 * 24 * 60 * 60));
+
+    closeScheduleIndex(index);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
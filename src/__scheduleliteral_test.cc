@@ -0,0 +1,280 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "scheduleliteral.h"
+
+#include "macros.h"
+
+#include "gtest/gtest.h"
+
+#include <errno.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+/* Compile time tests corresponding to __bitring_test.cc */
+
+static_assert(!crontime::parseBitRing(1, 7, " *").mValid, "");
+static_assert(!crontime::parseBitRing(1, 7, "*=").mValid, "");
+static_assert(!crontime::parseBitRing(1, 7, "*/").mValid, "");
+static_assert(!crontime::parseBitRing(1, 7, "1/").mValid, "");
+static_assert(!crontime::parseBitRing(1, 7, "-").mValid, "");
+static_assert(!crontime::parseBitRing(1, 7, "8").mValid, "");
+static_assert(!crontime::parseBitRing(1, 7, "0 ").mValid, "");
+
+static_assert(0 == CRONTIME_BITRING(1, 7, "*").mRing, "");
+static_assert(1 == CRONTIME_BITRING(1, 7, "*").mMin, "");
+static_assert(7 == CRONTIME_BITRING(1, 7, "*").mMax, "");
+
+static_assert(0x55 == CRONTIME_BITRING(1, 7, "*/2").mRing, "");
+static_assert(0x1e == CRONTIME_BITRING(1, 7, "2-5").mRing, "");
+static_assert(0x0a == CRONTIME_BITRING(1, 7, "2-5/2").mRing, "");
+static_assert(0x2a == CRONTIME_BITRING(1, 7, "2,4,6").mRing, "");
+static_assert(0x2b == CRONTIME_BITRING(1, 7, "2,4-7/2,1").mRing, "");
+static_assert(0x02 == CRONTIME_BITRING(1, 7, "2,2-3/2,2").mRing, "");
+
+static_assert(
+    (BitRingT) 1 << 63 == CRONTIME_BITRING(1, 64, "64").mRing, "");
+
+/* Compile time schedules */
+
+static_assert(
+    ScheduleShapeMinutes == CRONTIME_SCHEDULE("*/15 * * * *").mShape, "");
+static_assert(
+    ScheduleShapeHours == CRONTIME_SCHEDULE("30 2 * * *").mShape, "");
+static_assert(
+    ScheduleShapeWeekDays == CRONTIME_SCHEDULE("0 9 * * 1-5").mShape, "");
+static_assert(
+    ScheduleShapeGeneral == CRONTIME_SCHEDULE("0 0 29 2 *").mShape, "");
+
+static_assert(
+    1 == CRONTIME_SCHEDULE("0 0 * * 7").mSchedules[ScheduleWeekDays].mRing,
+    "");
+static_assert(
+    0x7f == CRONTIME_SCHEDULE("0 0 * * 0-7").mSchedules[ScheduleWeekDays].mRing,
+    "");
+
+static_assert(!crontime::parseSchedule("").mValid, "");
+static_assert(!crontime::parseSchedule("* * * *").mValid, "");
+static_assert(!crontime::parseSchedule("* * * * * * * *").mValid, "");
+static_assert(!crontime::parseSchedule(" * * * * * *").mValid, "");
+static_assert(!crontime::parseSchedule("60 * * * * *").mValid, "");
+static_assert(!crontime::parseSchedule("* * * * * ").mValid, "");
+static_assert(!crontime::parseSchedule(" * * * * *").mValid, "");
+static_assert(!crontime::parseSchedule("*  * * * *").mValid, "");
+static_assert(!crontime::parseSchedule("60 * * * *").mValid, "");
+static_assert(!crontime::parseSchedule("* * 0 * *").mValid, "");
+static_assert(!crontime::parseSchedule("* * * * 8").mValid, "");
+static_assert(crontime::parseSchedule("*\t*\t*\t*\t*").mValid, "");
+
+/* Optional seconds */
+
+static_assert(
+    0x0fffffffffffffff == CRONTIME_SCHEDULE("* * * * * *").mSeconds.mRing, "");
+static_assert(
+    0x0 == CRONTIME_SCHEDULE("0 * * * * *").mSeconds.mRing, "");
+static_assert(
+    0x0004010040100401 == CRONTIME_SCHEDULE("*/10 0 * * * *").mSeconds.mRing, "");
+
+/* Optional years */
+
+static_assert(
+    0 == CRONTIME_SCHEDULE("0 0 0 1 1 * *").mYears.mRing, "");
+static_assert(
+    0x15 == CRONTIME_SCHEDULE("0 0 0 1 1 * 2030-2034/2").mYears.mRing, "");
+static_assert(
+    2030 == CRONTIME_SCHEDULE("0 0 0 1 1 * 2034,2030").mYears.mMin, "");
+static_assert(
+    ScheduleShapeGeneral == CRONTIME_SCHEDULE("0 * * * * * 2030").mShape, "");
+static_assert(!crontime::parseSchedule("0 0 0 1 1 * 1969").mValid, "");
+static_assert(!crontime::parseSchedule("0 0 0 1 1 * 2000-2064").mValid, "");
+static_assert(!crontime::parseSchedule("0 0 0 1 1 * */2").mValid, "");
+
+/* -------------------------------------------------------------------------- */
+class ScheduleLiteralTest : public ::testing::Test
+{
+protected:
+
+    void testSchedule_(const char *aSchedule)
+    {
+        struct Schedule schedule;
+
+        crontime::ScheduleLiteral literal = crontime::parseSchedule(aSchedule);
+
+        errno = 0;
+        if (!initSchedule(&schedule, aSchedule)) {
+            EXPECT_EQ(EINVAL, errno) << aSchedule;
+            EXPECT_FALSE(literal.mValid) << aSchedule;
+            return;
+        }
+
+        EXPECT_TRUE(literal.mValid) << aSchedule;
+
+        for (unsigned kx = 0; kx < ScheduleKinds; ++kx) {
+            const struct BitRing *lhs = &schedule.mSchedules[kx];
+            const struct BitRing *rhs = &literal.mSchedule.mSchedules[kx];
+
+            EXPECT_EQ(lhs->mRing, rhs->mRing) << aSchedule;
+            EXPECT_EQ(lhs->mMin, rhs->mMin) << aSchedule;
+            EXPECT_EQ(lhs->mMax, rhs->mMax) << aSchedule;
+        }
+
+        EXPECT_EQ(
+            schedule.mSeconds.mRing,
+            literal.mSchedule.mSeconds.mRing) << aSchedule;
+        EXPECT_EQ(
+            schedule.mSeconds.mMin,
+            literal.mSchedule.mSeconds.mMin) << aSchedule;
+        EXPECT_EQ(
+            schedule.mSeconds.mMax,
+            literal.mSchedule.mSeconds.mMax) << aSchedule;
+
+        EXPECT_EQ(
+            schedule.mYears.mRing,
+            literal.mSchedule.mYears.mRing) << aSchedule;
+        EXPECT_EQ(
+            schedule.mYears.mMin,
+            literal.mSchedule.mYears.mMin) << aSchedule;
+        EXPECT_EQ(
+            schedule.mYears.mMax,
+            literal.mSchedule.mYears.mMax) << aSchedule;
+
+        EXPECT_EQ(schedule.mShape, literal.mSchedule.mShape) << aSchedule;
+    }
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleLiteralTest, BitRing)
+{
+    static const char *Memberships[] = {
+        "", "*", "*/", "*/0", "*/1", "*/2", "*/3", "*/7", "*/8", "*/99",
+        "*1", "**", "*-1", "0", "00", "01", "1", "7", "8", "10",
+        "1-", "1-7", "2-5", "5-2", "0-7", "1-8", "2-5/", "2-5/0", "2-5/2",
+        "2-5/02", "2/2", "1,", ",1", "1,,2", "2,4,6", "2,4-7/2,1",
+        "2,2-3/2,2", "1 ", " 1", "1-7/3,2", "99999999999999999999999",
+    };
+
+    for (size_t mx = 0; mx < NUMBEROF(Memberships); ++mx) {
+        struct BitRing bitRing;
+
+        crontime::BitRingLiteral literal =
+            crontime::parseBitRing(1, 7, Memberships[mx]);
+
+        errno = 0;
+        if (!initBitRing(&bitRing, 1, 7, Memberships[mx])) {
+            EXPECT_TRUE(errno) << Memberships[mx];
+            EXPECT_FALSE(literal.mValid) << Memberships[mx];
+            continue;
+        }
+
+        EXPECT_TRUE(literal.mValid) << Memberships[mx];
+        EXPECT_EQ(bitRing.mRing, literal.mBitRing.mRing) << Memberships[mx];
+        EXPECT_EQ(bitRing.mMin, literal.mBitRing.mMin) << Memberships[mx];
+        EXPECT_EQ(bitRing.mMax, literal.mBitRing.mMax) << Memberships[mx];
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleLiteralTest, Schedule)
+{
+    static const char *Schedules[] = {
+        "",
+        "*",
+        "* * * *",
+        "* * * * *",
+        "* * * * * ",
+        " * * * * *",
+        "*  * * * *",
+        "*\t*\t* * *",
+        "* * * * * *",
+        "* * * * * * *",
+        "* * * * * * * *",
+        "0 0 0 1 1 * 2030",
+        "0 0 0 1 1 * 2034,2025-2030/2",
+        "0 0 0 1 1 * 1969",
+        "0 0 0 1 1 * 1970",
+        "0 0 0 1 1 * 2099",
+        "0 0 0 1 1 * 2100",
+        "0 0 0 1 1 * 2000-2063",
+        "0 0 0 1 1 * 2000-2064",
+        "0 0 0 1 1 * 2090-2099",
+        "0 0 0 1 1 * */2",
+        "0 0 0 1 1 * 2030,",
+        "0 0 0 1 1 * 2030 ",
+        "0 * * * * 2030",
+        "0 * * * * *",
+        "*/10 * * * * *",
+        "5,55 0 * * * *",
+        "60 * * * * *",
+        "*/15 * * * *",
+        "0,15,30,45 * * * *",
+        "30 2 * * *",
+        "0 9-17 * * 1-5",
+        "0 0 * * 7",
+        "0 0 * * 0,7",
+        "0 0 * * 0-7",
+        "0 0 * * */2",
+        "0 0 * * 8",
+        "0 0 1 * 0",
+        "0 0 29 2 *",
+        "59 23 31 12 *",
+        "60 * * * *",
+        "* 24 * * *",
+        "* * 0 * *",
+        "* * 32 * *",
+        "* * * 0 *",
+        "* * * 13 *",
+        "1-58 1-22 2-28 2-11 *",
+        "*/7 */5 */3 */2 */4",
+    };
+
+    for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx)
+        testSchedule_(Schedules[sx]);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleLiteralTest, Constant)
+{
+    static constexpr struct Schedule Schedule = CRONTIME_SCHEDULE(
+        "0,30 1-3 15 * 1");
+
+    testSchedule_("0,30 1-3 15 * 1");
+
+    struct Schedule schedule;
+
+    EXPECT_EQ(&schedule, initSchedule(&schedule, "0,30 1-3 15 * 1"));
+    EXPECT_EQ(0, memcmp(
+        schedule.mSchedules,
+        Schedule.mSchedules, sizeof(schedule.mSchedules)));
+    EXPECT_EQ(schedule.mShape, Schedule.mShape);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
@@ -0,0 +1,213 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "schedulepack.h"
+
+#include "civiltime.h"
+#include "macros.h"
+
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+
+/* -------------------------------------------------------------------------- */
+class SchedulePackTest : public ::testing::Test
+{
+    void SetUp()
+    {
+        static char TZ[] = "TZ=US/Pacific";
+
+        putenv(TZ);
+    }
+};
+
+/* -------------------------------------------------------------------------- */
+static const char *Schedules[] = {
+    "* * * * *",
+    "*/1 * * * *",
+    "59 * * * *",
+    "0,31,32,59 * * * *",
+    "30 1 * * *",
+    "30 2 * * *",
+    "30 * * * *",
+    "*/15 1-3 * * *",
+    "0 23 * * *",
+    "0 0 1 * *",
+    "0 0 31 * *",
+    "0 0 * * 0",
+    "0 0 * * 6",
+    "0 0 1 * 0",
+    "0,30 * 29 10 *",
+    "0,30 * * 10 0",
+    "0 0-23 * * 1-5",
+    "5 4 * 4 *",
+    "0 0 29 2 *",
+    "59 23 31 12 *",
+    "1 1-22 2-28 2-11 *",
+    "0 3 * * *",
+    "30 3 2 4 *",
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(SchedulePackTest, Size)
+{
+    EXPECT_EQ(20u, sizeof(struct SchedulePack));
+    EXPECT_GT(sizeof(struct Schedule), 3 * sizeof(struct SchedulePack));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(SchedulePackTest, Schedule)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+    struct Schedule unpacked_, *unpacked = &unpacked_;
+
+    struct SchedulePack pack_, *pack = &pack_;
+
+    for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+        EXPECT_EQ(schedule, initSchedule(schedule, Schedules[sx]));
+
+        EXPECT_EQ(pack, initSchedulePack(pack, schedule));
+        EXPECT_EQ(unpacked, querySchedulePackSchedule(pack, unpacked));
+
+        for (unsigned kx = 0; kx < ScheduleKinds; ++kx) {
+            const struct BitRing *lhs = &schedule->mSchedules[kx];
+            const struct BitRing *rhs = &unpacked->mSchedules[kx];
+
+            EXPECT_EQ(lhs->mRing, rhs->mRing) << Schedules[sx];
+            EXPECT_EQ(lhs->mMin, rhs->mMin) << Schedules[sx];
+            EXPECT_EQ(lhs->mMax, rhs->mMax) << Schedules[sx];
+        }
+
+        EXPECT_EQ(schedule->mShape, unpacked->mShape) << Schedules[sx];
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(SchedulePackTest, Query)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct SchedulePack pack_, *pack = &pack_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Each minute across the spring and fall daylight savings changes
+     * gives the same result for the packed and unpacked schedules.
+     */
+
+    /* Sat Apr  1 22:00:00 PST 2000 */
+    /* Sat Oct 28 22:00:00 PDT 2000 */
+    static const time_t Times[] = { 954655200, 972795600 };
+
+    for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+        EXPECT_EQ(schedule, initSchedule(schedule, Schedules[sx]));
+        EXPECT_EQ(pack, initSchedulePack(pack, schedule));
+
+        for (size_t tx = 0; tx < NUMBEROF(Times); ++tx) {
+            for (time_t ix = 0; ix < 8 * 60; ++ix) {
+                time_t time = Times[tx] + 60 * ix;
+
+                EXPECT_EQ(civilTime, initCivilTime(civilTime, time));
+
+                EXPECT_EQ(
+                    matchSchedule(schedule, civilTime),
+                    matchSchedulePack(pack, civilTime))
+                    << Schedules[sx] << " " << time;
+
+                EXPECT_EQ(
+                    querySchedule(schedule, civilTime, 0, 0, 0),
+                    querySchedulePack(pack, civilTime, 0, 0, 0))
+                    << Schedules[sx] << " " << time;
+            }
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(SchedulePackTest, SpringDST)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct SchedulePack pack_, *pack = &pack_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* The hour skipped by spring forward matches the local time that
+     * actually applies, where the search stops.
+     */
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 3 * * *"));
+    EXPECT_EQ(pack, initSchedulePack(pack, schedule));
+
+    /* Sun Apr  1 01:59:00 PST 2001 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 986119140));
+    EXPECT_EQ(986119200, querySchedulePack(pack, civilTime, 0, 0, 0));
+
+    /* Sun Apr  1 03:00:00 PDT 2001 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 986119200));
+    EXPECT_TRUE(matchSchedulePack(pack, civilTime));
+
+    /* Sun Apr  1 03:01:00 PDT 2001 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 986119260));
+    EXPECT_FALSE(matchSchedulePack(pack, civilTime));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(SchedulePackTest, Seconds)
+{
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct SchedulePack pack_, *pack = &pack_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    /* Packed schedules only match the start of each minute. */
+
+    for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+        EXPECT_EQ(schedule, initSchedule(schedule, Schedules[sx]));
+        EXPECT_EQ(pack, initSchedulePack(pack, schedule));
+
+        /* Sat Jan  1 00:00:30 PST 2000 */
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
+        EXPECT_EQ(0, advanceCivilTimeSecond(civilTime, 30));
+
+        EXPECT_FALSE(matchSchedule(schedule, civilTime)) << Schedules[sx];
+        EXPECT_FALSE(matchSchedulePack(pack, civilTime)) << Schedules[sx];
+
+        EXPECT_EQ(
+            querySchedule(schedule, civilTime, 0, 0, 0),
+            querySchedulePack(pack, civilTime, 0, 0, 0))
+            << Schedules[sx];
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
@@ -0,0 +1,412 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "scheduletable.h"
+
+#include "civiltime.h"
+#include "macros.h"
+
+#include "gtest/gtest.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+/* -------------------------------------------------------------------------- */
+class ScheduleTableTest : public ::testing::Test
+{
+    void SetUp()
+    {
+        static char TZ[] = "TZ=US/Pacific";
+
+        putenv(TZ);
+    }
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTableTest, Query)
+{
+    struct ScheduleTable table_, *table = &table_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    static const char *Schedules[] = {
+        "* * * * *",
+        "30 1 * * *",
+        "30 2 * * *",
+        "30 * * * *",
+        "*/15 1-3 * * *",
+        "0 0 1 * *",
+        "0 0 * * 0",
+        "0 0 1 * 0",
+        "0,30 * 29 10 *",
+        "0,30 * * 10 0",
+        "0 0-23 * * 1-5",
+        "5 4 * 4 *",
+        "5 4 2-3 * *",
+        "0 0 29 2 *",
+        "59 23 31 12 *",
+        "1 1-22 2-28 2-11 *",
+    };
+
+    /* Add enough entries that the table must grow. */
+
+    struct Schedule schedules[NUMBEROF(Schedules)];
+
+    EXPECT_EQ(table, initScheduleTable(table));
+
+    for (size_t ix = 0; ix < 10 * NUMBEROF(Schedules); ++ix) {
+        size_t sx = ix % NUMBEROF(Schedules);
+
+        EXPECT_EQ(&schedules[sx], initSchedule(&schedules[sx], Schedules[sx]));
+        EXPECT_EQ(0, addScheduleTableEntry(table, &schedules[sx]));
+    }
+
+    EXPECT_EQ(10 * NUMBEROF(Schedules), table->mLength);
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    /* Sun Apr  2 01:59:00 PST 2000 */
+    /* Sat Jul  1 22:59:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PST 2000 Repeated */
+    static const time_t Times[] = {
+        946713600, 954669540, 962517540, 972808200, 972811800,
+    };
+
+    time_t scheduled[10 * NUMBEROF(Schedules)];
+
+    for (size_t tx = 0; tx < NUMBEROF(Times); ++tx) {
+
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, Times[tx]));
+
+        EXPECT_EQ(0, queryScheduleTable(table, civilTime, scheduled));
+
+        for (size_t ix = 0; ix < table->mLength; ++ix) {
+            size_t sx = ix % NUMBEROF(Schedules);
+
+            EXPECT_EQ(
+                querySchedule(&schedules[sx], civilTime, 0, 0, 0),
+                scheduled[ix])
+                << Schedules[sx] << " " << Times[tx];
+        }
+    }
+
+    closeScheduleTable(table);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTableTest, Earliest)
+{
+    struct ScheduleTable table_, *table = &table_;
+
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    static const char *Schedules[] = {
+        "0 0 29 2 *",
+        "30 1 * * *",
+        "30 2 * * *",
+        "30 * * * *",
+        "*/15 1-3 * * *",
+        "0 0 1 * *",
+        "0 0 * * 0",
+        "0,30 * 29 10 *",
+        "5 4 * 4 *",
+        "59 23 31 12 *",
+        "1 1-22 2-28 2-11 *",
+        "30 1 * * *",
+    };
+
+    EXPECT_EQ(table, initScheduleTable(table));
+
+    for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+        EXPECT_EQ(schedule, initSchedule(schedule, Schedules[sx]));
+        EXPECT_EQ(0, addScheduleTableEntry(table, schedule));
+    }
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    /* Sun Apr  2 01:59:00 PST 2000 */
+    /* Sun Oct 29 01:30:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PST 2000 Repeated */
+    static const time_t Times[] = {
+        946713600, 954669540, 972808200, 972811800,
+    };
+
+    time_t scheduled[NUMBEROF(Schedules)];
+
+    struct ScheduleTableFire fires[NUMBEROF(Schedules)];
+
+    for (size_t tx = 0; tx < NUMBEROF(Times); ++tx) {
+
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, Times[tx]));
+
+        EXPECT_EQ(0, queryScheduleTable(table, civilTime, scheduled));
+
+        /* The earliest fires are ordered by time, then by entry. */
+
+        for (size_t count = 0; count <= NUMBEROF(Schedules); ++count) {
+
+            EXPECT_EQ(
+                (ssize_t) count,
+                queryScheduleTableEarliest(table, civilTime, fires, count));
+
+            for (size_t fx = 0; fx < count; ++fx) {
+
+                size_t earlier = 0;
+
+                for (size_t ex = 0; ex < NUMBEROF(Schedules); ++ex) {
+                    if (scheduled[ex] < fires[fx].mScheduled ||
+                            (scheduled[ex] == fires[fx].mScheduled &&
+                             ex < fires[fx].mEntry))
+                        ++earlier;
+                }
+
+                EXPECT_EQ(fx, earlier) << Times[tx] << " " << count;
+                EXPECT_EQ(
+                    scheduled[fires[fx].mEntry], fires[fx].mScheduled);
+            }
+        }
+    }
+
+    closeScheduleTable(table);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTableTest, EarliestNever)
+{
+    struct ScheduleTable table_, *table = &table_;
+
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    EXPECT_EQ(table, initScheduleTable(table));
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 30 2 *"));
+    EXPECT_EQ(0, addScheduleTableEntry(table, schedule));
+
+    EXPECT_EQ(schedule, initSchedule(schedule, "0 0 1 1 *"));
+    EXPECT_EQ(0, addScheduleTableEntry(table, schedule));
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    EXPECT_EQ(civilTime, initCivilTime(civilTime, 946713600));
+
+    /* Schedules that never occur are omitted. */
+
+    struct ScheduleTableFire fires[2];
+
+    EXPECT_EQ(1, queryScheduleTableEarliest(table, civilTime, fires, 2));
+    EXPECT_EQ(1u, fires[0].mEntry);
+    EXPECT_EQ(946713600, fires[0].mScheduled);
+
+    closeScheduleTable(table);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTableTest, Seconds)
+{
+    struct ScheduleTable table_, *table = &table_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    static const char *Schedules[] = {
+        "* * * * *",
+        "30 1 * * *",
+        "0 * * * *",
+        "0 0 * * *",
+        "0 0 2 * *",
+        "59 23 * * *",
+    };
+
+    struct Schedule schedules[NUMBEROF(Schedules)];
+
+    EXPECT_EQ(table, initScheduleTable(table));
+
+    for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+        EXPECT_EQ(&schedules[sx], initSchedule(&schedules[sx], Schedules[sx]));
+        EXPECT_EQ(0, addScheduleTableEntry(table, &schedules[sx]));
+    }
+
+    /* A civil time part way through a minute is scheduled no earlier
+     * than the start of the next minute, even if that lies on the
+     * next day.
+     *
+     * Sat Jan  1 00:00:30 PST 2000
+     * Sat Jan  1 23:59:01 PST 2000
+     * Sat Jan  1 23:59:59 PST 2000
+     */
+
+    static const struct {
+        time_t mTime;
+        int mSecond;
+    } Times[] = {
+        { 946713600, 30 },
+        { 946799940, 1 },
+        { 946799940, 59 },
+    };
+
+    time_t scheduled[NUMBEROF(Schedules)];
+
+    struct ScheduleTableFire fires[1];
+
+    for (size_t tx = 0; tx < NUMBEROF(Times); ++tx) {
+
+        EXPECT_EQ(civilTime, initCivilTime(civilTime, Times[tx].mTime));
+        EXPECT_EQ(0, advanceCivilTimeSecond(civilTime, Times[tx].mSecond));
+
+        EXPECT_EQ(0, queryScheduleTable(table, civilTime, scheduled));
+
+        for (size_t sx = 0; sx < NUMBEROF(Schedules); ++sx) {
+            EXPECT_EQ(
+                querySchedule(&schedules[sx], civilTime, 0, 0, 0),
+                scheduled[sx])
+                << Schedules[sx] << " " << Times[tx].mTime;
+        }
+
+        EXPECT_EQ(1, queryScheduleTableEarliest(table, civilTime, fires, 1));
+        EXPECT_EQ(0u, fires[0].mEntry);
+        EXPECT_EQ(Times[tx].mTime + 60, fires[0].mScheduled);
+    }
+
+    closeScheduleTable(table);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(ScheduleTableTest, Kernels)
+{
+    struct ScheduleTable table_, *table = &table_;
+
+    struct Schedule schedule_, *schedule = &schedule_;
+
+    struct CivilTime civilTime_, *civilTime = &civilTime_;
+
+    static const char *Minutes[] = { "*", "0", "30", "*/15", "59" };
+    static const char *Hours[] = { "*", "0", "1-3", "23" };
+    static const char *Days[] = { "*", "1", "15", "29", "2-28" };
+    static const char *Months[] = { "*", "2", "10", "12" };
+    static const char *WeekDays[] = { "*", "0", "1-5", "6" };
+
+    EXPECT_EQ(table, initScheduleTable(table));
+
+    /* Choose a spread of schedules, leaving a run of entries that is not
+     * a multiple of the lanes of a vector kernel.
+     */
+
+    size_t combinations =
+        NUMBEROF(Minutes) * NUMBEROF(Hours) * NUMBEROF(Days) *
+        NUMBEROF(Months) * NUMBEROF(WeekDays);
+
+    for (size_t cx = 0; cx < combinations; cx += 7) {
+        size_t ix = cx;
+
+        std::string text;
+
+        text += Minutes[ix % NUMBEROF(Minutes)];
+        ix /= NUMBEROF(Minutes);
+        text += std::string(" ") + Hours[ix % NUMBEROF(Hours)];
+        ix /= NUMBEROF(Hours);
+        text += std::string(" ") + Days[ix % NUMBEROF(Days)];
+        ix /= NUMBEROF(Days);
+        text += std::string(" ") + Months[ix % NUMBEROF(Months)];
+        ix /= NUMBEROF(Months);
+        text += std::string(" ") + WeekDays[ix % NUMBEROF(WeekDays)];
+
+        EXPECT_EQ(schedule, initSchedule(schedule, text.c_str()));
+        EXPECT_EQ(0, addScheduleTableEntry(table, schedule));
+    }
+
+    EXPECT_NE(0u, table->mLength % 8);
+
+    /* Sat Jan  1 00:00:00 PST 2000 */
+    /* Mon Feb 28 23:59:00 PST 2000 */
+    /* Sun Apr  2 01:59:00 PST 2000 */
+    /* Sat Jul  1 12:34:00 PDT 2000 */
+    /* Sun Oct 29 01:30:00 PST 2000 Repeated */
+    /* Sun Dec 31 23:59:00 PST 2000 */
+    static const time_t Times[] = {
+        946713600, 951811140, 954669540, 962480040, 972811800, 978335940,
+    };
+
+    std::vector<time_t> scalar(table->mLength);
+    std::vector<time_t> vector(table->mLength);
+
+    struct ScheduleTableFire scalarFires[10];
+    struct ScheduleTableFire vectorFires[10];
+
+    for (size_t tx = 0; tx < NUMBEROF(Times); ++tx) {
+
+        for (int second = 0; second < 60; second += 59) {
+
+            EXPECT_EQ(civilTime, initCivilTime(civilTime, Times[tx]));
+            if (second)
+                EXPECT_EQ(0, advanceCivilTimeSecond(civilTime, second));
+
+            EXPECT_EQ(0, selectScheduleTableKernel(
+                table, ScheduleTableKernelScalar));
+
+            EXPECT_EQ(0, queryScheduleTable(table, civilTime, &scalar[0]));
+            EXPECT_EQ(
+                (ssize_t) NUMBEROF(scalarFires),
+                queryScheduleTableEarliest(
+                    table, civilTime, scalarFires, NUMBEROF(scalarFires)));
+
+            /* Where AVX2 is not supported, the scalar kernel remains
+             * selected.
+             */
+
+            errno = 0;
+            if (selectScheduleTableKernel(table, ScheduleTableKernelAvx2))
+                EXPECT_EQ(ENOTSUP, errno);
+
+            EXPECT_EQ(0, queryScheduleTable(table, civilTime, &vector[0]));
+            EXPECT_EQ(
+                (ssize_t) NUMBEROF(vectorFires),
+                queryScheduleTableEarliest(
+                    table, civilTime, vectorFires, NUMBEROF(vectorFires)));
+
+            for (size_t ex = 0; ex < table->mLength; ++ex)
+                EXPECT_EQ(scalar[ex], vector[ex]) << Times[tx] << " " << ex;
+
+            for (size_t fx = 0; fx < NUMBEROF(scalarFires); ++fx) {
+                EXPECT_EQ(scalarFires[fx].mEntry, vectorFires[fx].mEntry);
+                EXPECT_EQ(
+                    scalarFires[fx].mScheduled, vectorFires[fx].mScheduled);
+            }
+        }
+    }
+
+    closeScheduleTable(table);
+}
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
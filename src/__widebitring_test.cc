@@ -0,0 +1,232 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "widebitring.h"
+
+#include "macros.h"
+
+#include "gtest/gtest.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* -------------------------------------------------------------------------- */
+class WideBitRingTest : public ::testing::Test
+{
+public:
+
+    WideBitRingTest()
+        : mBitRing(&mBitRing_)
+    { }
+
+private:
+
+    void SetUp()
+    {
+        EXPECT_EQ(mBitRing, initWideBitRing(mBitRing, 1, 366, 0));
+        EXPECT_EQ(1, queryWideBitRingMin(mBitRing));
+        EXPECT_EQ(366, queryWideBitRingMax(mBitRing));
+    }
+
+    void TearDown()
+    {
+        closeWideBitRing(mBitRing);
+    }
+
+protected:
+
+    struct WideBitRing mBitRing_, * const mBitRing;
+};
+
+/* -------------------------------------------------------------------------- */
+TEST_F(WideBitRingTest, Empty)
+{
+    EXPECT_FALSE(queryWideBitRingPopulation(mBitRing));
+
+    for (auto member = queryWideBitRingMin(mBitRing); ; ++member) {
+        EXPECT_FALSE(queryWideBitRingMembership(mBitRing, member));
+        EXPECT_FALSE(queryWideBitRingMemberSeparation(mBitRing, member));
+        if (member == queryWideBitRingMax(mBitRing))
+            break;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(WideBitRingTest, Membership)
+{
+    int max = queryWideBitRingMax(mBitRing);
+
+    EXPECT_TRUE(addWideBitRingMember(mBitRing, max+1));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(queryWideBitRingMembership(mBitRing, max));
+    EXPECT_FALSE(addWideBitRingMember(mBitRing, max));
+    EXPECT_TRUE(queryWideBitRingMembership(mBitRing, max));
+    EXPECT_EQ(1U, queryWideBitRingPopulation(mBitRing));
+
+    int min = queryWideBitRingMin(mBitRing);
+
+    EXPECT_TRUE(addWideBitRingMember(mBitRing, min-1));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(queryWideBitRingMembership(mBitRing, min));
+    EXPECT_FALSE(addWideBitRingMember(mBitRing, min));
+    EXPECT_TRUE(queryWideBitRingMembership(mBitRing, min));
+    EXPECT_EQ(2U, queryWideBitRingPopulation(mBitRing));
+
+    int mid = (min + max) / 2;
+
+    EXPECT_FALSE(queryWideBitRingMembership(mBitRing, mid));
+    EXPECT_FALSE(addWideBitRingMember(mBitRing, mid));
+    EXPECT_TRUE(queryWideBitRingMembership(mBitRing, mid));
+    EXPECT_EQ(3U, queryWideBitRingPopulation(mBitRing));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(WideBitRingTest, Separation)
+{
+    int min = queryWideBitRingMin(mBitRing);
+    int max = queryWideBitRingMax(mBitRing);
+    int mid = (min + max) / 2;
+
+    EXPECT_EQ(-1, queryWideBitRingMemberSeparation(mBitRing, min-1));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_EQ(-1, queryWideBitRingMemberSeparation(mBitRing, max+1));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(addWideBitRingMember(mBitRing, mid));
+
+    EXPECT_EQ(1, queryWideBitRingMemberSeparation(mBitRing, mid-1));
+    EXPECT_EQ(max-0, queryWideBitRingMemberSeparation(mBitRing, mid-0));
+    EXPECT_EQ(max-1, queryWideBitRingMemberSeparation(mBitRing, mid+1));
+    EXPECT_EQ(mid-min, queryWideBitRingMemberSeparation(mBitRing, min));
+
+    EXPECT_FALSE(addWideBitRingMember(mBitRing, max));
+
+    EXPECT_EQ(1, queryWideBitRingMemberSeparation(mBitRing, max-1));
+    EXPECT_EQ(mid-min+1, queryWideBitRingMemberSeparation(mBitRing, max-0));
+
+    EXPECT_FALSE(addWideBitRingMember(mBitRing, min));
+
+    EXPECT_EQ(1, queryWideBitRingMemberSeparation(mBitRing, max));
+    EXPECT_EQ(mid-min, queryWideBitRingMemberSeparation(mBitRing, min-0));
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(WideBitRingTest, Init)
+{
+    struct WideBitRing bitRing_, *bitRing = &bitRing_;
+
+    EXPECT_FALSE(initWideBitRing(bitRing, 2, 1, 0));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_FALSE(initWideBitRing(bitRing, 1, 366, "367"));
+    EXPECT_EQ(EINVAL, errno);
+
+    EXPECT_EQ(bitRing, initWideBitRing(bitRing, 1, 366, "*"));
+    EXPECT_EQ(0U, queryWideBitRingPopulation(bitRing));
+    closeWideBitRing(bitRing);
+
+    EXPECT_EQ(bitRing, initWideBitRing(bitRing, 1, 366, "*/7"));
+    EXPECT_EQ(53U, queryWideBitRingPopulation(bitRing));
+    EXPECT_TRUE(queryWideBitRingMembership(bitRing, 358));
+    EXPECT_TRUE(queryWideBitRingMembership(bitRing, 365));
+    EXPECT_FALSE(queryWideBitRingMembership(bitRing, 366));
+    EXPECT_EQ(7, queryWideBitRingMemberSeparation(bitRing, 358));
+    EXPECT_EQ(2, queryWideBitRingMemberSeparation(bitRing, 365));
+    closeWideBitRing(bitRing);
+
+    EXPECT_EQ(bitRing, initWideBitRing(bitRing, 1, 366, "60,64-65,128,366"));
+    EXPECT_EQ(5U, queryWideBitRingPopulation(bitRing));
+    EXPECT_EQ(4, queryWideBitRingMemberSeparation(bitRing, 60));
+    EXPECT_EQ(63, queryWideBitRingMemberSeparation(bitRing, 65));
+    EXPECT_EQ(238, queryWideBitRingMemberSeparation(bitRing, 128));
+    EXPECT_EQ(60, queryWideBitRingMemberSeparation(bitRing, 366));
+    closeWideBitRing(bitRing);
+}
+
+/* -------------------------------------------------------------------------- */
+TEST_F(WideBitRingTest, BitRing)
+{
+    /* Rings that fit in a single word behave like struct BitRing. */
+
+    static const char *Memberships[] = {
+        "*", "*/2", "*/5", "3", "0-63", "5-40/3,62", "1,2,3,50",
+    };
+
+    static const int Ranges[][2] = {
+        { 0, 63 }, { 1, 31 }, { 0, 59 }, { 0, 6 },
+    };
+
+    for (size_t rx = 0; rx < NUMBEROF(Ranges); ++rx) {
+        for (size_t mx = 0; mx < NUMBEROF(Memberships); ++mx) {
+
+            int min = Ranges[rx][0];
+            int max = Ranges[rx][1];
+
+            struct BitRing bitRing_, *bitRing = &bitRing_;
+            struct WideBitRing wideBitRing_, *wideBitRing = &wideBitRing_;
+
+            struct BitRing *narrow = initBitRing(
+                bitRing, min, max, Memberships[mx]);
+            struct WideBitRing *wide = initWideBitRing(
+                wideBitRing, min, max, Memberships[mx]);
+
+            EXPECT_EQ(!!narrow, !!wide) << Memberships[mx];
+            if (!narrow || !wide) {
+                if (wide)
+                    closeWideBitRing(wide);
+                continue;
+            }
+
+            EXPECT_EQ(
+                queryBitRingPopulation(bitRing),
+                queryWideBitRingPopulation(wideBitRing));
+
+            for (int member = min; member <= max; ++member) {
+                EXPECT_EQ(
+                    queryBitRingMembership(bitRing, member),
+                    queryWideBitRingMembership(wideBitRing, member));
+                EXPECT_EQ(
+                    queryBitRingMemberSeparation(bitRing, member),
+                    queryWideBitRingMemberSeparation(wideBitRing, member))
+                    << Memberships[mx] << " " << member;
+            }
+
+            closeWideBitRing(wideBitRing);
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+#include "_test_.h"
@@ -29,14 +29,18 @@
 
 #include "civiltime.h"
 #include "die.h"
+#include "macros.h"
 #include "parse.h"
 #include "schedule.h"
+#include "scheduleexclusion.h"
+#include "scheduleindex.h"
 
 #include <errno.h>
 #include <getopt.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #ifdef __APPLE__
@@ -51,6 +55,29 @@ static const int MaxJitterOpt = 24 * 60 * 60;
 
 static int JitterOpt = DefaultJitterOpt;
 
+static const int DefaultHorizonOpt = 0;
+
+static const int MinHorizonOpt = 0;
+static const int MaxHorizonOpt = INT_MAX;
+
+static int HorizonOpt = DefaultHorizonOpt;
+
+static int EmitCOpt;
+
+static int PreviousOpt;
+
+static time_t BeginOpt;
+
+static time_t EndOpt;
+
+static const char *CrontabOpt;
+
+static const char *ExcludeOpt;
+
+static const char *KeyOpt;
+
+static struct ScheduleExclusion Exclusion;
+
 /* -------------------------------------------------------------------------- */
 static void
 usage(void)
@@ -58,13 +85,30 @@ usage(void)
     fprintf(
         stderr,
         "usage: %s [ options ] time [ schedule ] [ < schedule ]\n"
+        "       %s --emit-c [ --crontab F | crontab ] [ < crontab ]\n"
+        "       %s --horizon N [ --crontab F ] collisions time [ < crontab ]\n"
         "\n"
         "options:\n"
+        "  -b,--begin T    Only schedule occurrences at or after time T\n"
+        "  -c,--crontab F  Read the crontab from file F [default: stdin]\n"
+        "  -e,--end T      Only schedule occurrences at or before time T\n"
+        "  -H,--horizon N  Only search N seconds ahead [default: unlimited]\n"
         "  -j,--jitter N   Jitter the schedule by N seconds [default: 300]\n"
+        "  -k,--key K      Choose the values of H fields using key K\n"
+        "  -p,--previous   Find the most recent occurrence at or before time\n"
+        "  -x,--exclude F  Exclude the dates listed in file F\n"
+        "  --emit-c        Emit crontab schedules as C source\n"
         "\n"
         "arguments:\n"
         "  time       Time specific as Unix epoch (eg 1636919408)\n"
-        "  schedule   Schedule using crontab(5) expression (eg * * * * *)\n",
+        "  schedule   Schedule using crontab(5) expression (eg * * * * *)\n"
+        "             optionally preceded by seconds (eg */10 * * * * *)\n"
+        "             and then followed by years (eg 0 0 0 1 1 * 2030)\n"
+        "  crontab    Lines of crontab(5) schedules each followed by a name\n"
+        "             used as the key for H fields\n"
+        "  collisions List pairs of jobs that run in the same minute\n",
+        program_invocation_short_name,
+        program_invocation_short_name,
         program_invocation_short_name);
     die(0);
 }
@@ -72,7 +116,9 @@ usage(void)
 /* -------------------------------------------------------------------------- */
 static int
 crontime(
+    time_t aTime,
     const struct CivilTime *aCivilTime,
+    time_t aHorizon,
     time_t aJitterPeriod,
     const char *aSchedule)
 {
@@ -80,22 +126,458 @@ crontime(
 
     struct Schedule schedule;
 
-    if (!initSchedule(&schedule, aSchedule))
+    if (!initScheduleKey(&schedule, aSchedule, KeyOpt))
+        goto Finally;
+
+    if (!boundSchedule(&schedule, BeginOpt, EndOpt))
+        goto Finally;
+
+    excludeSchedule(&schedule, &Exclusion);
+
+    /* The civil time has the granularity of a minute, but a schedule
+     * that selects seconds is searched from the specified second.
+     */
+
+    struct CivilTime secondsCivilTime;
+
+    if (queryBitRingPopulation(&schedule.mSeconds)) {
+        int second = aTime % 60;
+
+        if (!initCivilTime(&secondsCivilTime, aTime - second))
+            goto Finally;
+
+        if (second && advanceCivilTimeSecond(&secondsCivilTime, second))
+            goto Finally;
+
+        aCivilTime = &secondsCivilTime;
+    }
+
+    /* The most recent occurrence has already happened, so there
+     * is no opportunity to jitter it.
+     */
+
+    int jitter = 0;
+
+    time_t scheduled = PreviousOpt
+        ? querySchedulePrevious(&schedule, aCivilTime, aHorizon)
+        : querySchedule(
+            &schedule, aCivilTime, aHorizon, aJitterPeriod, &jitter);
+
+    /* Distinguish a schedule that has no occurrence within the horizon
+     * from one that cannot be computed.
+     */
+
+    if (-1 != scheduled)
+        printf("%lld %d\n", (long long) scheduled, jitter);
+    else if (ENOENT == errno)
+        printf("-\n");
+    else
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct CrontabJob
+{
+    char *mName;
+    unsigned long mLineNo;
+
+    struct Schedule mSchedule;
+};
+
+static int
+compareCrontabJobs(const void *aLhs, const void *aRhs)
+{
+    const struct CrontabJob *lhs = aLhs;
+    const struct CrontabJob *rhs = aRhs;
+
+    return strcmp(lhs->mName, rhs->mName);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+parseCrontabJob(struct CrontabJob *aJob, char *aLine, unsigned long aLineNo)
+{
+    int rc = -1;
+
+    aJob->mName = 0;
+
+    static const char CronSep[] = "\t ";
+
+    /* Collect the five fields of the schedule, separated by single spaces
+     * as expected by initSchedule(), and take the remainder of the line
+     * as the name of the job. The name identifies the job, and so is
+     * used as the key for any H fields.
+     */
+
+    char *schedule = malloc(strlen(aLine) + 1);
+    if (!schedule)
+        goto Finally;
+
+    char *schedulePtr = schedule;
+
+    char *linePtr = aLine;
+
+    for (unsigned fx = 0; fx < 5; ++fx) {
+        linePtr += strspn(linePtr, CronSep);
+
+        size_t fieldLen = strcspn(linePtr, CronSep);
+        if (!fieldLen) {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        if (fx)
+            *schedulePtr++ = ' ';
+
+        memcpy(schedulePtr, linePtr, fieldLen);
+        schedulePtr += fieldLen;
+
+        linePtr += fieldLen;
+    }
+
+    *schedulePtr = 0;
+
+    linePtr += strspn(linePtr, CronSep);
+
+    size_t nameLen = strlen(linePtr);
+    while (nameLen && strchr(CronSep, linePtr[nameLen-1]))
+        --nameLen;
+
+    if (!nameLen) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    aJob->mName = strndup(linePtr, nameLen);
+    if (!aJob->mName)
         goto Finally;
 
-    int jitter = INT_MIN;
+    if (!initScheduleKey(&aJob->mSchedule, schedule, aJob->mName))
+        goto Finally;
 
-    time_t scheduled = querySchedule(
-        &schedule, aCivilTime, aJitterPeriod, &jitter);
-    if (-1 == scheduled)
+    if (!boundSchedule(&aJob->mSchedule, BeginOpt, EndOpt))
         goto Finally;
 
-    printf("%lld %d\n", (long long) scheduled, jitter);
+    excludeSchedule(&aJob->mSchedule, &Exclusion);
+
+    aJob->mLineNo = aLineNo;
 
     rc = 0;
 
 Finally:
 
+    FINALLY({
+        free(schedule);
+
+        if (rc) {
+            free(aJob->mName);
+            aJob->mName = 0;
+        }
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+emitCString(const char *aString)
+{
+    putchar('"');
+
+    for (const char *chPtr = aString; *chPtr; ++chPtr) {
+        unsigned char ch = *chPtr;
+
+        if ('"' == ch || '\\' == ch)
+            printf("\\%c", ch);
+        else if (ch < ' ' || ch > '~')
+            printf("\\%03o", ch);
+        else
+            putchar(ch);
+    }
+
+    putchar('"');
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+emitCrontab(const struct CrontabJob *aJobs, size_t aLength)
+{
+    static const char *Kinds[ScheduleKinds] = {
+        [ScheduleMinutes]  = "ScheduleMinutes",
+        [ScheduleHours]    = "ScheduleHours",
+        [ScheduleDays]     = "ScheduleDays",
+        [ScheduleMonths]   = "ScheduleMonths",
+        [ScheduleWeekDays] = "ScheduleWeekDays",
+    };
+
+    static const char *Shapes[] = {
+        [ScheduleShapeGeneral]  = "ScheduleShapeGeneral",
+        [ScheduleShapeMinutes]  = "ScheduleShapeMinutes",
+        [ScheduleShapeHours]    = "ScheduleShapeHours",
+        [ScheduleShapeWeekDays] = "ScheduleShapeWeekDays",
+    };
+
+    printf("/* Generated by crontime --emit-c */\n"
+           "\n"
+           "#include \"schedule.h\"\n"
+           "\n"
+           "#include <stddef.h>\n");
+
+    for (size_t jx = 0; jx < aLength; ++jx) {
+        const struct Schedule *schedule = &aJobs[jx].mSchedule;
+
+        printf("\n"
+               "/* ");
+        for (const char *chPtr = aJobs[jx].mName; *chPtr; ++chPtr) {
+            if ('*' != chPtr[0] || '/' != chPtr[1])
+                putchar(*chPtr);
+        }
+        printf(" */\n"
+               "static const struct Schedule Schedule_%zu = {\n"
+               "    .mSchedules = {\n", jx);
+
+        for (unsigned kx = 0; kx < ScheduleKinds; ++kx) {
+            const struct BitRing *bitring = &schedule->mSchedules[kx];
+
+            printf("        [%s] = { UINT64_C(0x%" PRIx64 "), %d, %d },\n",
+                Kinds[kx],
+                bitring->mRing, bitring->mMin, bitring->mMax);
+        }
+
+        printf("    },\n"
+               "    .mShape = %s,\n", Shapes[schedule->mShape]);
+
+        const struct ScheduleMonthDays *monthDays = &schedule->mMonthDays;
+
+        if (queryScheduleMonthDaysPopulation(monthDays)) {
+            printf("    .mMonthDays = {\n"
+                   "        .mNearestWeekDays = UINT32_C(0x%" PRIx32 "),\n"
+                   "        .mLastDay = %u,\n"
+                   "        .mLastWeekDay = %u,\n"
+                   "        .mLastWeekDays = 0x%x,\n"
+                   "        .mNthWeekDays = {",
+                monthDays->mNearestWeekDays,
+                monthDays->mLastDay,
+                monthDays->mLastWeekDay,
+                monthDays->mLastWeekDays);
+
+            for (unsigned wx = 0; wx < DaysInWeek; ++wx)
+                printf(" 0x%x,", monthDays->mNthWeekDays[wx]);
+
+            printf(" },\n"
+                   "    },\n");
+        }
+
+        printf("};\n");
+    }
+
+    printf("\n"
+           "const struct ScheduleJob ScheduleJobs[] = {\n");
+
+    for (size_t jx = 0; jx < aLength; ++jx) {
+        printf("    { ");
+        emitCString(aJobs[jx].mName);
+        printf(", &Schedule_%zu },\n", jx);
+    }
+
+    if (!aLength)
+        printf("    { 0, 0 },\n");
+
+    printf("};\n"
+           "\n"
+           "const size_t ScheduleJobsLength = %zu;\n", aLength);
+}
+
+/* -------------------------------------------------------------------------- */
+struct Crontab
+{
+    struct CrontabJob *mJobs;
+    size_t mLength;
+};
+
+static void
+closeCrontab(struct Crontab *self)
+{
+    for (size_t jx = 0; jx < self->mLength; ++jx)
+        free(self->mJobs[jx].mName);
+    free(self->mJobs);
+
+    self->mJobs = 0;
+    self->mLength = 0;
+}
+
+static struct Crontab *
+initCrontab(struct Crontab *self, FILE *aFile)
+{
+    int rc = -1;
+
+    struct CrontabJob *jobs = 0;
+    size_t numJobs = 0;
+    size_t maxJobs = 0;
+
+    char *linePtr = 0;
+    size_t allocLen = 0;
+
+    self->mJobs = 0;
+    self->mLength = 0;
+
+    for (unsigned long lineNo = 1; ; ++lineNo) {
+
+        errno = 0;
+        ssize_t lineLen = getline(&linePtr, &allocLen, aFile);
+        if (-1 == lineLen) {
+            if (errno)
+                die("Unable to read line %lu", lineNo);
+            break;
+        }
+
+        if (lineLen) {
+            if (linePtr[lineLen-1] == '\n')
+                linePtr[lineLen - 1] = 0;
+        }
+
+        /* Skip blank lines and comments. */
+
+        const char *textPtr = linePtr + strspn(linePtr, "\t ");
+        if (!*textPtr || '#' == *textPtr)
+            continue;
+
+        if (numJobs == maxJobs) {
+            size_t size = maxJobs ? 2 * maxJobs : 64;
+
+            struct CrontabJob *resized = realloc(jobs, size * sizeof(*jobs));
+            if (!resized)
+                goto Finally;
+
+            jobs = resized;
+            maxJobs = size;
+        }
+
+        if (parseCrontabJob(&jobs[numJobs], linePtr, lineNo))
+            die("Unable to parse %s at line %lu", linePtr, lineNo);
+
+        ++numJobs;
+    }
+
+    /* Sort the jobs by name so that the emitted table can be searched
+     * by queryScheduleJob(), and so that collisions are listed in a
+     * predictable order.
+     */
+
+    if (numJobs)
+        qsort(jobs, numJobs, sizeof(*jobs), compareCrontabJobs);
+
+    for (size_t jx = 1; jx < numJobs; ++jx) {
+        if (!compareCrontabJobs(&jobs[jx-1], &jobs[jx])) {
+            errno = 0;
+            die("Duplicate job %s at lines %lu and %lu",
+                jobs[jx].mName,
+                jobs[jx-1].mLineNo < jobs[jx].mLineNo
+                    ? jobs[jx-1].mLineNo : jobs[jx].mLineNo,
+                jobs[jx-1].mLineNo < jobs[jx].mLineNo
+                    ? jobs[jx].mLineNo : jobs[jx-1].mLineNo);
+        }
+    }
+
+    self->mJobs = jobs;
+    self->mLength = numJobs;
+
+    jobs = 0;
+    numJobs = 0;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        for (size_t jx = 0; jx < numJobs; ++jx)
+            free(jobs[jx].mName);
+        free(jobs);
+        free(linePtr);
+    });
+
+    return rc ? 0 : self;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+collisions(
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon,
+    const struct Crontab *aCrontab)
+{
+    int rc = -1;
+
+    struct ScheduleIndex index_, *index = 0;
+
+    ScheduleIndexT *candidates = 0;
+
+    index = initScheduleIndex(&index_);
+
+    for (size_t jx = 0; jx < aCrontab->mLength; ++jx) {
+        if (addScheduleIndexJob(index, jx, &aCrontab->mJobs[jx].mSchedule))
+            goto Finally;
+    }
+
+    candidates = calloc(index->mWords ? index->mWords : 1, sizeof(*candidates));
+    if (!candidates)
+        goto Finally;
+
+    /* Use the index to find the jobs that share a value in every field
+     * with each job, and only search for the collisions of those pairs.
+     * Consider each pair once, by only considering the later job.
+     */
+
+    const size_t bits = sizeof(*candidates) * 8;
+
+    for (size_t jx = 0; jx < aCrontab->mLength; ++jx) {
+
+        const struct CrontabJob *job = &aCrontab->mJobs[jx];
+
+        if (!queryScheduleIndexCandidates(index, &job->mSchedule, candidates))
+            continue;
+
+        for (size_t wx = (jx + 1) / bits; wx < index->mWords; ++wx) {
+
+            ScheduleIndexT word = candidates[wx];
+
+            if (wx == (jx + 1) / bits)
+                word &= ~(ScheduleIndexT) 0 << (jx + 1) % bits;
+
+            while (word) {
+                const struct CrontabJob *other =
+                    &aCrontab->mJobs[wx * bits + __builtin_ctzll(word)];
+
+                word &= word - 1;
+
+                time_t collision = queryScheduleCollision(
+                    &job->mSchedule, &other->mSchedule, aCivilTime, aHorizon);
+
+                if (-1 != collision)
+                    printf("%lld\t%s\t%s\n",
+                        (long long) collision, job->mName, other->mName);
+                else if (ENOENT != errno)
+                    goto Finally;
+            }
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        free(candidates);
+        if (index)
+            closeScheduleIndex(index);
+    });
+
     return rc;
 }
 
@@ -106,14 +588,22 @@ parseOptions(int argc, char **argv)
     int rc = -1;
 
     static struct option LongOptions[] = {
-        {"jitter", required_argument, 0, 'j' },
-        {"help",   no_argument,       0, '?' },
-        {0,        0,                 0,  0 },
+        {"begin",   required_argument, 0, 'b' },
+        {"crontab", required_argument, 0, 'c' },
+        {"end",     required_argument, 0, 'e' },
+        {"horizon", required_argument, 0, 'H' },
+        {"jitter",  required_argument, 0, 'j' },
+        {"key",     required_argument, 0, 'k' },
+        {"previous", no_argument,      0, 'p' },
+        {"exclude", required_argument, 0, 'x' },
+        {"emit-c",  no_argument,       0, 'C' },
+        {"help",    no_argument,       0, '?' },
+        {0,         0,                 0,  0 },
     };
 
     while (1) {
 
-        int opt = getopt_long(argc, argv, "j:", LongOptions, 0);
+        int opt = getopt_long(argc, argv, "b:c:e:H:j:k:px:", LongOptions, 0);
         if (-1 == opt)
             break;
 
@@ -123,6 +613,63 @@ parseOptions(int argc, char **argv)
             usage();
             goto Finally;
 
+        case 'C':
+            EmitCOpt = 1;
+            break;
+
+        case 'c':
+            CrontabOpt = optarg;
+            break;
+
+        case 'p':
+            PreviousOpt = 1;
+            break;
+
+        case 'x':
+            ExcludeOpt = optarg;
+            break;
+
+        case 'k':
+            KeyOpt = optarg;
+            break;
+
+        case 'b':
+        case 'e':
+            {
+                unsigned long long bound;
+
+                const char *boundEndPtr = parseULongLong(&bound, optarg);
+
+                if (!boundEndPtr || *boundEndPtr)
+                    die("Cannot parse %s time %s",
+                        'b' == opt ? "begin" : "end", optarg);
+
+                if ('b' == opt)
+                    BeginOpt = bound;
+                else
+                    EndOpt = bound;
+            }
+            break;
+
+        case 'H':
+            {
+                unsigned long long horizon;
+
+                const char *horizonEndPtr = parseULongLong(&horizon, optarg);
+
+                if (!horizonEndPtr || *horizonEndPtr)
+                    die("Cannot parse horizon %s", optarg);
+
+                if (horizon < MinHorizonOpt ||
+                    horizon > MaxHorizonOpt)
+
+                    die("Horizon %llu lies outside range [%d,%d]",
+                        horizon, MinHorizonOpt, MaxHorizonOpt);
+
+                HorizonOpt = horizon;
+            }
+            break;
+
         case 'j':
             {
                 unsigned long long jitterPeriod;
@@ -164,6 +711,78 @@ main(int argc, char **argv)
     if (!arg)
         goto Finally;
 
+    initScheduleExclusion(&Exclusion);
+
+    if (ExcludeOpt) {
+        FILE *file = fopen(ExcludeOpt, "r");
+        if (!file)
+            die("Unable to open %s", ExcludeOpt);
+
+        unsigned long lineNo;
+
+        if (readScheduleExclusion(&Exclusion, file, &lineNo)) {
+            if (lineNo)
+                die("Unable to parse %s at line %lu", ExcludeOpt, lineNo);
+            die("Unable to read %s", ExcludeOpt);
+        }
+
+        fclose(file);
+    }
+
+    if (EmitCOpt) {
+
+        /* The emitted schedules refer to neither a validity window,
+         * nor an exclusion calendar.
+         */
+
+        if (BeginOpt || EndOpt || ExcludeOpt) {
+            errno = 0;
+            die("Emitted schedules cannot be bounded or exclude dates");
+        }
+
+        /* The crontab can be named either by --crontab, or by the
+         * argument, but not by both.
+         */
+
+        const char *crontabFile = CrontabOpt;
+
+        if (!crontabFile && *arg)
+            crontabFile = *arg++;
+
+        if (*arg)
+            usage();
+
+        FILE *file = stdin;
+
+        if (crontabFile) {
+            file = fopen(crontabFile, "r");
+            if (!file)
+                die("Unable to open %s", crontabFile);
+        }
+
+        struct Crontab crontab_, *crontab = &crontab_;
+
+        if (!initCrontab(crontab, file))
+            die("Unable to read crontab");
+
+        emitCrontab(crontab->mJobs, crontab->mLength);
+
+        closeCrontab(crontab);
+
+        if (stdin != file)
+            fclose(file);
+
+        rc = 0;
+        goto Finally;
+    }
+
+    int collisionsCmd = 0;
+
+    if (*arg && !strcmp(*arg, "collisions")) {
+        collisionsCmd = 1;
+        ++arg;
+    }
+
     unsigned long long time;
 
     if (!*arg)
@@ -180,20 +799,61 @@ main(int argc, char **argv)
     ++arg;
 
     /* Round the time up to the next minute because crontab schedules
-     * only have a granularity of 1 minute.
+     * only have a granularity of 1 minute unless they select seconds.
+     * When looking for the most recent occurrence, round down instead
+     * so that the occurrence does not lie after the specified time.
      */
 
-    time += 60 - 1;
-    time -= time % 60;
+    unsigned long long minute = time;
+
+    if (!PreviousOpt)
+        minute += 60 - 1;
+    minute -= minute % 60;
 
     struct CivilTime civilTime_, *civilTime = &civilTime_;
 
-    if (!initCivilTime(civilTime, time))
-        die("Unable to convert time %lu", time);
+    if (!initCivilTime(civilTime, minute))
+        die("Unable to convert time %llu", minute);
+
+    if (collisionsCmd) {
 
-    if (*arg) {
+        /* Collisions are only sought within a horizon because a pair
+         * of schedules that cannot collide would otherwise be searched
+         * indefinitely.
+         */
 
-        if (crontime(civilTime, JitterOpt, *arg))
+        if (*arg)
+            usage();
+
+        if (!HorizonOpt) {
+            errno = 0;
+            die("Collisions require a horizon");
+        }
+
+        FILE *file = stdin;
+
+        if (CrontabOpt) {
+            file = fopen(CrontabOpt, "r");
+            if (!file)
+                die("Unable to open %s", CrontabOpt);
+        }
+
+        struct Crontab crontab_, *crontab = &crontab_;
+
+        if (!initCrontab(crontab, file))
+            die("Unable to read crontab");
+
+        if (collisions(civilTime, HorizonOpt, crontab))
+            die("Unable to find collisions");
+
+        closeCrontab(crontab);
+
+        if (stdin != file)
+            fclose(file);
+
+    } else if (*arg) {
+
+        if (crontime(time, civilTime, HorizonOpt, JitterOpt, *arg))
             die("Unabled to schedule %s", *arg);
         ++arg;
 
@@ -217,7 +877,7 @@ main(int argc, char **argv)
                     linePtr[lineLen - 1] = 0;
             }
 
-            if (crontime(civilTime, JitterOpt, linePtr))
+            if (crontime(time, civilTime, HorizonOpt, JitterOpt, linePtr))
                 die("Unabled to schedule %s at line %lu", linePtr, lineNo);
         }
 
@@ -225,6 +885,8 @@ main(int argc, char **argv)
         linePtr = 0;
     }
 
+    closeScheduleExclusion(&Exclusion);
+
     rc = 0;
 
 Finally:
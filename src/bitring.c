@@ -32,13 +32,24 @@
 #include "macros.h"
 #include "parse.h"
 
-#include <ctype.h>
 #include <errno.h>
 
+/* -------------------------------------------------------------------------- */
+struct BitRingMembership
+{
+    int mMin;
+    int mMax;
+
+    const struct BitRingHash *mHash;
+
+    int (*mAddMember)(void *aRing, int aMember);
+    void *mRing;
+};
+
 /* -------------------------------------------------------------------------- */
 static int
 initBitRingMembershipRange_(
-    struct BitRing *self,
+    const struct BitRingMembership *self,
     unsigned long long aLhs,
     unsigned long long aRhs,
     unsigned long long aPeriod)
@@ -53,7 +64,7 @@ initBitRingMembershipRange_(
     }
 
     for (int member = aLhs; ; member += aPeriod) {
-        if (addBitRingMember(self, member))
+        if (self->mAddMember(self->mRing, member))
             goto Finally;
         if (aPeriod > aRhs - member)
             break;
@@ -67,20 +78,135 @@ Finally:
 }
 
 /* -------------------------------------------------------------------------- */
-static int
-initBitRingMembership_(struct BitRing *self, const char *aMembership)
+static const char *
+initBitRingMembershipItem_(
+    const struct BitRingMembership *self, const char *aMembership)
+{
+    int rc = -1;
+
+    const char *arg = aMembership;
+
+    unsigned long long lhs;
+    arg = parseULongLong(&lhs, arg);
+    if (!arg)
+        goto Finally;
+
+    unsigned long long period = 1;
+
+    unsigned long long rhs;
+    if ('-' != *arg) {
+        rhs = lhs;
+    } else {
+        arg = parseULongLong(&rhs, arg+1);
+        if (!arg)
+            goto Finally;
+
+        if ('/' == *arg) {
+            arg = parseULongLong(&period, arg+1);
+            if (!arg) {
+                errno = EINVAL;
+                goto Finally;
+            }
+        }
+    }
+
+    if (initBitRingMembershipRange_(self, lhs, rhs, period))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : arg;
+}
+
+/* -------------------------------------------------------------------------- */
+static const char *
+initBitRingMembershipHash_(
+    const struct BitRingMembership *self, const char *aMembership)
 {
     int rc = -1;
 
     const char *arg = aMembership;
 
-    if (!isdigit((unsigned char) *arg)) {
+    /* Use the hash to choose members: H chooses a single member, H(a-b)
+     * chooses a single member from the range a-b, and H/n or H(a-b)/n
+     * chooses every nth member starting from a hashed offset. Without a
+     * hash, there is nothing to choose from.
+     */
+
+    if (!self->mHash || 'H' != *arg) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    ++arg;
+
+    unsigned long long lhs = self->mMin;
+    unsigned long long rhs = self->mHash->mMax;
 
-        if ('*' != arg[0]) {
+    if ('(' == *arg) {
+        arg = parseULongLong(&lhs, arg+1);
+        if (!arg || '-' != *arg) {
             errno = EINVAL;
             goto Finally;
         }
 
+        arg = parseULongLong(&rhs, arg+1);
+        if (!arg || ')' != *arg) {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        ++arg;
+    }
+
+    if (lhs > rhs || lhs < self->mMin || rhs > self->mMax) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    unsigned long long span = rhs - lhs + 1;
+
+    unsigned long long period = 0;
+
+    if ('/' == *arg) {
+        arg = parseULongLong(&period, arg+1);
+        if (!arg || !period) {
+            errno = EINVAL;
+            goto Finally;
+        }
+    }
+
+    if (!period) {
+        lhs += self->mHash->mHash % span;
+        rhs = lhs;
+        period = 1;
+    } else {
+        lhs += self->mHash->mHash % (period < span ? period : span);
+    }
+
+    if (initBitRingMembershipRange_(self, lhs, rhs, period))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : arg;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+initBitRingMembership_(
+    const struct BitRingMembership *self, const char *aMembership)
+{
+    int rc = -1;
+
+    const char *arg = aMembership;
+
+    if ('*' == arg[0]) {
+
         if (arg[1]) {
             if ('/' != arg[1]) {
                 errno = EINVAL;
@@ -102,31 +228,12 @@ initBitRingMembership_(struct BitRing *self, const char *aMembership)
     } else {
 
         while (1) {
-            unsigned long long lhs;
-            arg = parseULongLong(&lhs, arg);
-            if (!arg)
-                goto Finally;
+            if ('H' == *arg)
+                arg = initBitRingMembershipHash_(self, arg);
+            else
+                arg = initBitRingMembershipItem_(self, arg);
 
-            unsigned long long period = 1;
-
-            unsigned long long rhs;
-            if ('-' != *arg) {
-                rhs = lhs;
-            } else {
-                arg = parseULongLong(&rhs, arg+1);
-                if (!arg)
-                    goto Finally;
-
-                if ('/' == *arg) {
-                    arg = parseULongLong(&period, arg+1);
-                    if (!arg) {
-                        errno = EINVAL;
-                        goto Finally;
-                    }
-                }
-            }
-
-            if (initBitRingMembershipRange_(self, lhs, rhs, period))
+            if (!arg)
                 goto Finally;
 
             if (!*arg)
@@ -148,9 +255,62 @@ Finally:
     return rc;
 }
 
+/* -------------------------------------------------------------------------- */
+int
+parseBitRingMembership(
+    const char *aMembership,
+    int aMin,
+    int aMax,
+    int (*aAddMember)(void *aRing, int aMember),
+    void *aRing)
+{
+    return parseBitRingMembershipHash(
+        aMembership, aMin, aMax, 0, aAddMember, aRing);
+}
+
+/* -------------------------------------------------------------------------- */
+int
+parseBitRingMembershipHash(
+    const char *aMembership,
+    int aMin,
+    int aMax,
+    const struct BitRingHash *aHash,
+    int (*aAddMember)(void *aRing, int aMember),
+    void *aRing)
+{
+    struct BitRingMembership membership = {
+        .mMin = aMin,
+        .mMax = aMax,
+        .mHash = aHash,
+        .mAddMember = aAddMember,
+        .mRing = aRing,
+    };
+
+    return initBitRingMembership_(&membership, aMembership);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+addBitRingMember_(void *self, int aMember)
+{
+    return addBitRingMember(self, aMember);
+}
+
 /* -------------------------------------------------------------------------- */
 struct BitRing *
 initBitRing(struct BitRing *self, int aMin, int aMax, const char *aMembership)
+{
+    return initBitRingHash(self, aMin, aMax, aMembership, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+struct BitRing *
+initBitRingHash(
+    struct BitRing *self,
+    int aMin,
+    int aMax,
+    const char *aMembership,
+    const struct BitRingHash *aHash)
 {
     int rc = -1;
 
@@ -164,7 +324,8 @@ initBitRing(struct BitRing *self, int aMin, int aMax, const char *aMembership)
     self->mMax = aMax;
 
     if (aMembership) {
-        if (initBitRingMembership_(self, aMembership))
+        if (parseBitRingMembershipHash(
+                aMembership, aMin, aMax, aHash, addBitRingMember_, self))
             goto Finally;
     }
 
@@ -265,3 +426,40 @@ Finally:
 }
 
 /* -------------------------------------------------------------------------- */
+int
+queryBitRingMemberPrecedence(const struct BitRing *self, int aMember)
+{
+    int rc = -1;
+
+    if (aMember < self->mMin || aMember > self->mMax) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    BitRingT prevMembers =
+        self->mRing & (((BitRingT) 1 << (aMember - self->mMin)) - 1);
+
+    int precedence;
+
+    if (prevMembers) {
+        int prevMember = 64 - __builtin_clzll(prevMembers);
+
+        precedence = aMember - self->mMin + 1 - prevMember;
+    } else if (self->mRing) {
+        int lastMember = 64 - __builtin_clzll(self->mRing);
+
+        precedence =
+            aMember - self->mMin + 1 - lastMember +
+            (self->mMax - self->mMin + 1);
+    } else {
+        precedence = 0;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? rc : precedence;
+}
+
+/* -------------------------------------------------------------------------- */
@@ -44,13 +44,49 @@ struct BitRing {
     int mMax;
 };
 
+/* The hash chooses the members selected by H, H(a-b), H/n and H(a-b)/n,
+ * so that the same membership spreads differently for each hash. A bare
+ * H only chooses members up to mMax, which can be less than the maximum
+ * member of the ring.
+ */
+
+struct BitRingHash {
+    uint64_t mHash;
+    int mMax;
+};
+
 /* -------------------------------------------------------------------------- */
 struct BitRing *
 initBitRing(struct BitRing *self, int aMin, int aMax, const char *aMembership);
 
+struct BitRing *
+initBitRingHash(
+    struct BitRing *self,
+    int aMin,
+    int aMax,
+    const char *aMembership,
+    const struct BitRingHash *aHash);
+
 int
 addBitRingMember(struct BitRing *self, int aMember);
 
+int
+parseBitRingMembership(
+    const char *aMembership,
+    int aMin,
+    int aMax,
+    int (*aAddMember)(void *aRing, int aMember),
+    void *aRing);
+
+int
+parseBitRingMembershipHash(
+    const char *aMembership,
+    int aMin,
+    int aMax,
+    const struct BitRingHash *aHash,
+    int (*aAddMember)(void *aRing, int aMember),
+    void *aRing);
+
 /* -------------------------------------------------------------------------- */
 int
 queryBitRingMin(const struct BitRing *self);
@@ -68,6 +104,9 @@ queryBitRingMembership(const struct BitRing *self, int aMember);
 int
 queryBitRingMemberSeparation(const struct BitRing *self, int aMember);
 
+int
+queryBitRingMemberPrecedence(const struct BitRing *self, int aMember);
+
 /* -------------------------------------------------------------------------- */
 END_C_SCOPE;
 
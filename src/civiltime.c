@@ -105,8 +105,9 @@ applyCivilTimeDstChange_(struct CivilTime *self, long aDstChange)
 
         transitionTime -= aDstChange;
 
-        struct tm *transitionTm = gmtime(&transitionTime);
-        if (!transitionTm)
+        struct tm transitionTm_, *transitionTm = &transitionTm_;
+
+        if (!gmtime_r(&transitionTime, transitionTm))
             goto Finally;
 
         /* No matter what the direction of the change, a daylight
@@ -147,7 +148,7 @@ applyCivilTimeDstChange_(struct CivilTime *self, long aDstChange)
                     mask |= MaskHours;
                 if (shadow->mTm.tm_min != transitionTm->tm_min)
                     mask |= MaskMinutes;
-                if (shadow->mTm.tm_min != transitionTm->tm_min)
+                if (shadow->mTm.tm_sec != transitionTm->tm_sec)
                     mask |= MaskSeconds;
 
                 shadow->mMask = mask;
@@ -212,19 +213,19 @@ initCivilTimeTm_(struct CivilTime *self, time_t aTime)
 
     struct Interval *interval = civilTimeInterval_(self);
 
-    if (aTime % 60) {
-        errno = EINVAL;
-        goto Finally;
-    }
-
     time_t time = aTime;
 
-    struct tm *tmPtr = localtime(&time);
-    if (!tmPtr)
+    /* Use localtime_r() so that civil times can be used concurrently,
+     * but since it need not consult TZ, call tzset() explicitly as
+     * localtime() would.
+     */
+
+    tzset();
+
+    if (!localtime_r(&time, &interval->mTm))
         goto Finally;
 
     interval->mTime = time;
-    interval->mTm = *tmPtr;
 
     rc = 0;
 
@@ -243,6 +244,11 @@ initCivilTime(struct CivilTime *self, time_t aTime)
 
     struct Interval *interval = civilTimeInterval_(self);
 
+    if (aTime % 60) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
     if (initCivilTimeTm_(self, aTime))
         goto Finally;
 
@@ -270,6 +276,53 @@ Finally:
     return rc ? 0 : self;
 }
 
+/* -------------------------------------------------------------------------- */
+struct CivilTime *
+initCivilTimeSince(
+    struct CivilTime *self, time_t aTime, const struct CivilTime *aSince)
+{
+    int rc = -1;
+
+    const struct Interval *since = &aSince->mIntervals[0];
+
+    /* A time that follows a civil time outside a transition period, but
+     * precedes the next daylight savings change, lies in the same
+     * interval, and so shares the daylight savings rules that were found
+     * for the civil time. Only the local time need be computed.
+     */
+
+    if (aSince->mInterval ||
+            aTime < since->mTime || aTime >= since->mDst.mEnd.mTime) {
+
+        if (!initCivilTime(self, aTime))
+            goto Finally;
+
+    } else {
+
+        self->mInterval = 0;
+
+        struct Interval *interval = civilTimeInterval_(self);
+
+        if (aTime % 60) {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        if (initCivilTimeTm_(self, aTime))
+            goto Finally;
+
+        interval->mMask = MaskNone;
+        interval->mDst = since->mDst;
+        interval->mCalendar = calendar_(&interval->mTm);
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : self;
+}
+
 /* -------------------------------------------------------------------------- */
 static int
 shadowCivilTimeValue_(
@@ -317,6 +370,9 @@ queryCivilTimeClock(const struct CivilTime *self)
 
         .mMinute = shadowCivilTimeValue_(
             self, MaskMinutes, interval->mTm.tm_min),
+
+        .mSecond = shadowCivilTimeValue_(
+            self, MaskSeconds, interval->mTm.tm_sec),
     };
 
     return clock;
@@ -349,11 +405,63 @@ queryCivilTimeWallClock(const struct CivilTime *self)
     struct Clock wallClock = {
         .mHour = interval->mTm.tm_hour,
         .mMinute = interval->mTm.tm_min,
+        .mSecond = interval->mTm.tm_sec,
     };
 
     return wallClock;
 }
 
+/* -------------------------------------------------------------------------- */
+int
+queryCivilTimeArtificial(
+    const struct CivilTime *self,
+    struct Calendar *aCalendar,
+    struct Clock *aClock)
+{
+    int rc = -1;
+
+    const struct Interval *interval = civilTimeInterval_(self);
+
+    /* Artificial time is inserted to describe the period skipped by
+     * a daylight savings change. Within that period, also provide the
+     * local calendar and clock that actually apply, and return 1.
+     * Masked time has no other local time, so return 0 elsewhere.
+     */
+
+    int artificial = self->mInterval && MaskNone == interval->mMask;
+
+    if (artificial) {
+        struct tm tm;
+
+        if (!localtime_r(&interval->mTime, &tm))
+            goto Finally;
+
+        struct Calendar calendar = {
+            .mYear = tm.tm_year + 1900,
+            .mMonth = tm.tm_mon + 1,
+            .mDay = tm.tm_mday,
+
+            .mWeekDay = tm.tm_wday,
+            .mCalendar = calendar_(&tm),
+        };
+
+        struct Clock clock = {
+            .mHour = tm.tm_hour,
+            .mMinute = tm.tm_min,
+            .mSecond = tm.tm_sec,
+        };
+
+        *aCalendar = calendar;
+        *aClock = clock;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : artificial;
+}
+
 /* -------------------------------------------------------------------------- */
 time_t
 queryCivilTimeUtc(const struct CivilTime *self)
@@ -363,6 +471,20 @@ queryCivilTimeUtc(const struct CivilTime *self)
     return interval->mTime;
 }
 
+/* -------------------------------------------------------------------------- */
+time_t
+queryCivilTimeTransition(const struct CivilTime *self)
+{
+    const struct Interval *interval = civilTimeInterval_(self);
+
+    /* Local time advances in step with UTC from the present time until
+     * the next daylight savings change. Within a transition period, local
+     * time is either masked or artificial, and there is no such interval.
+     */
+
+    return self->mInterval ? interval->mTime : interval->mDst.mEnd.mTime;
+}
+
 /* -------------------------------------------------------------------------- */
 static time_t
 utcTime(time_t aSince, struct tm *aTm)
@@ -488,16 +610,19 @@ Finally:
 }
 
 /* -------------------------------------------------------------------------- */
-static struct Interval *
+static int
 rewindCivilTimeMinute_(struct CivilTime *self, time_t aSince)
 {
     int rc = -1;
 
+    int repositioned = 0;
+
     struct Interval *interval = civilTimeInterval_(self);
 
-    interval->mTime -= interval->mTm.tm_min * 60;
+    interval->mTime -= interval->mTm.tm_min * 60 + interval->mTm.tm_sec;
 
     interval->mTm.tm_min = 0;
+    interval->mTm.tm_sec = 0;
 
     struct tm tm = interval->mTm;
     time_t time = utcTime(aSince, &tm);
@@ -505,6 +630,12 @@ rewindCivilTimeMinute_(struct CivilTime *self, time_t aSince)
     if (-1 == time)
         goto Finally;
 
+    /* If the rewound time lies outside the present interval, it has
+     * crossed a daylight savings change. Reposition the civil time at
+     * the change, and report the repositioning so that the caller can
+     * examine the civil time again.
+     */
+
     if (time < interval->mDst.mBegin.mTime) {
 
         time = (interval->mDst.mBegin.mTime - 1) / 60 * 60;
@@ -516,11 +647,9 @@ rewindCivilTimeMinute_(struct CivilTime *self, time_t aSince)
         if (!interval)
             goto Finally;
 
-        errno = EAGAIN;
-        goto Finally;
-    }
+        repositioned = 1;
 
-    if (time >= interval->mDst.mEnd.mTime) {
+    } else if (time >= interval->mDst.mEnd.mTime) {
 
         time = (interval->mDst.mEnd.mTime + 59) / 60 * 60;
 
@@ -531,44 +660,35 @@ rewindCivilTimeMinute_(struct CivilTime *self, time_t aSince)
         if (!interval)
             goto Finally;
 
-        errno = EAGAIN;
-        goto Finally;
-    }
+        repositioned = 1;
 
-    interval->mTm = tm;
+    } else {
 
-    interval->mTime = time;
+        interval->mTm = tm;
 
-    interval->mCalendar = calendar_(&interval->mTm);
+        interval->mTime = time;
+
+        interval->mCalendar = calendar_(&interval->mTm);
+    }
 
     rc = 0;
 
 Finally:
 
-    return rc ? 0 : civilTimeInterval_(self);
+    return rc ? rc : repositioned;
 }
 
 /* -------------------------------------------------------------------------- */
-static struct Interval *
+static int
 rewindCivilTimeHour_(struct CivilTime *self, time_t aSince)
 {
-    int rc = -1;
-
     struct Interval *interval = civilTimeInterval_(self);
 
     interval->mTime -= interval->mTm.tm_hour * (60 * 60);
 
     interval->mTm.tm_hour = 0;
 
-    interval = rewindCivilTimeMinute_(self, aSince);
-    if (!interval)
-        goto Finally;
-
-    rc = 0;
-
-Finally:
-
-    return rc ? 0 : interval;
+    return rewindCivilTimeMinute_(self, aSince);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -597,50 +717,79 @@ advanceCivilTimeDays_(struct CivilTime *self, time_t aDays)
 }
 
 /* -------------------------------------------------------------------------- */
-static struct Interval *
+static int
 rewindCivilTimeDay_(struct CivilTime *self, time_t aSince)
 {
-    int rc = -1;
-
     struct Interval *interval = civilTimeInterval_(self);
 
     subtractCivilTimeDays_(self, interval->mTm.tm_mday - 1);
 
     interval->mTm.tm_mday = 1;
 
-    interval = rewindCivilTimeHour_(self, aSince);
-    if (!interval)
-        goto Finally;
-
-    rc = 0;
-
-Finally:
-
-    return rc ? 0 : interval;
+    return rewindCivilTimeHour_(self, aSince);
 }
 
 /* -------------------------------------------------------------------------- */
-static struct Interval *
+static int
 rewindCivilTimeMonth_(
     struct CivilTime *self, time_t aSince, const int *aCalendar)
 {
-    int rc = -1;
-
     struct Interval *interval = civilTimeInterval_(self);
 
     subtractCivilTimeDays_(self, aCalendar[interval->mTm.tm_mon + 1 - 1]);
 
     interval->mTm.tm_mon = 0;
 
-    interval = rewindCivilTimeDay_(self, aSince);
-    if (!interval)
+    return rewindCivilTimeDay_(self, aSince);
+}
+
+/* -------------------------------------------------------------------------- */
+int
+advanceCivilTimeSecond(struct CivilTime *self, int aSecond)
+{
+    int rc = -1;
+
+    struct Interval *interval = civilTimeInterval_(self);
+
+    if (aSecond < 0 || aSecond > 59) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    if (aSecond <= interval->mTm.tm_sec) {
+        errno = ERANGE;
         goto Finally;
+    }
+
+    time_t since = interval->mTime;
+
+    time_t seconds = aSecond - interval->mTm.tm_sec;
+
+    interval->mTime += seconds;
+
+    interval->mTm.tm_sec = aSecond;
+
+    /* A civil time initialised in the period skipped by a daylight
+     * savings change returns to its initial time on leaving the
+     * transition period. Move the initial time so that advancing
+     * from the start of the first minute is not lost on return.
+     */
+
+    if (self->mInterval) {
+        struct Interval *base = &self->mIntervals[0];
+
+        if (since == interval->mDst.mBegin.mTime &&
+                since == base->mDst.mBegin.mTime) {
+            interval->mDst.mBegin.mTime += seconds;
+            base->mDst.mBegin.mTime += seconds;
+        }
+    }
 
     rc = 0;
 
 Finally:
 
-    return rc ? 0 : interval;
+    return rc;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -661,11 +810,16 @@ advanceCivilTimeMinute(struct CivilTime *self, int aMinute)
         goto Finally;
     }
 
+    /* Advancing to a new minute starts at the beginning of that minute,
+     * discarding any seconds into the present minute.
+     */
+
     time_t minutes = aMinute - interval->mTm.tm_min;
 
-    interval->mTime += minutes * 60;
+    interval->mTime += minutes * 60 - interval->mTm.tm_sec;
 
     interval->mTm.tm_min = aMinute;
+    interval->mTm.tm_sec = 0;
 
     rc = 0;
 
@@ -680,6 +834,8 @@ advanceCivilTimeHour(struct CivilTime *self, int aHour)
 {
     int rc = -1;
 
+    int repositioned = 0;
+
     struct Interval *interval = civilTimeInterval_(self);
 
     if (aHour < 0 || aHour > 59) {
@@ -700,15 +856,15 @@ advanceCivilTimeHour(struct CivilTime *self, int aHour)
 
     interval->mTm.tm_hour = aHour;
 
-    interval = rewindCivilTimeMinute_(self, since);
-    if (!interval)
+    repositioned = rewindCivilTimeMinute_(self, since);
+    if (-1 == repositioned)
         goto Finally;
 
     rc = 0;
 
 Finally:
 
-    return rc;
+    return rc ? rc : repositioned;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -717,6 +873,8 @@ advanceCivilTimeDay(struct CivilTime *self, int aDay)
 {
     int rc = -1;
 
+    int repositioned = 0;
+
     struct Interval *interval = civilTimeInterval_(self);
 
     int lastDay =
@@ -739,15 +897,15 @@ advanceCivilTimeDay(struct CivilTime *self, int aDay)
 
     interval->mTm.tm_mday = aDay;
 
-    interval = rewindCivilTimeHour_(self, since);
-    if (!interval)
+    repositioned = rewindCivilTimeHour_(self, since);
+    if (-1 == repositioned)
         goto Finally;
 
     rc = 0;
 
 Finally:
 
-    return rc;
+    return rc ? rc : repositioned;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -756,6 +914,8 @@ advanceCivilTimeMonth(struct CivilTime *self, int aMonth)
 {
     int rc = -1;
 
+    int repositioned = 0;
+
     struct Interval *interval = civilTimeInterval_(self);
 
     if (aMonth < 1 || aMonth > 12) {
@@ -780,15 +940,15 @@ advanceCivilTimeMonth(struct CivilTime *self, int aMonth)
 
     interval->mTm.tm_mon = month;
 
-    interval = rewindCivilTimeDay_(self, since);
-    if (!interval)
+    repositioned = rewindCivilTimeDay_(self, since);
+    if (-1 == repositioned)
         goto Finally;
 
     rc = 0;
 
 Finally:
 
-    return rc;
+    return rc ? rc : repositioned;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -797,6 +957,8 @@ advanceCivilTimeYear(struct CivilTime *self, int aYear)
 {
     int rc = -1;
 
+    int repositioned = 0;
+
     struct Interval *interval = civilTimeInterval_(self);
 
     if (aYear < 1900) {
@@ -860,15 +1022,15 @@ advanceCivilTimeYear(struct CivilTime *self, int aYear)
 
     interval->mCalendar = 0;
 
-    interval = rewindCivilTimeMonth_(self, since, calendar);
-    if (!interval)
+    repositioned = rewindCivilTimeMonth_(self, since, calendar);
+    if (-1 == repositioned)
         goto Finally;
 
     rc = 0;
 
 Finally:
 
-    return rc;
+    return rc ? rc : repositioned;
 }
 
 /* -------------------------------------------------------------------------- */
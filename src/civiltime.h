@@ -65,6 +65,7 @@ struct Calendar {
 struct Clock {
     int mHour;   /* 0 - 23 */
     int mMinute; /* 0 - 59 */
+    int mSecond; /* 0 - 59 */
 };
 
 struct Transition {
@@ -107,6 +108,10 @@ struct CivilTime {
 struct CivilTime *
 initCivilTime(struct CivilTime *self, time_t aTime);
 
+struct CivilTime *
+initCivilTimeSince(
+    struct CivilTime *self, time_t aTime, const struct CivilTime *aSince);
+
 /* -------------------------------------------------------------------------- */
 static __inline__ int
 invertCivilTimeValue_(int aValue)
@@ -122,6 +127,13 @@ nominalCivilTimeValue_(int aValue)
 }
 
 /* -------------------------------------------------------------------------- */
+/* Advancing the civil time returns 0, or 1 if the civil time was instead
+ * repositioned at a daylight savings change, or -1 on error.
+ */
+
+int
+advanceCivilTimeSecond(struct CivilTime *self, int aSecond);
+
 int
 advanceCivilTimeMinute(struct CivilTime *self, int aMinute);
 
@@ -150,9 +162,18 @@ queryCivilTimeCalendar(const struct CivilTime *self);
 struct Clock
 queryCivilTimeClock(const struct CivilTime *self);
 
+int
+queryCivilTimeArtificial(
+    const struct CivilTime *self,
+    struct Calendar *aCalendar,
+    struct Clock *aClock);
+
 time_t
 queryCivilTimeUtc(const struct CivilTime *self);
 
+time_t
+queryCivilTimeTransition(const struct CivilTime *self);
+
 /* -------------------------------------------------------------------------- */
 END_C_SCOPE;
 
@@ -0,0 +1,366 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "enumerate.h"
+
+#include "civiltime.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleChunk
+{
+    time_t mSince;
+    time_t mUntil;
+
+    time_t *mOccurrences;
+    size_t mLength;
+    size_t mSize;
+
+    int mErrno;
+};
+
+struct ScheduleChunks
+{
+    const struct Schedule *mSchedule;
+
+    struct ScheduleChunk *mChunks;
+    size_t mLength;
+
+    pthread_mutex_t mMutex;
+    size_t mNext;
+};
+
+/* -------------------------------------------------------------------------- */
+static int
+addScheduleChunkOccurrence_(struct ScheduleChunk *self, time_t aTime)
+{
+    int rc = -1;
+
+    if (self->mLength == self->mSize) {
+        size_t size = self->mSize ? 2 * self->mSize : 64;
+
+        time_t *occurrences = realloc(
+            self->mOccurrences, size * sizeof(*occurrences));
+        if (!occurrences)
+            goto Finally;
+
+        self->mOccurrences = occurrences;
+        self->mSize = size;
+    }
+
+    self->mOccurrences[self->mLength++] = aTime;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+enumerateScheduleChunk_(
+    struct ScheduleChunk *self, const struct Schedule *aSchedule)
+{
+    int rc = -1;
+
+    /* Each chunk is seeded with a civil time of its own, and collects
+     * the occurrences that lie in [mSince, mUntil). The first occurrence
+     * found from any time is the first occurrence found from any earlier
+     * time that has not yet been reached, including across daylight
+     * savings changes, so chunks neither duplicate nor drop occurrences
+     * at their boundaries.
+     */
+
+    struct CivilTime civilTime;
+
+    if (!initCivilTime(&civilTime, self->mSince))
+        goto Finally;
+
+    struct ScheduleIterator iterator;
+
+    if (!initScheduleIterator(&iterator, aSchedule, &civilTime))
+        goto Finally;
+
+    iterator.mHorizon = self->mUntil - 1;
+
+    while (1) {
+        time_t scheduled = nextScheduleOccurrence(&iterator);
+        if (-1 == scheduled) {
+            if (ENOENT != errno)
+                goto Finally;
+            break;
+        }
+
+        if (addScheduleChunkOccurrence_(self, scheduled))
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static void *
+enumerateScheduleChunks_(void *self_)
+{
+    struct ScheduleChunks *self = self_;
+
+    while (1) {
+
+        pthread_mutex_lock(&self->mMutex);
+        size_t next = self->mNext;
+        if (next < self->mLength)
+            ++self->mNext;
+        pthread_mutex_unlock(&self->mMutex);
+
+        if (next >= self->mLength)
+            break;
+
+        struct ScheduleChunk *chunk = &self->mChunks[next];
+
+        if (enumerateScheduleChunk_(chunk, self->mSchedule))
+            chunk->mErrno = errno ? errno : EINVAL;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+static time_t
+queryNextMonth_(time_t aTime)
+{
+    int rc = -1;
+
+    struct tm tm;
+
+    if (!localtime_r(&aTime, &tm))
+        goto Finally;
+
+    tm.tm_sec = 0;
+    tm.tm_min = 0;
+    tm.tm_hour = 0;
+    tm.tm_mday = 1;
+    tm.tm_mon += 1;
+    tm.tm_isdst = -1;
+
+    time_t time = mktime(&tm);
+    if (-1 == time)
+        goto Finally;
+
+    /* Round to the minute in case the local time is offset from UTC
+     * by a fraction of a minute, and ensure that the result advances
+     * even if midnight is skipped by a daylight savings change.
+     */
+
+    time += 60 - 1;
+    time -= time % 60;
+
+    if (time <= aTime)
+        time = aTime + 60;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : time;
+}
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleEnumeration *
+initScheduleEnumeration(
+    struct ScheduleEnumeration *self,
+    const struct Schedule *aSchedule,
+    time_t aSince,
+    time_t aUntil,
+    unsigned aWorkers)
+{
+    int rc = -1;
+
+    struct ScheduleChunks chunks = {
+        .mSchedule = aSchedule,
+        .mChunks = 0,
+        .mLength = 0,
+        .mNext = 0,
+    };
+
+    int mutex = 0;
+
+    pthread_t *threads = 0;
+
+    self->mOccurrences = 0;
+    self->mLength = 0;
+
+    if (aSince % 60 || aUntil % 60 || aSince > aUntil) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    /* Split the interval into chunks at the start of each calendar
+     * month. Ensure that the time zone is loaded before any workers
+     * are started so that the workers only read the time zone rules.
+     */
+
+    tzset();
+
+    size_t size = 0;
+
+    for (time_t since = aSince; since < aUntil; ) {
+
+        time_t until = queryNextMonth_(since);
+        if (-1 == until)
+            goto Finally;
+
+        if (until > aUntil)
+            until = aUntil;
+
+        if (chunks.mLength == size) {
+            size = size ? 2 * size : 16;
+
+            struct ScheduleChunk *chunkList = realloc(
+                chunks.mChunks, size * sizeof(*chunkList));
+            if (!chunkList)
+                goto Finally;
+
+            chunks.mChunks = chunkList;
+        }
+
+        chunks.mChunks[chunks.mLength++] = (struct ScheduleChunk) {
+            .mSince = since,
+            .mUntil = until,
+            .mOccurrences = 0,
+            .mLength = 0,
+            .mSize = 0,
+            .mErrno = 0,
+        };
+
+        since = until;
+    }
+
+    if (pthread_mutex_init(&chunks.mMutex, 0)) {
+        errno = EAGAIN;
+        goto Finally;
+    }
+    mutex = 1;
+
+    /* Enumerate the chunks on the worker threads, and on the calling
+     * thread which then waits for the workers to finish.
+     */
+
+    unsigned workers = aWorkers ? aWorkers - 1 : 0;
+
+    if (workers > chunks.mLength)
+        workers = chunks.mLength;
+
+    unsigned started = 0;
+
+    if (workers) {
+        threads = malloc(workers * sizeof(*threads));
+        if (!threads)
+            goto Finally;
+    }
+
+    for (; started < workers; ++started) {
+        if (pthread_create(
+                &threads[started], 0, enumerateScheduleChunks_, &chunks))
+            break;
+    }
+
+    enumerateScheduleChunks_(&chunks);
+
+    for (unsigned tx = 0; tx < started; ++tx)
+        pthread_join(threads[tx], 0);
+
+    /* Merge the occurrences from each chunk. The chunks are ordered
+     * and disjoint, so concatenating them preserves the order.
+     */
+
+    size_t length = 0;
+
+    for (size_t cx = 0; cx < chunks.mLength; ++cx) {
+        struct ScheduleChunk *chunk = &chunks.mChunks[cx];
+
+        if (chunk->mErrno) {
+            errno = chunk->mErrno;
+            goto Finally;
+        }
+
+        length += chunk->mLength;
+    }
+
+    self->mOccurrences = malloc((length ? length : 1) * sizeof(time_t));
+    if (!self->mOccurrences)
+        goto Finally;
+
+    for (size_t cx = 0; cx < chunks.mLength; ++cx) {
+        struct ScheduleChunk *chunk = &chunks.mChunks[cx];
+
+        memcpy(
+            self->mOccurrences + self->mLength,
+            chunk->mOccurrences,
+            chunk->mLength * sizeof(time_t));
+
+        self->mLength += chunk->mLength;
+    }
+
+    rc = 0;
+
+Finally:
+
+    free(threads);
+
+    if (mutex)
+        pthread_mutex_destroy(&chunks.mMutex);
+
+    for (size_t cx = 0; cx < chunks.mLength; ++cx)
+        free(chunks.mChunks[cx].mOccurrences);
+    free(chunks.mChunks);
+
+    if (rc)
+        closeScheduleEnumeration(self);
+
+    return rc ? 0 : self;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+closeScheduleEnumeration(struct ScheduleEnumeration *self)
+{
+    free(self->mOccurrences);
+
+    self->mOccurrences = 0;
+    self->mLength = 0;
+}
@@ -30,7 +30,9 @@
 #include "schedule.h"
 
 #include "civiltime.h"
+#include "fnvhash.h"
 #include "macros.h"
+#include "parse.h"
 
 #include <errno.h>
 #include <math.h>
@@ -38,203 +40,284 @@
 #include <string.h>
 
 /* -------------------------------------------------------------------------- */
-struct Schedule *
-initSchedule(struct Schedule *self, const char *aSchedule)
+static void
+classifySchedule_(struct Schedule *self)
 {
-    int rc = -1;
+    /* Classify the shape of the schedule. Schedules that do not constrain
+     * the day of the month, or the month, that select no days depending
+     * on the month, and that exclude no dates, can be computed directly
+     * without searching the calendar.
+     */
 
-    char *schedule = strdup(aSchedule);
-    if (!schedule)
-        goto Finally;
+    self->mShape = ScheduleShapeGeneral;
 
-    static const char CronSep[] = "\t ";
+    if (!queryBitRingPopulation(&self->mSchedules[ScheduleDays]) &&
+            !queryBitRingPopulation(&self->mSchedules[ScheduleMonths]) &&
+            !queryBitRingPopulation(&self->mYears) &&
+            !queryScheduleMonthDaysPopulation(&self->mMonthDays) &&
+            !self->mExclusion) {
 
-    char *scheduleWords[5];
-    char **scheduleWordPtr = &scheduleWords[NUMBEROF(scheduleWords)];
+        if (queryBitRingPopulation(&self->mSchedules[ScheduleWeekDays]))
+            self->mShape = ScheduleShapeWeekDays;
+        else if (queryBitRingPopulation(&self->mSchedules[ScheduleHours]))
+            self->mShape = ScheduleShapeHours;
+        else
+            self->mShape = ScheduleShapeMinutes;
+    }
+}
 
-    char *schedulePtr = schedule;
+/* -------------------------------------------------------------------------- */
+enum {
+    ScheduleFirstYear_ = 1970,
+    ScheduleLastYear_ = 2099,
+    ScheduleYearSpan_ = sizeof(BitRingT) * 8, /* Years held by the ring */
+};
 
-    while (scheduleWordPtr != scheduleWords) {
-        char *wordPtr = strsep(&schedulePtr, CronSep);
-        if (!wordPtr) {
-            errno = EINVAL;
-            goto Finally;
-        }
+struct ScheduleYears_
+{
+    int mFirst;
+    int mLast;
+};
 
-        *--scheduleWordPtr = wordPtr;
-    }
+static int
+addScheduleYear_(void *self_, int aYear)
+{
+    int rc = -1;
+
+    struct ScheduleYears_ *self = self_;
 
-    if (schedulePtr) {
+    if (aYear < ScheduleFirstYear_ || aYear > ScheduleLastYear_) {
         errno = EINVAL;
         goto Finally;
     }
 
-    if (!initBitRing(
-            &self->mSchedules[ScheduleMinutes], 0, 59, scheduleWords[4]))
-        goto Finally;
+    if (-1 == self->mFirst || aYear < self->mFirst)
+        self->mFirst = aYear;
 
-    if (!initBitRing(
-            &self->mSchedules[ScheduleHours], 0, 23, scheduleWords[3]))
-        goto Finally;
+    if (-1 == self->mLast || aYear > self->mLast)
+        self->mLast = aYear;
 
-    if (!initBitRing(
-            &self->mSchedules[ScheduleDays], 1, 31, scheduleWords[2]))
-        goto Finally;
+    rc = 0;
 
-    if (!initBitRing(
-            &self->mSchedules[ScheduleMonths], 1, 12, scheduleWords[1]))
-        goto Finally;
+Finally:
 
-    struct BitRing weekDays;
+    return rc;
+}
 
-    if (!initBitRing(&weekDays, 0, 7, scheduleWords[0]))
-        goto Finally;
+static struct BitRing *
+initScheduleYears_(struct BitRing *self, const char *aYears)
+{
+    int rc = -1;
 
-    int firstDay = queryBitRingMin(&weekDays);
-    int lastDay = queryBitRingMin(&weekDays);
+    /* There are more years than a bit ring can hold, so the ring starts
+     * at the first selected year, and the remaining selected years must
+     * lie within reach of the ring. A wildcard leaves the ring empty,
+     * but a stepped wildcard would reach beyond the ring.
+     */
 
-    if (!initBitRing(
-            &self->mSchedules[ScheduleWeekDays],
-            firstDay,
-            firstDay + DaysInWeek - 1, 0))
+    struct ScheduleYears_ years = { .mFirst = -1, .mLast = -1 };
+
+    if (aYears && '*' == aYears[0] && aYears[1]) {
+        errno = EINVAL;
         goto Finally;
+    }
 
-    /* Transfer the selected days of the week from the 0-7 range to the
-     * canononical 0-6 range.
-     */
+    if (aYears) {
+        if (parseBitRingMembership(
+                aYears,
+                ScheduleFirstYear_, ScheduleLastYear_,
+                addScheduleYear_, &years))
+            goto Finally;
+    }
 
-    for (int weekday = firstDay; ; ++weekday) {
+    int firstYear = ScheduleFirstYear_;
 
-        if (queryBitRingMembership(&weekDays, weekday)) {
-            if (addBitRingMember(
-                    &self->mSchedules[ScheduleWeekDays],
-                    firstDay + (weekday - firstDay) % DaysInWeek))
-                goto Finally;
+    if (-1 != years.mFirst) {
+        if (years.mLast - years.mFirst >= ScheduleYearSpan_) {
+            errno = EINVAL;
+            goto Finally;
         }
 
-        if (weekday == lastDay)
-            break;
+        firstYear = years.mFirst;
     }
 
+    int lastYear = firstYear + ScheduleYearSpan_ - 1;
+
+    if (lastYear > ScheduleLastYear_)
+        lastYear = ScheduleLastYear_;
+
+    if (!initBitRing(
+            self, firstYear, lastYear, -1 != years.mFirst ? aYears : 0))
+        goto Finally;
+
     rc = 0;
 
 Finally:
 
-    FINALLY({
-        free(schedule);
-        schedule = 0;
-    });
-
     return rc ? 0 : self;
 }
 
+/* -------------------------------------------------------------------------- */
+static void
+packScheduleMonthDays_(const struct ScheduleMonthDays *self, uint64_t *aWords)
+{
+    aWords[0] =
+        self->mNearestWeekDays |
+        (uint64_t) self->mLastWeekDays << 32 |
+        (uint64_t) !!self->mLastDay << 40 |
+        (uint64_t) !!self->mLastWeekDay << 41;
+
+    aWords[1] = 0;
+
+    for (unsigned wx = 0; wx < NUMBEROF(self->mNthWeekDays); ++wx)
+        aWords[1] |= (uint64_t) self->mNthWeekDays[wx] << (8 * wx);
+}
+
 /* -------------------------------------------------------------------------- */
 static int
-queryScheduleNext_(
-    const struct Schedule *self, enum ScheduleKind aScheduleKind, int aValue)
+addScheduleMonthDay_(struct ScheduleMonthDays *self, const char *aItem)
 {
     int rc = -1;
 
-    const struct BitRing *bitring = &self->mSchedules[aScheduleKind];
+    /* Recognise L for the last day of the month, LW for the last
+     * weekday of the month, and nW for the weekday nearest to the nth
+     * day of the month. Other items are left for the ring.
+     */
 
-    int delta = queryBitRingMemberSeparation(bitring, aValue);
-    if (-1 == delta)
-        goto Finally;
+    int added = 1;
 
-    if (!delta)
-        delta = 1;
+    if (!strcmp(aItem, "L")) {
+        self->mLastDay = 1;
+    } else if (!strcmp(aItem, "LW")) {
+        self->mLastWeekDay = 1;
+    } else {
+        unsigned long long day;
 
-    if (delta > queryBitRingMax(bitring) - aValue) {
-        errno = EAGAIN;
-        goto Finally;
+        const char *itemPtr = parseULongLong(&day, aItem);
+
+        if (!itemPtr || strcmp(itemPtr, "W")) {
+            added = 0;
+        } else if (day < 1 || day > 31) {
+            errno = EINVAL;
+            goto Finally;
+        } else {
+            self->mNearestWeekDays |= (uint32_t) 1 << (day - 1);
+        }
     }
 
     rc = 0;
 
 Finally:
 
-    return rc ? -1 : aValue + delta;
+    return rc ? -1 : added;
 }
 
-/* -------------------------------------------------------------------------- */
 static int
-queryScheduleMinute_(const struct Schedule *self, struct CivilTime *aCivilTime)
+addScheduleMonthWeekDay_(struct ScheduleMonthDays *self, const char *aItem)
 {
     int rc = -1;
 
-    while (1) {
+    /* Recognise dL for the last day d of the week in the month, and d#n
+     * for the nth day d of the week in the month. Other items are left
+     * for the ring.
+     */
 
-        int matched = 1;
+    int added = 0;
 
-        if (queryBitRingPopulation(&self->mSchedules[ScheduleMinutes])) {
-            matched =
-                queryBitRingMembership(
-                    &self->mSchedules[ScheduleMinutes],
-                    queryCivilTimeClock(aCivilTime).mMinute);
-        }
+    unsigned long long weekDay;
 
-        if (matched)
-            break;
+    const char *itemPtr = parseULongLong(&weekDay, aItem);
 
-        int minute =
-            queryScheduleNext_(
-                self,
-                ScheduleMinutes,
-                queryCivilTimeWallClock(aCivilTime).mMinute);
-        if (-1 == minute)
+    if (itemPtr && (!strcmp(itemPtr, "L") || '#' == *itemPtr)) {
+
+        if (weekDay > DaysInWeek) {
+            errno = EINVAL;
             goto Finally;
+        }
 
-        if (advanceCivilTimeMinute(aCivilTime, minute)) {
-            if (errno != EAGAIN)
+        weekDay %= DaysInWeek;
+
+        if ('L' == *itemPtr) {
+            self->mLastWeekDays |= 1u << weekDay;
+        } else {
+            unsigned long long nth;
+
+            itemPtr = parseULongLong(&nth, itemPtr + 1);
+
+            if (!itemPtr || *itemPtr || nth < 1 || nth > 5) {
+                errno = EINVAL;
                 goto Finally;
+            }
+
+            self->mNthWeekDays[weekDay] |= 1u << (nth - 1);
         }
+
+        added = 1;
     }
 
     rc = 0;
 
 Finally:
 
-    return rc;
+    return rc ? -1 : added;
 }
 
-/* -------------------------------------------------------------------------- */
 static int
-queryScheduleHour_(const struct Schedule *self, struct CivilTime *aCivilTime)
+filterScheduleMonthDays_(
+    struct ScheduleMonthDays *self,
+    char **aField,
+    int (*aAddFn)(struct ScheduleMonthDays *, const char *))
 {
     int rc = -1;
 
-    while (1) {
+    /* Move the items that select days depending on the month into the
+     * month days, and compact the remaining items in place so that they
+     * can be used to initialise the ring. Such items cannot be combined
+     * with a wildcard.
+     */
 
-        int matched = 1;
+    char *field = *aField;
+    char *fieldPtr = field;
+    char *keptPtr = field;
 
-        if (queryBitRingPopulation(&self->mSchedules[ScheduleHours])) {
-            matched =
-                queryBitRingMembership(
-                    &self->mSchedules[ScheduleHours],
-                    queryCivilTimeClock(aCivilTime).mHour);
-        }
+    unsigned kept = 0;
+    unsigned added = 0;
+    int wildcard = 0;
 
-        if (matched) {
-            if (!queryScheduleMinute_(self, aCivilTime))
-                break;
-            if (EAGAIN != errno)
-                goto Finally;
-        }
+    while (fieldPtr) {
+        char *item = strsep(&fieldPtr, ",");
 
-        int hour =
-            queryScheduleNext_(
-                self,
-                ScheduleHours,
-                queryCivilTimeWallClock(aCivilTime).mHour);
-        if (-1 == hour)
+        int addedItem = aAddFn(self, item);
+        if (-1 == addedItem)
             goto Finally;
 
-        if (advanceCivilTimeHour(aCivilTime, hour)) {
-            if (EAGAIN != errno)
-                goto Finally;
+        if (addedItem) {
+            ++added;
+            continue;
         }
+
+        if ('*' == item[0])
+            wildcard = 1;
+
+        if (kept++)
+            *keptPtr++ = ',';
+
+        size_t itemLen = strlen(item);
+
+        memmove(keptPtr, item, itemLen);
+        keptPtr += itemLen;
+    }
+
+    *keptPtr = 0;
+
+    if (added && wildcard) {
+        errno = EINVAL;
+        goto Finally;
     }
 
+    if (added && !kept)
+        *aField = 0;
+
     rc = 0;
 
 Finally:
@@ -244,234 +327,2607 @@ Finally:
 
 /* -------------------------------------------------------------------------- */
 static int
-queryScheduleDay_(const struct Schedule *self, struct CivilTime *aCivilTime)
+queryScheduleMonthLength_(int aYear, int aMonth)
 {
-    int rc = -1;
-
-    while (1) {
+    static const int Days[] = {
+        31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31,
+    };
 
-        int matched = 1;
+    int leapYear = !(aYear % 4) && (aYear % 100 || !(aYear % 400));
 
-        do {
-            struct Calendar calendar = queryCivilTimeCalendar(aCivilTime);
+    return Days[aMonth-1] + (2 == aMonth && leapYear);
+}
 
-            int day     = calendar.mDay;
-            int weekDay = calendar.mWeekDay;
+static uint32_t
+queryScheduleMonthDays_(const struct Schedule *self, struct Calendar aCalendar)
+{
+    const struct ScheduleMonthDays *monthDays = &self->mMonthDays;
 
-            if ((queryBitRingPopulation(&self->mSchedules[ScheduleWeekDays]) ||
-                    queryBitRingPopulation(&self->mSchedules[ScheduleDays]))) {
-                matched =
-                    queryBitRingMembership(
-                        &self->mSchedules[ScheduleWeekDays], weekDay) |
-                    queryBitRingMembership(
-                        &self->mSchedules[ScheduleDays], day);
-            }
+    /* Compute the days of the month selected by the month days, using
+     * the day of the week of the first day of the month, and the number
+     * of days in the month. Bit 0 of the result is the 1st.
+     */
 
-        } while (0);
+    int lastDay = queryScheduleMonthLength_(
+        nominalCivilTimeValue_(aCalendar.mYear),
+        nominalCivilTimeValue_(aCalendar.mMonth));
 
-        if (matched) {
-            if (!queryScheduleHour_(self, aCivilTime))
-                break;
-            if (EAGAIN != errno)
-                goto Finally;
-        }
+    int firstWeekDay = (
+        nominalCivilTimeValue_(aCalendar.mWeekDay) -
+        (nominalCivilTimeValue_(aCalendar.mDay) - 1) % DaysInWeek +
+        DaysInWeek) % DaysInWeek;
+    int lastWeekDay = (firstWeekDay + lastDay - 1) % DaysInWeek;
 
-        struct Calendar wallCalendar = queryCivilTimeWallCalendar(aCivilTime);
+    uint32_t days = 0;
 
-        int wallWeekDay = wallCalendar.mWeekDay;
-        int wallDay     = wallCalendar.mDay;
-        int wallMonth   = wallCalendar.mMonth;
+    if (monthDays->mLastDay)
+        days |= (uint32_t) 1 << (lastDay - 1);
 
-        int skipWeekDays = queryBitRingMemberSeparation(
-            &self->mSchedules[ScheduleWeekDays], wallWeekDay);
-        if (-1 == skipWeekDays)
-            goto Finally;
+    /* The nearest weekday does not leave the month, so a Saturday on the
+     * 1st moves forward to Monday the 3rd, and a Sunday on the last day
+     * moves back to the Friday before.
+     */
 
-        int skipDays = queryBitRingMemberSeparation(
-            &self->mSchedules[ScheduleDays], wallDay);
-        if (-1 == skipDays)
-            goto Finally;
+    if (monthDays->mLastWeekDay) {
+        int day = lastDay;
 
-        int deltaDays;
-        if (skipWeekDays && skipDays)
-            deltaDays = skipWeekDays < skipDays ? skipWeekDays : skipDays;
-        else if (skipWeekDays)
-            deltaDays = skipWeekDays;
-        else if (skipDays)
-            deltaDays = skipDays;
-        else
-            deltaDays = 1;
+        if (Saturday == lastWeekDay)
+            day -= 1;
+        else if (Sunday == lastWeekDay)
+            day -= 2;
 
-        int lastDay =
-            (wallCalendar.mCalendar[wallMonth-1]
-                - wallCalendar.mCalendar[wallMonth]);
+        days |= (uint32_t) 1 << (day - 1);
+    }
 
-        if (deltaDays > lastDay - wallDay) {
-            errno = EAGAIN;
-            goto Finally;
-        }
+    for (uint32_t nearest = monthDays->mNearestWeekDays; nearest; ) {
+        int day = __builtin_ctz(nearest) + 1;
 
-        if (advanceCivilTimeDay(aCivilTime, wallDay + deltaDays)) {
-            if (EAGAIN != errno)
-                goto Finally;
-        }
-    }
+        nearest &= nearest - 1;
 
-    rc = 0;
+        if (day > lastDay)
+            break;
 
-Finally:
+        int weekDay = (firstWeekDay + day - 1) % DaysInWeek;
 
-    return rc;
-}
+        if (Saturday == weekDay)
+            day = 1 == day ? day + 2 : day - 1;
+        else if (Sunday == weekDay)
+            day = lastDay == day ? day - 2 : day + 1;
 
-/* -------------------------------------------------------------------------- */
-static int
-queryScheduleMonth_(const struct Schedule *self, struct CivilTime *aCivilTime)
-{
-    int rc = -1;
+        days |= (uint32_t) 1 << (day - 1);
+    }
 
-    while (1) {
+    for (int weekDay = 0; weekDay < DaysInWeek; ++weekDay) {
 
-        int matched = 1;
+        int firstDay = 1 + (weekDay - firstWeekDay + DaysInWeek) % DaysInWeek;
 
-        if (queryBitRingPopulation(&self->mSchedules[ScheduleMonths])) {
-            matched =
-                queryBitRingMembership(
-                    &self->mSchedules[ScheduleMonths],
-                    queryCivilTimeCalendar(aCivilTime).mMonth);
+        if (monthDays->mLastWeekDays >> weekDay & 1) {
+            days |= (uint32_t) 1 << (
+                lastDay - 1 -
+                (lastWeekDay - weekDay + DaysInWeek) % DaysInWeek);
         }
 
-        if (matched) {
-            if (!queryScheduleDay_(self, aCivilTime))
-                break;
-            if (EAGAIN != errno)
-                goto Finally;
-        }
+        for (unsigned nth = monthDays->mNthWeekDays[weekDay]; nth; ) {
+            int day = firstDay + DaysInWeek * __builtin_ctz(nth);
 
-        int month =
-            queryScheduleNext_(
-                self,
-                ScheduleMonths,
-                queryCivilTimeWallCalendar(aCivilTime).mMonth);
-        if (-1 == month)
-            goto Finally;
+            nth &= nth - 1;
 
-        if (advanceCivilTimeMonth(aCivilTime, month)) {
-            if (EAGAIN != errno)
-                goto Finally;
+            if (day <= lastDay)
+                days |= (uint32_t) 1 << (day - 1);
         }
     }
 
-    rc = 0;
-
-Finally:
-
-    return rc;
+    return days;
 }
 
 /* -------------------------------------------------------------------------- */
-static int
-queryScheduleYear_(const struct Schedule *self, struct CivilTime *aCivilTime)
+static const struct BitRingHash *
+initScheduleHash_(
+    struct BitRingHash *self, const char *aKey, unsigned aField, int aMax)
 {
-    int rc = -1;
+    /* Hash the key using FNV-1a, then mix in the field so that each
+     * field of the same job is spread independently. Fold the upper
+     * bits into the lower bits since members are chosen modulo the
+     * range of the field. Without a key, H cannot be used.
+     */
 
-    while (queryScheduleMonth_(self, aCivilTime)) {
-        if (EAGAIN != errno)
-            goto Finally;
+    if (!aKey)
+        return 0;
 
-        int year = queryCivilTimeCalendar(aCivilTime).mYear;
+    unsigned char field = aField;
 
-        if (advanceCivilTimeYear(aCivilTime, year+1)) {
-            if (EAGAIN != errno)
-                goto Finally;
-        }
-    }
+    uint64_t hash = queryFnvHash(FNV_OFFSET_BASIS, aKey, strlen(aKey));
 
-    rc = 0;
+    hash = queryFnvHash(hash, &field, sizeof(field));
 
-Finally:
+    self->mHash = hash ^ hash >> 32;
+    self->mMax = aMax;
 
-    return rc;
+    return self;
 }
 
 /* -------------------------------------------------------------------------- */
-time_t
-querySchedule(
-    const struct Schedule *self,
-    const struct CivilTime *aCivilTime,
-    time_t aJitterPeriod,
-    int *aJitter)
+struct Schedule *
+initSchedule(struct Schedule *self, const char *aSchedule)
 {
-    int rc = -1;
+    return initScheduleKey(self, aSchedule, 0);
+}
 
-    struct CivilTime schedTime_ = *aCivilTime, *schedTime = &schedTime_;
+/* -------------------------------------------------------------------------- */
+struct Schedule *
+initScheduleKey(struct Schedule *self, const char *aSchedule, const char *aKey)
+{
+    int rc = -1;
 
-    if (queryScheduleYear_(self, schedTime))
+    char *schedule = strdup(aSchedule);
+    if (!schedule)
         goto Finally;
 
-    int jitter = 0;
-
-    time_t scheduled = queryCivilTimeUtc(schedTime);
+    static const char CronSep[] = "\t ";
 
-    /* If a jitter time is requested, try to build a triangular probability
-     * density function centred around the scheduled time. Determine the
-     * duration until the scheduled time, and the jitter window which
-     * comprises the period from the scheduled time to the next
-     * scheduled time.
+    /* The schedule comprises the five crontab(5) fields, optionally
+     * preceded by a field for the seconds. A schedule with seconds
+     * can also be followed by a field for the years.
      */
 
-    if (aJitterPeriod) {
-        struct CivilTime nextSchedTime_, *nextSchedTime = &nextSchedTime_;
-
-        if (!initCivilTime(nextSchedTime, scheduled + 60))
-            goto Finally;
-
-        if (queryScheduleYear_(self, nextSchedTime))
-            goto Finally;
+    char *scheduleWords[7];
+    size_t numScheduleWords = 0;
 
-        time_t nextScheduled = queryCivilTimeUtc(nextSchedTime);
+    char *schedulePtr = schedule;
 
-        if (nextScheduled <= scheduled) {
+    while (schedulePtr) {
+        if (NUMBEROF(scheduleWords) == numScheduleWords) {
             errno = EINVAL;
             goto Finally;
         }
 
-        /* The lhs period might be zero if there is no time until
-         * the scheduled time. In this case, use a one-sided
-         * probably density function.
-         *
-         * The rhs period is limited to half the jitter window to
-         * leave time for the subsequent occurence to be equally
-         * early or late.
-         */
+        scheduleWords[numScheduleWords++] = strsep(&schedulePtr, CronSep);
+    }
 
-        time_t rhsPeriod = (nextScheduled - scheduled) / 2;
-        time_t lhsPeriod = scheduled - queryCivilTimeUtc(aCivilTime);
+    if (5 > numScheduleWords) {
+        errno = EINVAL;
+        goto Finally;
+    }
 
-        time_t period =
-            lhsPeriod && lhsPeriod < rhsPeriod ? lhsPeriod : rhsPeriod;
+    char **cronWords = &scheduleWords[5 < numScheduleWords];
 
-        if (period > aJitterPeriod)
-            period = aJitterPeriod;
+    /* Hashed fields choose from the full range of each field, except
+     * that the day of the month is limited to days found in every month,
+     * and the day of the week to the canonical 0-6 range.
+     */
 
-        int rand = random();
+    struct BitRingHash hashStorage[ScheduleKinds+1];
+    const struct BitRingHash *hashes[ScheduleKinds+1];
+
+    static const int HashMax[ScheduleKinds+1] = {
+        [ScheduleMinutes] = 59,
+        [ScheduleHours] = 23,
+        [ScheduleDays] = 28,
+        [ScheduleMonths] = 12,
+        [ScheduleWeekDays] = 6,
+        [ScheduleKinds] = 59,
+    };
+
+    for (unsigned hx = 0; hx < NUMBEROF(hashes); ++hx)
+        hashes[hx] = initScheduleHash_(
+            &hashStorage[hx], aKey, hx, HashMax[hx]);
+
+    if (!initBitRingHash(&self->mSeconds, 0, 59,
+            cronWords == scheduleWords ? 0 : scheduleWords[0],
+            hashes[ScheduleKinds]))
+        goto Finally;
 
-        jitter = period * (1 - sqrt(rand / ((1UL<<31) - 1.0)));
+    if (!initScheduleYears_(&self->mYears,
+            7 == numScheduleWords ? scheduleWords[6] : 0))
+        goto Finally;
 
-        if ((rand % 2) && lhsPeriod)
-            jitter = 0 - jitter;
+    self->mBegin = 0;
+    self->mEnd = 0;
 
-        scheduled += jitter;
-    }
+    self->mExclusion = 0;
 
-    if (aJitter)
-        *aJitter = jitter;
+    /* Keep the seconds in a canonical form so that schedules that only
+     * select the start of each minute are identical regardless of their
+     * spelling, noting that a wildcard must select every second.
+     */
 
-    rc = 0;
+    if (cronWords != scheduleWords) {
+        if (!queryBitRingPopulation(&self->mSeconds)) {
+            for (int second = 0; second <= 59; ++second) {
+                if (addBitRingMember(&self->mSeconds, second))
+                    goto Finally;
+            }
+        } else if (1 == self->mSeconds.mRing) {
+            self->mSeconds.mRing = 0;
+        }
+    }
 
-Finally:
+    memset(&self->mMonthDays, 0, sizeof(self->mMonthDays));
 
-    return rc ? -1 : scheduled;
-}
+    if (filterScheduleMonthDays_(
+            &self->mMonthDays, &cronWords[2], addScheduleMonthDay_))
+        goto Finally;
+
+    if (filterScheduleMonthDays_(
+            &self->mMonthDays, &cronWords[4], addScheduleMonthWeekDay_))
+        goto Finally;
+
+    if (!initBitRingHash(
+            &self->mSchedules[ScheduleMinutes], 0, 59, cronWords[0],
+            hashes[ScheduleMinutes]))
+        goto Finally;
+
+    if (!initBitRingHash(
+            &self->mSchedules[ScheduleHours], 0, 23, cronWords[1],
+            hashes[ScheduleHours]))
+        goto Finally;
+
+    if (!initBitRingHash(
+            &self->mSchedules[ScheduleDays], 1, 31, cronWords[2],
+            hashes[ScheduleDays]))
+        goto Finally;
+
+    if (!initBitRingHash(
+            &self->mSchedules[ScheduleMonths], 1, 12, cronWords[3],
+            hashes[ScheduleMonths]))
+        goto Finally;
+
+    struct BitRing weekDays;
+
+    if (!initBitRingHash(
+            &weekDays, 0, 7, cronWords[4], hashes[ScheduleWeekDays]))
+        goto Finally;
+
+    int firstDay = queryBitRingMin(&weekDays);
+    int lastDay = queryBitRingMax(&weekDays);
+
+    if (!initBitRing(
+            &self->mSchedules[ScheduleWeekDays],
+            firstDay,
+            firstDay + DaysInWeek - 1, 0))
+        goto Finally;
+
+    /* Transfer the selected days of the week from the 0-7 range to the
+     * canononical 0-6 range.
+     */
+
+    for (int weekday = firstDay; ; ++weekday) {
+
+        if (queryBitRingMembership(&weekDays, weekday)) {
+            if (addBitRingMember(
+                    &self->mSchedules[ScheduleWeekDays],
+                    firstDay + (weekday - firstDay) % DaysInWeek))
+                goto Finally;
+        }
+
+        if (weekday == lastDay)
+            break;
+    }
+
+    classifySchedule_(self);
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        free(schedule);
+        schedule = 0;
+    });
+
+    return rc ? 0 : self;
+}
+
+/* -------------------------------------------------------------------------- */
+struct Schedule *
+boundSchedule(struct Schedule *self, time_t aBegin, time_t aEnd)
+{
+    int rc = -1;
+
+    /* Either bound of the validity window can be left open by using
+     * zero, and both bounds are inclusive.
+     */
+
+    if (0 > aBegin || 0 > aEnd || (aEnd && aBegin > aEnd)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    self->mBegin = aBegin;
+    self->mEnd = aEnd;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : self;
+}
+
+/* -------------------------------------------------------------------------- */
+struct Schedule *
+excludeSchedule(
+    struct Schedule *self, const struct ScheduleExclusion *aExclusion)
+{
+    /* An empty calendar excludes no dates, and is not retained so that
+     * the shape of the schedule is unchanged.
+     */
+
+    self->mExclusion = aExclusion && aExclusion->mLength ? aExclusion : 0;
+
+    classifySchedule_(self);
+
+    return self;
+}
+
+/* -------------------------------------------------------------------------- */
+enum ScheduleFingerprintSection {
+    ScheduleFingerprintSeconds = 1,
+    ScheduleFingerprintWindow,
+    ScheduleFingerprintMonthDays,
+    ScheduleFingerprintExclusion,
+};
+
+static void
+mixScheduleFingerprint_(struct ScheduleFingerprint *self, uint64_t aWord)
+{
+    /* Use the SplitMix64 finaliser so that every bit of the input
+     * affects every bit of the output, and chain the words so that
+     * each depends on those before it.
+     */
+
+    for (unsigned wx = 0; wx < NUMBEROF(self->mWords); ++wx) {
+        uint64_t word = (self->mWords[wx] ^ aWord) * FNV_PRIME;
+
+        word ^= word >> 30;
+        word *= UINT64_C(0xbf58476d1ce4e5b9);
+        word ^= word >> 27;
+        word *= UINT64_C(0x94d049bb133111eb);
+        word ^= word >> 31;
+
+        self->mWords[wx] = word;
+    }
+
+    for (unsigned wx = 1; wx < NUMBEROF(self->mWords); ++wx)
+        self->mWords[wx] ^= self->mWords[wx-1];
+}
+
+struct ScheduleFingerprint *
+queryScheduleFingerprint(
+    const struct Schedule *self, struct ScheduleFingerprint *aFingerprint)
+{
+    /* The range of each ring is fixed by its kind, and a wildcard is
+     * kept as an empty ring, so the rings are a canonical form of the
+     * schedule. Different spellings of the same schedule, such as
+     * 0-59/15 and 0,15,30,45, produce the same rings, but a wildcard
+     * remains distinct from an explicit list of every member because
+     * the two behave differently across daylight saving changes.
+     */
+
+    aFingerprint->mWords[0] = UINT64_C(0x9e3779b97f4a7c15);
+    aFingerprint->mWords[1] = UINT64_C(0x6a09e667f3bcc909);
+
+    for (unsigned kx = 0; kx < ScheduleKinds; ++kx)
+        mixScheduleFingerprint_(aFingerprint, self->mSchedules[kx].mRing);
+
+    /* The remaining sections are optional, and are only mixed in if
+     * they constrain the schedule. Each section starts with its own
+     * tag, and has a length fixed by the tag, so that the content of
+     * one section cannot be mistaken for that of another.
+     */
+
+    if (queryBitRingPopulation(&self->mSeconds)) {
+        mixScheduleFingerprint_(aFingerprint, ScheduleFingerprintSeconds);
+        mixScheduleFingerprint_(aFingerprint, self->mSeconds.mRing);
+    }
+
+    if (queryBitRingPopulation(&self->mYears) || self->mBegin || self->mEnd) {
+        uint64_t window[] = {
+            self->mYears.mRing,
+            queryBitRingPopulation(&self->mYears) ? self->mYears.mMin : 0,
+            self->mBegin,
+            self->mEnd,
+        };
+
+        mixScheduleFingerprint_(aFingerprint, ScheduleFingerprintWindow);
+
+        for (unsigned ix = 0; ix < NUMBEROF(window); ++ix)
+            mixScheduleFingerprint_(aFingerprint, window[ix]);
+    }
+
+    if (queryScheduleMonthDaysPopulation(&self->mMonthDays)) {
+        uint64_t monthDays[2];
+
+        packScheduleMonthDays_(&self->mMonthDays, monthDays);
+
+        mixScheduleFingerprint_(aFingerprint, ScheduleFingerprintMonthDays);
+
+        for (unsigned ix = 0; ix < NUMBEROF(monthDays); ++ix)
+            mixScheduleFingerprint_(aFingerprint, monthDays[ix]);
+    }
+
+    /* The excluded dates are mixed in by content so that schedules
+     * using equivalent calendars have the same fingerprint. This is
+     * the last section, so its length need not be fixed.
+     */
+
+    if (self->mExclusion) {
+        const struct ScheduleExclusion *exclusion = self->mExclusion;
+
+        mixScheduleFingerprint_(aFingerprint, ScheduleFingerprintExclusion);
+
+        for (size_t yx = 0; yx < exclusion->mLength; ++yx) {
+            const struct ScheduleExclusionYear *year = &exclusion->mYears[yx];
+
+            for (unsigned mx = 0; mx < NUMBEROF(year->mMonths); ++mx) {
+                if (!year->mMonths[mx])
+                    continue;
+
+                uint64_t month =
+                    (uint64_t) (year->mYear * 12 + mx) << 32 |
+                    year->mMonths[mx];
+
+                mixScheduleFingerprint_(aFingerprint, month);
+            }
+        }
+    }
+
+    return aFingerprint;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+compareScheduleFingerprints(
+    const struct ScheduleFingerprint *aLhs,
+    const struct ScheduleFingerprint *aRhs)
+{
+    for (unsigned wx = 0; wx < NUMBEROF(aLhs->mWords); ++wx) {
+        if (aLhs->mWords[wx] != aRhs->mWords[wx])
+            return aLhs->mWords[wx] < aRhs->mWords[wx] ? -1 : +1;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+enum ScheduleOdometer {
+    ScheduleOdometerSecond,
+    ScheduleOdometerMinute,
+    ScheduleOdometerHour,
+    ScheduleOdometerDay,
+    ScheduleOdometerMonth,
+    ScheduleOdometerYear,
+};
+
+/* -------------------------------------------------------------------------- */
+static int
+matchScheduleField_(
+    const struct Schedule *self, enum ScheduleKind aScheduleKind, int aValue)
+{
+    const struct BitRing *bitring = &self->mSchedules[aScheduleKind];
+
+    return
+        !queryBitRingPopulation(bitring) ||
+        queryBitRingMembership(bitring, aValue);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+matchScheduleSecond_(const struct Schedule *self, int aSecond)
+{
+    /* Unlike the other fields, a schedule without seconds does not
+     * match every second, but only the start of each minute.
+     */
+
+    return
+        queryBitRingPopulation(&self->mSeconds)
+            ? queryBitRingMembership(&self->mSeconds, aSecond)
+            : 0 == aSecond;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+matchScheduleYear_(const struct Schedule *self, int aYear)
+{
+    return
+        !queryBitRingPopulation(&self->mYears) ||
+        queryBitRingMembership(&self->mYears, aYear);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+matchScheduleWindow_(const struct Schedule *self, time_t aTime)
+{
+    return
+        (!self->mBegin || aTime >= self->mBegin) &&
+        (!self->mEnd || aTime <= self->mEnd);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+matchScheduleDay_(const struct Schedule *self, struct Calendar aCalendar)
+{
+    const struct BitRing *weekDays = &self->mSchedules[ScheduleWeekDays];
+    const struct BitRing *days = &self->mSchedules[ScheduleDays];
+
+    /* Excluded dates never match, even if a daylight savings change
+     * has masked the day.
+     */
+
+    if (self->mExclusion && matchScheduleExclusion(
+            self->mExclusion,
+            nominalCivilTimeValue_(aCalendar.mYear),
+            nominalCivilTimeValue_(aCalendar.mMonth),
+            nominalCivilTimeValue_(aCalendar.mDay)))
+        return 0;
+
+    /* If either the days of the week, or the days of the month, are
+     * constrained, the day matches if it is selected by either. The
+     * month days constrain both, and like the rings, do not match a
+     * day masked by a daylight savings change.
+     */
+
+    int monthDays = queryScheduleMonthDaysPopulation(&self->mMonthDays);
+
+    return
+        (!queryBitRingPopulation(weekDays) &&
+         !queryBitRingPopulation(days) &&
+         !monthDays) ||
+        queryBitRingMembership(weekDays, aCalendar.mWeekDay) ||
+        queryBitRingMembership(days, aCalendar.mDay) ||
+        (monthDays && 0 < aCalendar.mDay &&
+         (queryScheduleMonthDays_(self, aCalendar) >> (aCalendar.mDay - 1)
+            & 1));
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+matchScheduleTime_(
+    const struct Schedule *self,
+    struct Calendar aCalendar,
+    struct Clock aClock)
+{
+    return
+        matchScheduleYear_(self, aCalendar.mYear) &&
+        matchScheduleField_(self, ScheduleMonths, aCalendar.mMonth) &&
+        matchScheduleDay_(self, aCalendar) &&
+        matchScheduleField_(self, ScheduleHours, aClock.mHour) &&
+        matchScheduleField_(self, ScheduleMinutes, aClock.mMinute) &&
+        matchScheduleSecond_(self, aClock.mSecond);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+queryScheduleNext_(
+    const struct Schedule *self, enum ScheduleKind aScheduleKind, int aValue)
+{
+    int rc = -1;
+
+    const struct BitRing *bitring = &self->mSchedules[aScheduleKind];
+
+    /* Find the next candidate following the specified value. The candidate
+     * lies beyond the end of the field if the field must carry.
+     */
+
+    int delta = queryBitRingMemberSeparation(bitring, aValue);
+    if (-1 == delta)
+        goto Finally;
+
+    if (!delta)
+        delta = 1;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : aValue + delta;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+queryScheduleNextSecond_(const struct Schedule *self, int aSecond)
+{
+    int rc = -1;
+
+    /* A schedule without seconds must always carry into the next minute. */
+
+    int delta = 60 - aSecond;
+
+    if (queryBitRingPopulation(&self->mSeconds)) {
+        delta = queryBitRingMemberSeparation(&self->mSeconds, aSecond);
+        if (-1 == delta)
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : aSecond + delta;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+queryScheduleNextYear_(const struct Schedule *self, int aYear)
+{
+    int rc = -1;
+
+    const struct BitRing *years = &self->mYears;
+
+    /* Unlike the other fields, the years do not wrap around, so there
+     * is no candidate following the last selected year.
+     */
+
+    int nextYear = aYear + 1;
+
+    if (queryBitRingPopulation(years)) {
+
+        if (nextYear < queryBitRingMin(years))
+            nextYear = queryBitRingMin(years);
+
+        while (!queryBitRingMembership(years, nextYear)) {
+            if (nextYear >= queryBitRingMax(years)) {
+                errno = ENOENT;
+                goto Finally;
+            }
+            ++nextYear;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : nextYear;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+queryScheduleDaySkip_(int aSkipWeekDays, int aSkipDays, int aSkipMonthDays)
+{
+    /* Each of the days of the week, the days of the month, and the month
+     * days is either unconstrained, or proposes a number of days to skip.
+     * Take the least proposal, or the next day if all are unconstrained.
+     */
+
+    int skips[] = { aSkipWeekDays, aSkipDays, aSkipMonthDays };
+
+    int deltaDays = 0;
+
+    for (unsigned sx = 0; sx < NUMBEROF(skips); ++sx) {
+        if (skips[sx] && (!deltaDays || skips[sx] < deltaDays))
+            deltaDays = skips[sx];
+    }
+
+    return deltaDays ? deltaDays : 1;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+queryScheduleDaySeparation_(
+    const struct Schedule *self, int aWeekDay, int aDay, uint32_t aMonthDays)
+{
+    int rc = -1;
+
+    int skipWeekDays = queryBitRingMemberSeparation(
+        &self->mSchedules[ScheduleWeekDays], aWeekDay);
+    if (-1 == skipWeekDays)
+        goto Finally;
+
+    int skipDays = queryBitRingMemberSeparation(
+        &self->mSchedules[ScheduleDays], aDay);
+    if (-1 == skipDays)
+        goto Finally;
+
+    /* The month days do not leave the month, so if none remain, the
+     * candidate lies beyond the end of the month.
+     */
+
+    int skipMonthDays = 0;
+
+    if (queryScheduleMonthDaysPopulation(&self->mMonthDays)) {
+        uint32_t monthDays = aMonthDays >> aDay;
+
+        skipMonthDays =
+            monthDays ? __builtin_ctz(monthDays) + 1 : 32 - aDay;
+    }
+
+    int deltaDays =
+        queryScheduleDaySkip_(skipWeekDays, skipDays, skipMonthDays);
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : deltaDays;
+}
+
+static int
+queryScheduleNextDay_(const struct Schedule *self, struct Calendar aCalendar)
+{
+    int rc = -1;
+
+    /* Use the bitmap of the excluded days of the month to pass over
+     * the candidates that are excluded, rather than visiting each of
+     * them in turn. Days beyond the end of the month are never excluded,
+     * so the candidate can still carry into the next month.
+     */
+
+    uint32_t excluded = 0;
+
+    if (self->mExclusion)
+        excluded = queryScheduleExclusionMonth(
+            self->mExclusion, aCalendar.mYear, aCalendar.mMonth);
+
+    uint32_t monthDays = 0;
+
+    if (queryScheduleMonthDaysPopulation(&self->mMonthDays))
+        monthDays = queryScheduleMonthDays_(self, aCalendar);
+
+    int day = aCalendar.mDay;
+    int weekDay = aCalendar.mWeekDay;
+
+    do {
+        int deltaDays = queryScheduleDaySeparation_(
+            self, weekDay, day, monthDays);
+        if (-1 == deltaDays)
+            goto Finally;
+
+        day += deltaDays;
+        weekDay = (weekDay + deltaDays) % DaysInWeek;
+
+    } while (day <= 31 && (excluded >> (day - 1) & 1));
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : day;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+searchSchedule_(
+    const struct Schedule *self,
+    struct CivilTime *aCivilTime,
+    int aResume,
+    time_t aHorizon,
+    unsigned long aStepLimit,
+    unsigned long *aSteps)
+{
+    int rc = -1;
+
+    /* The search is structured as an odometer that starts with the month,
+     * or the year if the schedule selects years, and works towards the
+     * minute, or the second if the schedule selects seconds or the
+     * search starts part way through a minute. A field that matches
+     * passes to the next finer field. Otherwise the field is advanced
+     * to its next candidate, rewinding all the finer fields, and is
+     * checked again. A field that has no further candidates carries
+     * into the next coarser field, which must then be advanced. There
+     * are no further occurrences once the selected years are exhausted.
+     *
+     * When resuming, the civil time is positioned at a previous occurrence
+     * of the schedule. Each field still matches, so the search reaches
+     * the finest field, and only there steps past the previous occurrence.
+     *
+     * The search is abandoned if it exhausts the step limit, or if the
+     * civil time passes the horizon. Leaving a transition period can
+     * return the civil time to the start of that period, so the horizon
+     * is only considered outside transition periods.
+     */
+
+    enum ScheduleOdometer coarsest =
+        queryBitRingPopulation(&self->mYears)
+            ? ScheduleOdometerYear
+            : ScheduleOdometerMonth;
+
+    enum ScheduleOdometer odometer = coarsest;
+
+    enum ScheduleOdometer finest =
+        queryBitRingPopulation(&self->mSeconds) ||
+        queryCivilTimeWallClock(aCivilTime).mSecond
+            ? ScheduleOdometerSecond
+            : ScheduleOdometerMinute;
+
+    int carry = 0;
+
+    while (1) {
+
+        if (aStepLimit && *aSteps >= aStepLimit) {
+            errno = ETIMEDOUT;
+            goto Finally;
+        }
+
+        ++*aSteps;
+
+        int matched = 0;
+        int next = -1;
+        int last = -1;
+
+        switch (odometer) {
+
+        case ScheduleOdometerSecond:
+            if (!carry && !aResume) {
+                matched = matchScheduleSecond_(
+                    self, queryCivilTimeClock(aCivilTime).mSecond);
+            }
+            if (!matched) {
+                next = queryScheduleNextSecond_(
+                    self, queryCivilTimeWallClock(aCivilTime).mSecond);
+                last = 59;
+            }
+            break;
+
+        case ScheduleOdometerMinute:
+            if (!carry && (!aResume || ScheduleOdometerMinute != finest)) {
+                matched = matchScheduleField_(
+                    self,
+                    ScheduleMinutes,
+                    queryCivilTimeClock(aCivilTime).mMinute);
+            }
+            if (!matched) {
+                next = queryScheduleNext_(
+                    self,
+                    ScheduleMinutes,
+                    queryCivilTimeWallClock(aCivilTime).mMinute);
+                last = queryBitRingMax(&self->mSchedules[ScheduleMinutes]);
+            }
+            break;
+
+        case ScheduleOdometerHour:
+            if (!carry) {
+                matched = matchScheduleField_(
+                    self,
+                    ScheduleHours,
+                    queryCivilTimeClock(aCivilTime).mHour);
+            }
+            if (!matched) {
+                next = queryScheduleNext_(
+                    self,
+                    ScheduleHours,
+                    queryCivilTimeWallClock(aCivilTime).mHour);
+                last = queryBitRingMax(&self->mSchedules[ScheduleHours]);
+            }
+            break;
+
+        case ScheduleOdometerDay:
+            if (!carry) {
+                matched = matchScheduleDay_(
+                    self, queryCivilTimeCalendar(aCivilTime));
+            }
+            if (!matched) {
+                struct Calendar wallCalendar =
+                    queryCivilTimeWallCalendar(aCivilTime);
+
+                next = queryScheduleNextDay_(self, wallCalendar);
+                last =
+                    wallCalendar.mCalendar[wallCalendar.mMonth-1] -
+                    wallCalendar.mCalendar[wallCalendar.mMonth];
+            }
+            break;
+
+        case ScheduleOdometerMonth:
+            if (!carry) {
+                matched = matchScheduleField_(
+                    self,
+                    ScheduleMonths,
+                    queryCivilTimeCalendar(aCivilTime).mMonth);
+            }
+            if (!matched) {
+                next = queryScheduleNext_(
+                    self,
+                    ScheduleMonths,
+                    queryCivilTimeWallCalendar(aCivilTime).mMonth);
+                last = queryBitRingMax(&self->mSchedules[ScheduleMonths]);
+            }
+            break;
+
+        case ScheduleOdometerYear:
+            if (!carry) {
+                matched = matchScheduleYear_(
+                    self, queryCivilTimeCalendar(aCivilTime).mYear);
+            }
+            if (!matched) {
+                next = queryScheduleNextYear_(
+                    self, queryCivilTimeWallCalendar(aCivilTime).mYear);
+                last = next;
+            }
+            break;
+        }
+
+        if (matched) {
+            if (finest == odometer)
+                break;
+
+            --odometer;
+            continue;
+        }
+
+        if (-1 == next)
+            goto Finally;
+
+        if (next > last) {
+            ++odometer;
+            carry = 1;
+            continue;
+        }
+
+        int advanced = 0;
+
+        switch (odometer) {
+        case ScheduleOdometerSecond:
+            advanced = advanceCivilTimeSecond(aCivilTime, next);
+            break;
+        case ScheduleOdometerMinute:
+            advanced = advanceCivilTimeMinute(aCivilTime, next);
+            break;
+        case ScheduleOdometerHour:
+            advanced = advanceCivilTimeHour(aCivilTime, next);
+            break;
+        case ScheduleOdometerDay:
+            advanced = advanceCivilTimeDay(aCivilTime, next);
+            break;
+        case ScheduleOdometerMonth:
+            advanced = advanceCivilTimeMonth(aCivilTime, next);
+            break;
+        case ScheduleOdometerYear:
+            advanced = advanceCivilTimeYear(aCivilTime, next);
+            odometer = coarsest;
+            break;
+        }
+
+        /* Advancing the civil time across a daylight savings change
+         * repositions the civil time instead. This is not an error, and
+         * the field is simply checked again.
+         */
+
+        if (-1 == advanced)
+            goto Finally;
+
+        carry = 0;
+        aResume = 0;
+
+        if (-1 != aHorizon) {
+            time_t time = queryCivilTimeUtc(aCivilTime);
+
+            if (time > aHorizon &&
+                    time < queryCivilTimeTransition(aCivilTime)) {
+                errno = ENOENT;
+                goto Finally;
+            }
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+queryScheduleMember_(
+    const struct Schedule *self, enum ScheduleKind aScheduleKind, int aValue)
+{
+    int rc = -1;
+
+    const struct BitRing *bitring = &self->mSchedules[aScheduleKind];
+
+    /* Find the first member that is not earlier than the specified value,
+     * noting that a schedule without members is a wildcard.
+     */
+
+    if (aValue > queryBitRingMax(bitring))
+        goto Finally;
+
+    int member = aValue;
+
+    if (queryBitRingPopulation(bitring) &&
+            !queryBitRingMembership(bitring, aValue)) {
+
+        int delta = queryBitRingMemberSeparation(bitring, aValue);
+        if (-1 == delta)
+            goto Finally;
+
+        if (delta > queryBitRingMax(bitring) - aValue)
+            goto Finally;
+
+        member += delta;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : member;
+}
+
+/* -------------------------------------------------------------------------- */
+static time_t
+queryScheduleShape_(
+    const struct Schedule *self,
+    const struct CivilTime *aCivilTime,
+    time_t aSince)
+{
+    int rc = -1;
+
+    if (ScheduleShapeGeneral == self->mShape)
+        goto Finally;
+
+    /* The direct computation proceeds in whole minutes. */
+
+    if (queryBitRingPopulation(&self->mSeconds) || aSince % 60)
+        goto Finally;
+
+    time_t transition = queryCivilTimeTransition(aCivilTime);
+
+    if (aSince >= transition)
+        goto Finally;
+
+    struct Calendar wallCalendar = queryCivilTimeWallCalendar(aCivilTime);
+    struct Clock wallClock = queryCivilTimeWallClock(aCivilTime);
+
+    /* Only the minute, hour and day of the week are constrained, so
+     * the schedule must match within a week of the starting day. While
+     * there is no daylight savings change, local time advances in step
+     * with UTC, so both the wall clock at the starting time, and the
+     * scheduled time can be computed directly.
+     */
+
+    time_t since =
+        wallClock.mHour * 60 + wallClock.mMinute +
+        (aSince - queryCivilTimeUtc(aCivilTime)) / 60;
+
+    int weekDay = (wallCalendar.mWeekDay + since / (24 * 60)) % DaysInWeek;
+    int hour = since % (24 * 60) / 60;
+    int minute = since % 60;
+
+    int elapsed = -1;
+
+    for (int day = 0; -1 == elapsed && day <= DaysInWeek; ++day) {
+
+        int firstHour = hour;
+        int firstMinute = minute;
+
+        if (day) {
+            weekDay = (weekDay + 1) % DaysInWeek;
+            firstHour = 0;
+            firstMinute = 0;
+        }
+
+        if (weekDay != queryScheduleMember_(self, ScheduleWeekDays, weekDay))
+            continue;
+
+        for (int nextHour = queryScheduleMember_(self, ScheduleHours, firstHour);
+                -1 != nextHour;
+                nextHour = queryScheduleMember_(
+                    self, ScheduleHours, nextHour + 1)) {
+
+            int nextMinute = queryScheduleMember_(
+                self,
+                ScheduleMinutes,
+                nextHour == firstHour ? firstMinute : 0);
+
+            if (-1 != nextMinute) {
+                elapsed =
+                    (day * 24 + nextHour - hour) * 60 + nextMinute - minute;
+                break;
+            }
+        }
+    }
+
+    if (-1 == elapsed)
+        goto Finally;
+
+    time_t scheduled = aSince + (time_t) elapsed * 60;
+
+    if (scheduled >= transition)
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : scheduled;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+compareScheduleJobs_(const void *aLhs, const void *aRhs)
+{
+    const struct ScheduleJob *lhs = aLhs;
+    const struct ScheduleJob *rhs = aRhs;
+
+    return strcmp(lhs->mName, rhs->mName);
+}
+
+const struct Schedule *
+queryScheduleJob(
+    const struct ScheduleJob *aJobs, size_t aLength, const char *aName)
+{
+    int rc = -1;
+
+    /* The jobs are sorted by name, as emitted by crontime --emit-c, so
+     * that they can be found using a binary search.
+     */
+
+    const struct ScheduleJob key = { .mName = aName };
+
+    const struct ScheduleJob *job = bsearch(
+        &key, aJobs, aLength, sizeof(*aJobs), compareScheduleJobs_);
+    if (!job) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : job->mSchedule;
+}
+
+/* -------------------------------------------------------------------------- */
+static struct CivilTime *
+initScheduleCivilTime_(
+    struct CivilTime *self, time_t aTime, const struct CivilTime *aSince)
+{
+    int rc = -1;
+
+    /* Civil times start at the beginning of a minute, so advance to the
+     * second if the time lies part way through the minute. If an earlier
+     * civil time is provided, reuse the daylight savings rules found for
+     * it where possible.
+     */
+
+    int second = aTime % 60;
+
+    if (aSince) {
+        if (!initCivilTimeSince(self, aTime - second, aSince))
+            goto Finally;
+    } else {
+        if (!initCivilTime(self, aTime - second))
+            goto Finally;
+    }
+
+    if (second && advanceCivilTimeSecond(self, second))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : self;
+}
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleIterator *
+initScheduleIterator(
+    struct ScheduleIterator *self,
+    const struct Schedule *aSchedule,
+    const struct CivilTime *aCivilTime)
+{
+    self->mSchedule = aSchedule;
+    self->mCivilTime = *aCivilTime;
+    self->mScheduled = -1;
+    self->mPositioned = 0;
+    self->mHorizon = -1;
+    self->mStepLimit = 0;
+    self->mSteps = 0;
+
+    return self;
+}
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleIterator *
+limitScheduleIterator(
+    struct ScheduleIterator *self, time_t aHorizon, unsigned long aStepLimit)
+{
+    int rc = -1;
+
+    if (0 > aHorizon) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    /* The horizon is measured from the most recent occurrence, or from
+     * the initial civil time if there has been no occurrence.
+     */
+
+    time_t since =
+        -1 == self->mScheduled
+            ? queryCivilTimeUtc(&self->mCivilTime)
+            : self->mScheduled;
+
+    self->mHorizon = aHorizon ? since + aHorizon : -1;
+    self->mStepLimit = aStepLimit;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : self;
+}
+
+/* -------------------------------------------------------------------------- */
+time_t
+nextScheduleOccurrence(struct ScheduleIterator *self)
+{
+    int rc = -1;
+
+    const struct Schedule *schedule = self->mSchedule;
+
+    /* Schedules without seconds only occur at the start of each minute. */
+
+    time_t period = queryBitRingPopulation(&schedule->mSeconds) ? 1 : 60;
+
+    time_t since =
+        -1 == self->mScheduled
+            ? queryCivilTimeUtc(&self->mCivilTime)
+            : self->mScheduled + period;
+
+    /* There are no further occurrences once the validity window has
+     * closed. Before the window opens, move the civil time to the start
+     * of the window rather than searching towards it.
+     */
+
+    if (schedule->mEnd && since > schedule->mEnd) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    int reopened = 0;
+
+    if (since < schedule->mBegin) {
+        since = schedule->mBegin + period - 1;
+        since -= since % period;
+
+        if (!initScheduleCivilTime_(&self->mCivilTime, since, 0))
+            goto Finally;
+
+        reopened = 1;
+    }
+
+    time_t horizon = self->mHorizon;
+
+    if (schedule->mEnd && (-1 == horizon || schedule->mEnd < horizon))
+        horizon = schedule->mEnd;
+
+    /* Use the direct computation if possible, noting that this leaves
+     * the civil time behind at its original position. Otherwise fall back
+     * to a search, resuming from the previous occurrence if the civil
+     * time is positioned there.
+     *
+     * The search steps through minutes without regard to daylight
+     * savings changes, and relies on entering each hour afresh to
+     * detect them. Only resume if there is no daylight savings change
+     * in the coming hour, and otherwise reinitialise the civil time
+     * so that any transition period is modelled from the outset.
+     */
+
+    time_t scheduled =
+        queryScheduleShape_(schedule, &self->mCivilTime, since);
+
+    int positioned = self->mPositioned;
+
+    /* The civil time is not positioned at an occurrence if the search
+     * is abandoned part way.
+     */
+
+    self->mPositioned = 0;
+
+    if (-1 == scheduled) {
+
+        int resume = 0;
+
+        if (-1 != self->mScheduled && !reopened) {
+            if (positioned &&
+                    since + 60 * 60 <= queryCivilTimeTransition(
+                        &self->mCivilTime)) {
+                resume = 1;
+            } else {
+                if (!initScheduleCivilTime_(&self->mCivilTime, since, 0))
+                    goto Finally;
+            }
+        }
+
+        /* The step limit applies to each occurrence, but the steps
+         * taken by the search are accumulated across all occurrences.
+         */
+
+        unsigned long stepLimit =
+            self->mStepLimit ? self->mSteps + self->mStepLimit : 0;
+
+        if (searchSchedule_(
+                schedule,
+                &self->mCivilTime,
+                resume,
+                horizon,
+                stepLimit,
+                &self->mSteps))
+            goto Finally;
+
+        scheduled = queryCivilTimeUtc(&self->mCivilTime);
+
+        self->mPositioned = 1;
+    }
+
+    if (-1 != horizon && scheduled > horizon) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    self->mScheduled = scheduled;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : scheduled;
+}
+
+/* -------------------------------------------------------------------------- */
+time_t
+querySchedule(
+    const struct Schedule *self,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon,
+    time_t aJitterPeriod,
+    int *aJitter)
+{
+    int rc = -1;
+
+    struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+    if (!initScheduleIterator(iterator, self, aCivilTime))
+        goto Finally;
+
+    if (!limitScheduleIterator(iterator, aHorizon, 0))
+        goto Finally;
+
+    time_t scheduled = nextScheduleOccurrence(iterator);
+    if (-1 == scheduled)
+        goto Finally;
+
+    int jitter = 0;
+
+    /* If a jitter time is requested, try to build a triangular probability
+     * density function centred around the scheduled time. Determine the
+     * duration until the scheduled time, and the jitter window which
+     * comprises the period from the scheduled time to the next
+     * scheduled time.
+     */
+
+    if (aJitterPeriod) {
+
+        /* The jitter window is limited by the jitter period, so there
+         * is no need to search beyond twice the jitter period for the
+         * next scheduled time.
+         */
+
+        iterator->mHorizon = scheduled + 2 * aJitterPeriod;
+
+        time_t nextScheduled = nextScheduleOccurrence(iterator);
+        if (-1 == nextScheduled) {
+            if (ENOENT != errno)
+                goto Finally;
+            nextScheduled = iterator->mHorizon;
+        }
+
+        if (nextScheduled <= scheduled) {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        /* The lhs period might be zero if there is no time until
+         * the scheduled time. In this case, use a one-sided
+         * probably density function.
+         *
+         * The rhs period is limited to half the jitter window to
+         * leave time for the subsequent occurence to be equally
+         * early or late.
+         */
+
+        time_t rhsPeriod = (nextScheduled - scheduled) / 2;
+        time_t lhsPeriod = scheduled - queryCivilTimeUtc(aCivilTime);
+
+        time_t period =
+            lhsPeriod && lhsPeriod < rhsPeriod ? lhsPeriod : rhsPeriod;
+
+        if (period > aJitterPeriod)
+            period = aJitterPeriod;
+
+        int rand = random();
+
+        jitter = period * (1 - sqrt(rand / ((1UL<<31) - 1.0)));
+
+        if ((rand % 2) && lhsPeriod)
+            jitter = 0 - jitter;
+
+        scheduled += jitter;
+    }
+
+    if (aJitter)
+        *aJitter = jitter;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : scheduled;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+querySchedulePrecedence_(
+    const struct Schedule *self, enum ScheduleKind aScheduleKind, int aValue)
+{
+    int rc = -1;
+
+    const struct BitRing *bitring = &self->mSchedules[aScheduleKind];
+
+    /* Find the distance to the candidate preceding the specified value.
+     * The candidate lies before the start of the field if the field
+     * must borrow, so return the distance rather than the candidate
+     * which might be negative.
+     */
+
+    int delta = queryBitRingMemberPrecedence(bitring, aValue);
+    if (-1 == delta)
+        goto Finally;
+
+    if (!delta)
+        delta = 1;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : delta;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+querySchedulePrevYear_(const struct Schedule *self, int aYear)
+{
+    int rc = -1;
+
+    const struct BitRing *years = &self->mYears;
+
+    /* The years do not wrap around, so there is no candidate preceding
+     * the first selected year.
+     */
+
+    int prevYear = aYear - 1;
+
+    if (queryBitRingPopulation(years)) {
+
+        if (prevYear > queryBitRingMax(years))
+            prevYear = queryBitRingMax(years);
+
+        while (!queryBitRingMembership(years, prevYear)) {
+            if (prevYear <= queryBitRingMin(years)) {
+                errno = ENOENT;
+                goto Finally;
+            }
+            --prevYear;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : prevYear;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+querySchedulePrevDay_(const struct Schedule *self, struct Calendar aCalendar)
+{
+    int rc = -1;
+
+    int skipWeekDays = queryBitRingMemberPrecedence(
+        &self->mSchedules[ScheduleWeekDays], aCalendar.mWeekDay);
+    if (-1 == skipWeekDays)
+        goto Finally;
+
+    int skipDays = queryBitRingMemberPrecedence(
+        &self->mSchedules[ScheduleDays], aCalendar.mDay);
+    if (-1 == skipDays)
+        goto Finally;
+
+    /* The month days do not leave the month, so if none precede the
+     * day, retreat to the end of the preceding month.
+     */
+
+    int skipMonthDays = 0;
+
+    if (queryScheduleMonthDaysPopulation(&self->mMonthDays)) {
+        uint32_t monthDays =
+            queryScheduleMonthDays_(self, aCalendar) &
+            (((uint32_t) 1 << (aCalendar.mDay - 1)) - 1);
+
+        skipMonthDays =
+            monthDays
+                ? aCalendar.mDay - (32 - __builtin_clz(monthDays))
+                : aCalendar.mDay;
+    }
+
+    int deltaDays =
+        queryScheduleDaySkip_(skipWeekDays, skipDays, skipMonthDays);
+
+    /* The days of the month are measured around a ring of 31 days, and
+     * the preceding month might be shorter. Rather than overshoot the
+     * candidate, stop at the last day of the preceding month.
+     */
+
+    int prevDay = aCalendar.mDay - deltaDays;
+
+    if (prevDay < 1)
+        prevDay = 0;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : prevDay;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+searchSchedulePrevious_(const struct Schedule *self, struct tm *aWallTm)
+{
+    int rc = -1;
+
+    /* The search mirrors the odometer of searchSchedule_(), but retreats
+     * each field to its preceding candidate, and moves the finer fields
+     * to their last values. The search is conducted on the wall clock
+     * without regard to daylight savings changes, and timegm() is used
+     * to normalise the wall clock so that retreating past the start of
+     * a field borrows from the next coarser field.
+     */
+
+    while (1) {
+
+        errno = 0;
+        if (-1 == timegm(aWallTm) && errno)
+            goto Finally;
+
+        struct Calendar calendar = {
+            .mYear = aWallTm->tm_year + 1900,
+            .mMonth = aWallTm->tm_mon + 1,
+            .mDay = aWallTm->tm_mday,
+            .mWeekDay = aWallTm->tm_wday,
+        };
+
+        int delta;
+
+        if (!matchScheduleYear_(self, calendar.mYear)) {
+            int prevYear = querySchedulePrevYear_(self, calendar.mYear);
+            if (-1 == prevYear)
+                goto Finally;
+
+            /* Retreat to the last minute of the preceding candidate year. */
+
+            aWallTm->tm_year = prevYear - 1900;
+            aWallTm->tm_mon = 11;
+            aWallTm->tm_mday = 31;
+            aWallTm->tm_hour = 23;
+            aWallTm->tm_min = 59;
+
+        } else if (!matchScheduleField_(
+                        self, ScheduleMonths, calendar.mMonth)) {
+            delta = querySchedulePrecedence_(
+                self, ScheduleMonths, calendar.mMonth);
+            if (-1 == delta)
+                goto Finally;
+
+            /* Retreat to the last day of the preceding candidate month. */
+
+            aWallTm->tm_mon -= delta - 1;
+            aWallTm->tm_mday = 0;
+            aWallTm->tm_hour = 23;
+            aWallTm->tm_min = 59;
+
+        } else if (!matchScheduleDay_(self, calendar)) {
+            int prevDay = querySchedulePrevDay_(self, calendar);
+            if (-1 == prevDay)
+                goto Finally;
+
+            aWallTm->tm_mday = prevDay;
+            aWallTm->tm_hour = 23;
+            aWallTm->tm_min = 59;
+
+        } else if (!matchScheduleField_(
+                        self, ScheduleHours, aWallTm->tm_hour)) {
+            delta = querySchedulePrecedence_(
+                self, ScheduleHours, aWallTm->tm_hour);
+            if (-1 == delta)
+                goto Finally;
+
+            aWallTm->tm_hour -= delta;
+            aWallTm->tm_min = 59;
+
+        } else if (!matchScheduleField_(
+                        self, ScheduleMinutes, aWallTm->tm_min)) {
+            delta = querySchedulePrecedence_(
+                self, ScheduleMinutes, aWallTm->tm_min);
+            if (-1 == delta)
+                goto Finally;
+
+            aWallTm->tm_min -= delta;
+
+        } else {
+            break;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+matchScheduleOccurrence_(const struct Schedule *self, time_t aTime)
+{
+    int rc = -1;
+
+    /* Rather than duplicate the daylight savings rules, rely on the
+     * forward search to apply them. The time is an occurrence if the
+     * search finds it immediately.
+     */
+
+    struct CivilTime civilTime;
+
+    if (!initCivilTime(&civilTime, aTime))
+        goto Finally;
+
+    time_t scheduled = querySchedule(self, &civilTime, 1, 0, 0);
+    if (-1 == scheduled && ENOENT != errno)
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : scheduled == aTime;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+nearScheduleTransition_(time_t aTime, time_t aMargin)
+{
+    int rc = -1;
+
+    struct tm beforeTm, afterTm;
+
+    time_t before = aTime - aMargin;
+    time_t after = aTime + aMargin;
+
+    tzset();
+
+    if (!localtime_r(&before, &beforeTm) || !localtime_r(&after, &afterTm))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : beforeTm.tm_gmtoff != afterTm.tm_gmtoff;
+}
+
+/* -------------------------------------------------------------------------- */
+static time_t
+querySchedulePreviousMinute_(
+    const struct Schedule *self, time_t aTime, time_t aLimit)
+{
+    int rc = -1;
+
+    time_t previous = -1;
+
+    /* Daylight savings changes are no larger than a couple of hours, and
+     * only disturb the order of occurrences within this margin.
+     */
+
+    static const time_t Margin = 3 * 60 * 60;
+
+    time_t time = aTime;
+    time_t limit = aLimit;
+
+    struct tm wallTm;
+
+    tzset();
+
+    if (!localtime_r(&time, &wallTm))
+        goto Finally;
+
+    wallTm.tm_sec = 0;
+
+    /* Wall clock candidates are visited from the present wall clock
+     * backwards. Outside a daylight savings change, the candidates are
+     * visited in order, and the first occurrence found is the most
+     * recent. Near a daylight savings change, an occurrence can have a
+     * wall clock later than the present wall clock, so start later, and
+     * continue past the first occurrence found.
+     */
+
+    int transition = nearScheduleTransition_(time, Margin);
+    if (-1 == transition)
+        goto Finally;
+
+    if (transition)
+        wallTm.tm_hour += Margin / (60 * 60);
+
+    while (1) {
+
+        /* The selected years might be exhausted while continuing past
+         * an occurrence that has already been found.
+         */
+
+        if (searchSchedulePrevious_(self, &wallTm)) {
+            if (ENOENT != errno || -1 == previous)
+                goto Finally;
+            break;
+        }
+
+        /* Away from a daylight savings change, the wall clock has only
+         * one conversion to UTC, and it is an occurrence because the
+         * search has matched the wall clock. Only near a change are both
+         * conversions tried, and each confirmed by the forward search.
+         */
+
+        struct tm localTm = wallTm;
+
+        localTm.tm_isdst = -1;
+
+        time_t latest = mktime(&localTm);
+        if (-1 == latest)
+            goto Finally;
+
+        int near = nearScheduleTransition_(latest, Margin);
+        if (-1 == near)
+            goto Finally;
+
+        if (!near) {
+
+            if (latest <= time && latest > previous) {
+                if (-1 == previous)
+                    transition = 0;
+
+                previous = latest;
+            }
+
+        } else {
+
+            latest = -1;
+
+            for (int dst = 0; dst < 2; ++dst) {
+
+                struct tm candidateTm = wallTm;
+
+                candidateTm.tm_isdst = dst;
+
+                time_t candidate = mktime(&candidateTm);
+                if (-1 == candidate)
+                    goto Finally;
+
+                if (candidate > latest)
+                    latest = candidate;
+
+                if (candidate <= time && candidate > previous) {
+                    int match = matchScheduleOccurrence_(self, candidate);
+                    if (-1 == match)
+                        goto Finally;
+
+                    if (match) {
+                        if (-1 == previous) {
+                            transition = nearScheduleTransition_(
+                                candidate, Margin);
+                            if (-1 == transition)
+                                goto Finally;
+                        }
+
+                        previous = candidate;
+                    }
+                }
+            }
+        }
+
+        if (-1 != limit && latest < limit)
+            break;
+
+        if (-1 != previous && (!transition || latest < previous - Margin))
+            break;
+
+        --wallTm.tm_min;
+    }
+
+    if (-1 == previous || (-1 != limit && previous < limit)) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : previous;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+queryScheduleLastSecond_(const struct Schedule *self, int aSecond)
+{
+    int rc = -1;
+
+    /* Find the last selected second that is not later than the specified
+     * second, noting that a schedule without seconds selects the start
+     * of each minute.
+     */
+
+    int second = 0;
+
+    if (queryBitRingPopulation(&self->mSeconds)) {
+
+        int delta = 0;
+
+        if (!queryBitRingMembership(&self->mSeconds, aSecond)) {
+            delta = queryBitRingMemberPrecedence(&self->mSeconds, aSecond);
+            if (-1 == delta)
+                goto Finally;
+        }
+
+        if (delta > aSecond) {
+            errno = ENOENT;
+            goto Finally;
+        }
+
+        second = aSecond - delta;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : second;
+}
+
+/* -------------------------------------------------------------------------- */
+time_t
+querySchedulePrevious(
+    const struct Schedule *self,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon)
+{
+    int rc = -1;
+
+    time_t previous = -1;
+
+    if (0 > aHorizon) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    time_t time = queryCivilTimeUtc(aCivilTime);
+    time_t limit = aHorizon && aHorizon < time ? time - aHorizon : -1;
+
+    /* Search back from the close of the validity window, and no further
+     * than its opening.
+     */
+
+    if (self->mEnd && time > self->mEnd)
+        time = self->mEnd;
+
+    if (self->mBegin && limit < self->mBegin)
+        limit = self->mBegin;
+
+    if (-1 != limit && time < limit) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    /* Find the most recent minute selected by the schedule, and then the
+     * most recent second selected within that minute. If no such second
+     * has yet occurred in the present minute, find the preceding minute.
+     * The window is applied to the result, rather than to the minutes,
+     * because a minute that opens before the window can still have
+     * seconds that lie within it.
+     */
+
+    struct Schedule minutes = *self;
+
+    minutes.mSeconds.mRing = 0;
+    minutes.mBegin = 0;
+    minutes.mEnd = 0;
+
+    int second = time % 60;
+
+    time_t minute = time - second;
+    time_t minuteLimit = -1 == limit ? -1 : limit - limit % 60;
+
+    previous = querySchedulePreviousMinute_(&minutes, minute, minuteLimit);
+    if (-1 == previous)
+        goto Finally;
+
+    int lastSecond = queryScheduleLastSecond_(
+        self, previous == minute ? second : 59);
+
+    if (-1 == lastSecond) {
+        if (ENOENT != errno)
+            goto Finally;
+
+        previous = querySchedulePreviousMinute_(
+            &minutes, minute - 60, minuteLimit);
+        if (-1 == previous)
+            goto Finally;
+
+        lastSecond = queryScheduleLastSecond_(self, 59);
+        if (-1 == lastSecond)
+            goto Finally;
+    }
+
+    previous += lastSecond;
+
+    if (-1 != limit && previous < limit) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : previous;
+}
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleRings
+{
+    BitRingT mRings[ScheduleKinds];
+    BitRingT mSeconds;
+
+    /* The month days, the years, the validity window and the excluded
+     * dates also select the days.
+     */
+
+    uint64_t mMonthDays[2];
+    BitRingT mYears;
+    int mFirstYear;
+    time_t mBegin;
+    time_t mEnd;
+    const struct ScheduleExclusion *mExclusion;
+
+    size_t mSchedule;
+};
+
+static const enum ScheduleKind ScheduleRingOrder_[ScheduleKinds] = {
+    ScheduleDays,
+    ScheduleMonths,
+    ScheduleWeekDays,
+    ScheduleHours,
+    ScheduleMinutes,
+};
+
+enum {
+    ScheduleDayRings_ = 3, /* Leading rings that select days */
+};
+
+static int
+compareScheduleRings_(const void *aLhs, const void *aRhs)
+{
+    const struct ScheduleRings *lhs = aLhs;
+    const struct ScheduleRings *rhs = aRhs;
+
+    /* Order the schedules so that those selecting the same days are
+     * adjacent, and within those, identical schedules are adjacent.
+     */
+
+    for (unsigned ix = 0; ix < NUMBEROF(lhs->mMonthDays); ++ix) {
+        if (lhs->mMonthDays[ix] != rhs->mMonthDays[ix])
+            return lhs->mMonthDays[ix] < rhs->mMonthDays[ix] ? -1 : +1;
+    }
+
+    if (lhs->mYears != rhs->mYears)
+        return lhs->mYears < rhs->mYears ? -1 : +1;
+
+    if (lhs->mFirstYear != rhs->mFirstYear)
+        return lhs->mFirstYear < rhs->mFirstYear ? -1 : +1;
+
+    if (lhs->mBegin != rhs->mBegin)
+        return lhs->mBegin < rhs->mBegin ? -1 : +1;
+
+    if (lhs->mEnd != rhs->mEnd)
+        return lhs->mEnd < rhs->mEnd ? -1 : +1;
+
+    if (lhs->mExclusion != rhs->mExclusion)
+        return
+            (uintptr_t) lhs->mExclusion < (uintptr_t) rhs->mExclusion
+                ? -1 : +1;
+
+    for (unsigned ix = 0; ix < NUMBEROF(ScheduleRingOrder_); ++ix) {
+        enum ScheduleKind kind = ScheduleRingOrder_[ix];
+
+        if (lhs->mRings[kind] != rhs->mRings[kind])
+            return lhs->mRings[kind] < rhs->mRings[kind] ? -1 : +1;
+    }
+
+    if (lhs->mSeconds != rhs->mSeconds)
+        return lhs->mSeconds < rhs->mSeconds ? -1 : +1;
+
+    return
+        lhs->mSchedule != rhs->mSchedule
+            ? (lhs->mSchedule < rhs->mSchedule ? -1 : +1)
+            : 0;
+}
+
+static int
+matchScheduleRings_(
+    const struct ScheduleRings *aLhs,
+    const struct ScheduleRings *aRhs,
+    unsigned aKinds)
+{
+    if (aLhs->mMonthDays[0] != aRhs->mMonthDays[0] ||
+            aLhs->mMonthDays[1] != aRhs->mMonthDays[1] ||
+            aLhs->mYears != aRhs->mYears ||
+            aLhs->mFirstYear != aRhs->mFirstYear ||
+            aLhs->mBegin != aRhs->mBegin ||
+            aLhs->mEnd != aRhs->mEnd ||
+            aLhs->mExclusion != aRhs->mExclusion)
+        return 0;
+
+    for (unsigned ix = 0; ix < aKinds; ++ix) {
+        enum ScheduleKind kind = ScheduleRingOrder_[ix];
+
+        if (aLhs->mRings[kind] != aRhs->mRings[kind])
+            return 0;
+    }
+
+    /* Only identical schedules also match in their seconds. */
+
+    if (ScheduleKinds == aKinds && aLhs->mSeconds != aRhs->mSeconds)
+        return 0;
+
+    return 1;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+querySchedules(
+    const struct Schedule *self,
+    size_t aLength,
+    const struct CivilTime *aCivilTime,
+    time_t *aScheduled)
+{
+    int rc = -1;
+
+    struct ScheduleRings *scheduleRings = 0;
+
+    if (!aLength) {
+        rc = 0;
+        goto Finally;
+    }
+
+    scheduleRings = malloc(aLength * sizeof(*scheduleRings));
+    if (!scheduleRings)
+        goto Finally;
+
+    for (size_t sx = 0; sx < aLength; ++sx) {
+        for (unsigned kx = 0; kx < ScheduleKinds; ++kx)
+            scheduleRings[sx].mRings[kx] = self[sx].mSchedules[kx].mRing;
+        scheduleRings[sx].mSeconds = self[sx].mSeconds.mRing;
+        packScheduleMonthDays_(
+            &self[sx].mMonthDays, scheduleRings[sx].mMonthDays);
+        scheduleRings[sx].mYears = self[sx].mYears.mRing;
+        scheduleRings[sx].mFirstYear =
+            queryBitRingPopulation(&self[sx].mYears)
+                ? queryBitRingMin(&self[sx].mYears)
+                : 0;
+        scheduleRings[sx].mBegin = self[sx].mBegin;
+        scheduleRings[sx].mEnd = self[sx].mEnd;
+        scheduleRings[sx].mExclusion = self[sx].mExclusion;
+        scheduleRings[sx].mSchedule = sx;
+    }
+
+    qsort(
+        scheduleRings, aLength, sizeof(*scheduleRings), compareScheduleRings_);
+
+    /* Group the schedules that select the same days. Each schedule can
+     * only be scheduled on a day selected by its group, so find the first
+     * such time once for the group. Searching from that time finds the
+     * same scheduled time as searching from the original time, because
+     * the schedule is not scheduled in between. Identical schedules
+     * within the group share the result of a single search.
+     */
+
+    struct CivilTime daysCivilTime;
+
+    time_t daysSince = -1;
+
+    for (size_t gx = 0, ex; gx < aLength; gx = ex) {
+
+        for (ex = gx + 1; ex < aLength; ++ex) {
+            if (!matchScheduleRings_(
+                    &scheduleRings[gx], &scheduleRings[ex], ScheduleDayRings_))
+                break;
+        }
+
+        struct Schedule days = self[scheduleRings[gx].mSchedule];
+
+        days.mSchedules[ScheduleMinutes].mRing = 0;
+        days.mSchedules[ScheduleHours].mRing = 0;
+
+        /* Select every second so that a search that starts part way
+         * through a minute of a selected day remains there.
+         */
+
+        if (!initBitRing(&days.mSeconds, 0, 59, "0-59"))
+            goto Finally;
+
+        classifySchedule_(&days);
+
+        const struct CivilTime *civilTime = aCivilTime;
+
+        /* A group whose validity window has closed, or whose years are
+         * exhausted, has no further occurrences, and is reported as -1.
+         */
+
+        time_t since = querySchedule(&days, aCivilTime, 0, 0, 0);
+        if (-1 == since && ENOENT != errno)
+            goto Finally;
+
+        /* Groups that are first selected on the same later day share a
+         * civil time, and all the civil times reuse the daylight savings
+         * rules found for the original time where possible.
+         */
+
+        if (-1 != since && since != queryCivilTimeUtc(aCivilTime)) {
+            if (since != daysSince) {
+                if (!initScheduleCivilTime_(&daysCivilTime, since, aCivilTime))
+                    goto Finally;
+                daysSince = since;
+            }
+            civilTime = &daysCivilTime;
+        }
+
+        time_t scheduled = -1;
+
+        for (size_t sx = gx; sx < ex; ++sx) {
+            size_t schedule = scheduleRings[sx].mSchedule;
+
+            if (sx == gx || !matchScheduleRings_(
+                    &scheduleRings[sx - 1],
+                    &scheduleRings[sx], ScheduleKinds)) {
+
+                scheduled = -1 == since ? -1 : querySchedule(
+                    &self[schedule], civilTime, 0, 0, 0);
+                if (-1 == scheduled && ENOENT != errno)
+                    goto Finally;
+            }
+
+            aScheduled[schedule] = scheduled;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    free(scheduleRings);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+matchScheduleAlways_(const struct Schedule *self)
+{
+    /* A schedule of wildcards, without any other constraint, matches
+     * every minute, even those masked by a daylight savings change.
+     */
+
+    for (unsigned kx = 0; kx < ScheduleKinds; ++kx) {
+        if (queryBitRingPopulation(&self->mSchedules[kx]))
+            return 0;
+    }
+
+    return
+        !queryBitRingPopulation(&self->mYears) &&
+        !self->mBegin &&
+        !self->mEnd &&
+        !self->mExclusion &&
+        !queryScheduleMonthDaysPopulation(&self->mMonthDays);
+}
+
+static int
+queryScheduleRingGap_(const struct BitRing *aRing, int aMember)
+{
+    /* The next value that is not a member of the ring is the next member
+     * of its complement. A wildcard, or a ring that holds every value,
+     * has no such member, and yields zero.
+     */
+
+    int span = aRing->mMax - aRing->mMin + 1;
+
+    struct BitRing complement = {
+        .mRing = ~aRing->mRing & (
+            span < 64 ? ((BitRingT) 1 << span) - 1 : ~(BitRingT) 0),
+        .mMin = aRing->mMin,
+        .mMax = aRing->mMax,
+    };
+
+    return
+        queryBitRingPopulation(aRing)
+            ? queryBitRingMemberSeparation(&complement, aMember)
+            : 0;
+}
+
+static time_t
+queryScheduleDayGap_(
+    const struct Schedule *self, struct Calendar aCalendar, time_t aLimit)
+{
+    const struct BitRing *weekDays = &self->mSchedules[ScheduleWeekDays];
+    const struct BitRing *days = &self->mSchedules[ScheduleDays];
+
+    /* The days of the week, the days of the month, the month days, and
+     * the exclusions combine to select each day, so visit the days in
+     * turn, up to the limit, to find the next day that is not selected.
+     */
+
+    if (!queryBitRingPopulation(weekDays) &&
+        !queryBitRingPopulation(days) &&
+        !queryScheduleMonthDaysPopulation(&self->mMonthDays) &&
+        !self->mExclusion)
+        return 0;
+
+    struct Calendar calendar = aCalendar;
+
+    for (time_t separation = 1; separation <= aLimit; ++separation) {
+
+        calendar.mWeekDay = (calendar.mWeekDay + 1) % DaysInWeek;
+
+        if (++calendar.mDay > queryScheduleMonthLength_(
+                calendar.mYear, calendar.mMonth)) {
+            calendar.mDay = 1;
+            if (++calendar.mMonth > 12) {
+                calendar.mMonth = 1;
+                ++calendar.mYear;
+            }
+        }
+
+        if (!matchScheduleDay_(self, calendar))
+            return separation;
+    }
+
+    return 0;
+}
+
+static time_t
+queryScheduleMonthGap_(struct Calendar aCalendar, int aYear, int aMonth)
+{
+    /* Count the days from the calendar date to the first day of the
+     * month, without regard to daylight savings changes.
+     */
+
+    struct tm sinceTm = {
+        .tm_year = aCalendar.mYear - 1900,
+        .tm_mon = aCalendar.mMonth - 1,
+        .tm_mday = aCalendar.mDay,
+    };
+
+    struct tm untilTm = {
+        .tm_year = aYear - 1900,
+        .tm_mon = aMonth - 1,
+        .tm_mday = 1,
+    };
+
+    return (timegm(&untilTm) - timegm(&sinceTm)) / (24 * 60 * 60);
+}
+
+static time_t
+queryScheduleGapCandidate_(
+    const struct Schedule *self, const struct CivilTime *aCivilTime)
+{
+    time_t time = queryCivilTimeUtc(aCivilTime);
+    time_t transition = queryCivilTimeTransition(aCivilTime);
+
+    /* Within a transition period, local time is masked or artificial,
+     * and the period lasts no more than a couple of hours, so advance
+     * a minute at a time.
+     */
+
+    if (time >= transition)
+        return time + 60;
+
+    /* Local time advances in step with UTC until the next daylight
+     * savings change, so the minutes until each field first fails to
+     * match can be computed from the wall clock. The earliest of these
+     * is the candidate, but the daylight savings change can mask the
+     * fields, and so is also a candidate.
+     */
+
+    struct Calendar calendar = queryCivilTimeWallCalendar(aCivilTime);
+    struct Clock clock = queryCivilTimeWallClock(aCivilTime);
+
+    int minutes = clock.mHour * 60 + clock.mMinute;
+
+    time_t until = transition - transition % 60 + (transition % 60 ? 60 : 0);
+
+    if (self->mEnd && until > self->mEnd)
+        until = self->mEnd - self->mEnd % 60 + 60;
+
+    time_t gap = (until - time) / 60;
+
+    int separation = queryScheduleRingGap_(
+        &self->mSchedules[ScheduleMinutes], clock.mMinute);
+
+    if (separation && separation < gap)
+        gap = separation;
+
+    separation = queryScheduleRingGap_(
+        &self->mSchedules[ScheduleHours], clock.mHour);
+
+    if (separation && separation * 60 - clock.mMinute < gap)
+        gap = separation * 60 - clock.mMinute;
+
+    /* Scan the days no further than the present candidate, and no more
+     * than four centuries, after which the days of the week and the
+     * calendar repeat.
+     */
+
+    static const time_t DayLimit = 400 * 365 + 97;
+
+    time_t days = queryScheduleDayGap_(
+        self,
+        calendar,
+        gap / (24 * 60) < DayLimit ? gap / (24 * 60) + 1 : DayLimit);
+
+    if (days && days * 24 * 60 - minutes < gap)
+        gap = days * 24 * 60 - minutes;
+
+    separation = queryScheduleRingGap_(
+        &self->mSchedules[ScheduleMonths], calendar.mMonth);
+
+    if (separation) {
+        int month = calendar.mMonth - 1 + separation;
+
+        days = queryScheduleMonthGap_(
+            calendar, calendar.mYear + month / 12, month % 12 + 1);
+
+        if (days * 24 * 60 - minutes < gap)
+            gap = days * 24 * 60 - minutes;
+    }
+
+    if (queryBitRingPopulation(&self->mYears)) {
+        int year = calendar.mYear + 1;
+
+        while (matchScheduleYear_(self, year))
+            ++year;
+
+        days = queryScheduleMonthGap_(calendar, year, 1);
+
+        if (days * 24 * 60 - minutes < gap)
+            gap = days * 24 * 60 - minutes;
+    }
+
+    return time + 60 * gap;
+}
+
+/* -------------------------------------------------------------------------- */
+time_t
+queryScheduleGap(
+    const struct Schedule *self,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon)
+{
+    int rc = -1;
+
+    time_t gap = -1;
+
+    time_t time = queryCivilTimeUtc(aCivilTime);
+
+    if (0 > aHorizon || time % 60 || queryBitRingPopulation(&self->mSeconds)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    time_t limit = aHorizon ? time + aHorizon : -1;
+
+    if (matchScheduleAlways_(self)) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    /* Rather than match each minute in turn, jump to the first minute at
+     * which some field of the schedule fails to match, and confirm that
+     * the schedule does not match there. A candidate that still matches,
+     * such as at a daylight savings change, is searched from again.
+     */
+
+    struct CivilTime civilTime = *aCivilTime;
+
+    while (matchSchedule(self, &civilTime)) {
+
+        time = queryScheduleGapCandidate_(self, &civilTime);
+
+        if (-1 != limit && time > limit) {
+            errno = ENOENT;
+            goto Finally;
+        }
+
+        if (!initCivilTime(&civilTime, time))
+            goto Finally;
+    }
+
+    gap = time;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : gap;
+}
+
+/* -------------------------------------------------------------------------- */
+time_t
+queryScheduleCollision(
+    const struct Schedule *self,
+    const struct Schedule *aOther,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon)
+{
+    int rc = -1;
+
+    struct ScheduleIterator iterator_, *iterator = &iterator_;
+
+    if (!initScheduleIterator(iterator, self, aCivilTime))
+        goto Finally;
+
+    if (!limitScheduleIterator(iterator, aHorizon, 0))
+        goto Finally;
+
+    time_t horizon = iterator->mHorizon;
+
+    /* Leapfrog the schedules, searching each from the most recent
+     * occurrence of the other, until both schedules find the same
+     * occurrence. Each search observes the daylight savings rules,
+     * so a schedule masked by a repeated hour cannot collide there.
+     */
+
+    const struct Schedule *schedules[] = { self, aOther };
+
+    struct CivilTime civilTime = *aCivilTime;
+
+    time_t since = queryCivilTimeUtc(aCivilTime);
+
+    for (unsigned sx = 0, matches = 0; matches < NUMBEROF(schedules); ) {
+
+        initScheduleIterator(iterator, schedules[sx], &civilTime);
+        iterator->mHorizon = horizon;
+
+        time_t scheduled = nextScheduleOccurrence(iterator);
+        if (-1 == scheduled)
+            goto Finally;
+
+        if (scheduled == since) {
+            ++matches;
+        } else {
+            if (!initScheduleCivilTime_(&civilTime, scheduled, 0))
+                goto Finally;
+            since = scheduled;
+            matches = 1;
+        }
+
+        sx = (sx + 1) % NUMBEROF(schedules);
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : since;
+}
 
 /* -------------------------------------------------------------------------- */
+int
+matchSchedule(const struct Schedule *self, const struct CivilTime *aCivilTime)
+{
+    /* The civil time masks the fields that were repeated by a daylight
+     * savings change, so that only wildcards match them, and the
+     * schedule matches exactly when a search would stop here. In the
+     * period skipped by a daylight savings change, the search tries the
+     * artificial time before the local time that actually applies, so
+     * the schedule matches if either matches.
+     */
+
+    struct Calendar calendar;
+    struct Clock clock;
+
+    return
+        matchScheduleWindow_(self, queryCivilTimeUtc(aCivilTime)) &&
+        (matchScheduleTime_(
+            self,
+            queryCivilTimeCalendar(aCivilTime),
+            queryCivilTimeClock(aCivilTime)) ||
+         (1 == queryCivilTimeArtificial(aCivilTime, &calendar, &clock) &&
+          matchScheduleTime_(self, calendar, clock)));
+}
+
+/* -------------------------------------------------------------------------- */
+int
+matchScheduleTimes(
+    const struct Schedule *self,
+    const time_t *aTimes,
+    size_t aLength,
+    int *aMatches)
+{
+    int rc = -1;
+
+    struct CivilTime civilTime;
+
+    time_t since = -1;
+    time_t until = -1;
+
+    for (size_t tx = 0; tx < aLength; ++tx) {
+
+        time_t time = aTimes[tx];
+
+        /* Outside transition periods, local time advances in step with
+         * UTC, so the clock can be computed directly for the remainder
+         * of the day. Otherwise, or across days, initialise a civil time
+         * so that any transition period is modelled.
+         */
+
+        if (time < since || time >= until) {
+
+            if (!initCivilTime(&civilTime, time))
+                goto Finally;
+
+            struct Clock wallClock = queryCivilTimeWallClock(&civilTime);
+
+            since = queryCivilTimeUtc(&civilTime);
+            until = queryCivilTimeTransition(&civilTime);
+
+            time_t midnight =
+                since +
+                60 * (24 * 60 - wallClock.mHour * 60 - wallClock.mMinute);
+
+            if (until > midnight)
+                until = midnight;
+
+            aMatches[tx] = matchSchedule(self, &civilTime);
+
+        } else {
+
+            if (time % 60) {
+                errno = EINVAL;
+                goto Finally;
+            }
+
+            struct Clock wallClock = queryCivilTimeWallClock(&civilTime);
+
+            int minutes =
+                wallClock.mHour * 60 + wallClock.mMinute + (time - since) / 60;
+
+            struct Clock clock = {
+                .mHour = minutes / 60,
+                .mMinute = minutes % 60,
+            };
+
+            aMatches[tx] =
+                matchScheduleWindow_(self, time) &&
+                matchScheduleTime_(
+                    self, queryCivilTimeCalendar(&civilTime), clock);
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
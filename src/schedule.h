@@ -30,13 +30,13 @@
 #define SCHEDULE_H
 
 #include "bitring.h"
+#include "civiltime.h"
+#include "scheduleexclusion.h"
 
 #include <time.h>
 
 #include "compiler.h"
 
-struct CivilTime;
-
 /* -------------------------------------------------------------------------- */
 BEGIN_C_SCOPE;
 
@@ -49,23 +49,193 @@ enum ScheduleKind {
     ScheduleKinds,
 };
 
+enum ScheduleShape {
+    ScheduleShapeGeneral,  /* Requires a search of the calendar */
+    ScheduleShapeMinutes,  /* eg * * * * *, M * * * * */
+    ScheduleShapeHours,    /* eg M H * * * */
+    ScheduleShapeWeekDays, /* eg M H * * D */
+};
+
+/* Days that depend on the length of the month, or on the days of the
+ * week within the month, cannot be held in the rings. Instead, these are
+ * used to compute the days that they select in each month.
+ */
+
+struct ScheduleMonthDays
+{
+    uint32_t mNearestWeekDays;        /* nW, with bit 0 for the 1st */
+    uint8_t mLastDay;                 /* L */
+    uint8_t mLastWeekDay;             /* LW */
+    uint8_t mLastWeekDays;            /* dL, with bit 0 for Sunday */
+    uint8_t mNthWeekDays[DaysInWeek]; /* d#n, with bit 0 for the 1st */
+};
+
 struct Schedule
 {
     struct BitRing mSchedules[ScheduleKinds];
+
+    /* Seconds are only scheduled by an optional leading field, and an
+     * empty ring schedules the start of each minute.
+     */
+
+    struct BitRing mSeconds;
+
+    enum ScheduleShape mShape;
+
+    /* Years are only scheduled by an optional trailing field, and an
+     * empty ring schedules every year. The validity window confines
+     * occurrences to lie between its bounds.
+     */
+
+    struct BitRing mYears;
+
+    time_t mBegin; /* Earliest occurrence, or 0 */
+    time_t mEnd;   /* Latest occurrence, or 0 */
+
+    /* Dates in the exclusion calendar are never scheduled. The calendar
+     * is not owned by the schedule, and must outlive it.
+     */
+
+    const struct ScheduleExclusion *mExclusion;
+
+    /* Days selected by L, LW and nW in the days of the month, or
+     * by dL and d#n in the days of the week.
+     */
+
+    struct ScheduleMonthDays mMonthDays;
 };
 
+struct ScheduleJob
+{
+    const char *mName;
+    const struct Schedule *mSchedule;
+};
+
+struct ScheduleFingerprint
+{
+    uint64_t mWords[2];
+};
+
+struct ScheduleIterator
+{
+    const struct Schedule *mSchedule;
+
+    struct CivilTime mCivilTime;
+
+    time_t mScheduled;  /* Previous occurrence, or -1 */
+    int mPositioned;    /* Civil time is positioned at mScheduled */
+
+    time_t mHorizon;          /* Latest occurrence, or -1 */
+    unsigned long mStepLimit; /* Steps allowed per occurrence, or 0 */
+
+    unsigned long mSteps; /* Steps taken by the search */
+};
+
+/* -------------------------------------------------------------------------- */
+static __inline__ int
+queryScheduleMonthDaysPopulation(const struct ScheduleMonthDays *self)
+{
+    int population =
+        !!self->mNearestWeekDays ||
+        self->mLastDay ||
+        self->mLastWeekDay ||
+        self->mLastWeekDays;
+
+    for (unsigned wx = 0; wx < DaysInWeek; ++wx)
+        population = population || self->mNthWeekDays[wx];
+
+    return population;
+}
+
 /* -------------------------------------------------------------------------- */
 struct Schedule *
 initSchedule(struct Schedule *self, const char *aSchedule);
 
+struct Schedule *
+initScheduleKey(struct Schedule *self, const char *aSchedule, const char *aKey);
+
+struct Schedule *
+boundSchedule(struct Schedule *self, time_t aBegin, time_t aEnd);
+
+struct Schedule *
+excludeSchedule(
+    struct Schedule *self, const struct ScheduleExclusion *aExclusion);
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleFingerprint *
+queryScheduleFingerprint(
+    const struct Schedule *self, struct ScheduleFingerprint *aFingerprint);
+
+int
+compareScheduleFingerprints(
+    const struct ScheduleFingerprint *aLhs,
+    const struct ScheduleFingerprint *aRhs);
+
 /* -------------------------------------------------------------------------- */
 time_t
 querySchedule(
     const struct Schedule *self,
     const struct CivilTime *aCivilTime,
+    time_t aHorizon,
     time_t aJitterPeriod,
     int *aJitter);
 
+time_t
+querySchedulePrevious(
+    const struct Schedule *self,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon);
+
+int
+querySchedules(
+    const struct Schedule *self,
+    size_t aLength,
+    const struct CivilTime *aCivilTime,
+    time_t *aScheduled);
+
+time_t
+queryScheduleGap(
+    const struct Schedule *self,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon);
+
+time_t
+queryScheduleCollision(
+    const struct Schedule *self,
+    const struct Schedule *aOther,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon);
+
+/* -------------------------------------------------------------------------- */
+int
+matchSchedule(const struct Schedule *self, const struct CivilTime *aCivilTime);
+
+int
+matchScheduleTimes(
+    const struct Schedule *self,
+    const time_t *aTimes,
+    size_t aLength,
+    int *aMatches);
+
+/* -------------------------------------------------------------------------- */
+const struct Schedule *
+queryScheduleJob(
+    const struct ScheduleJob *aJobs, size_t aLength, const char *aName);
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleIterator *
+initScheduleIterator(
+    struct ScheduleIterator *self,
+    const struct Schedule *aSchedule,
+    const struct CivilTime *aCivilTime);
+
+struct ScheduleIterator *
+limitScheduleIterator(
+    struct ScheduleIterator *self, time_t aHorizon, unsigned long aStepLimit);
+
+time_t
+nextScheduleOccurrence(struct ScheduleIterator *self);
+
 /* -------------------------------------------------------------------------- */
 END_C_SCOPE;
 
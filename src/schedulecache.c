@@ -0,0 +1,323 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "schedulecache.h"
+
+#include "fnvhash.h"
+#include "macros.h"
+
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- */
+static const char ScheduleCacheMagic[8] = "CRONTIME";
+
+/* -------------------------------------------------------------------------- */
+uint64_t
+queryScheduleExpressionHash(const char *aExpression)
+{
+    return queryFnvHash(FNV_OFFSET_BASIS, aExpression, strlen(aExpression));
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+writeScheduleCacheFile_(int aFd, const void *aBuf, size_t aLength)
+{
+    int rc = -1;
+
+    const char *buf = aBuf;
+
+    while (aLength) {
+        ssize_t wrote = write(aFd, buf, aLength);
+        if (-1 == wrote) {
+            if (EINTR == errno)
+                continue;
+            goto Finally;
+        }
+
+        buf += wrote;
+        aLength -= wrote;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+writeScheduleCache(
+    const char *aPath, const char * const *aExpressions, size_t aLength)
+{
+    int rc = -1;
+
+    struct ScheduleCacheEntry *entries = 0;
+    char *tmpPath = 0;
+    int fd = -1;
+
+    entries = calloc(aLength ? aLength : 1, sizeof(*entries));
+    if (!entries)
+        goto Finally;
+
+    for (size_t ex = 0; ex < aLength; ++ex) {
+        struct Schedule schedule;
+        struct SchedulePack pack;
+
+        if (!initSchedule(&schedule, aExpressions[ex]))
+            goto Finally;
+
+        if (!initSchedulePack(&pack, &schedule))
+            goto Finally;
+
+        const uint32_t words[NUMBEROF(entries[ex].mPack)] = {
+            pack.mMinutes[0],
+            pack.mMinutes[1],
+            pack.mHours,
+            pack.mDays,
+            pack.mMonths,
+        };
+
+        entries[ex].mHash = htole64(
+            queryScheduleExpressionHash(aExpressions[ex]));
+
+        for (unsigned wx = 0; wx < NUMBEROF(words); ++wx)
+            entries[ex].mPack[wx] = htole32(words[wx]);
+    }
+
+    struct ScheduleCacheHeader header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.mMagic, ScheduleCacheMagic, sizeof(header.mMagic));
+
+    header.mVersion = htole32(ScheduleCacheVersion);
+    header.mEntrySize = htole32(sizeof(*entries));
+    header.mLength = htole64(aLength);
+    header.mChecksum = htole64(queryFnvHash(
+        FNV_OFFSET_BASIS, entries, aLength * sizeof(*entries)));
+
+    /* Write the cache to a temporary file, and rename it into place so
+     * that readers never map a partially written cache.
+     */
+
+    if (-1 == asprintf(&tmpPath, "%s.XXXXXX", aPath)) {
+        tmpPath = 0;
+        goto Finally;
+    }
+
+    fd = mkstemp(tmpPath);
+    if (-1 == fd)
+        goto Finally;
+
+    if (writeScheduleCacheFile_(fd, &header, sizeof(header)))
+        goto Finally;
+
+    if (writeScheduleCacheFile_(fd, entries, aLength * sizeof(*entries)))
+        goto Finally;
+
+    if (close(fd)) {
+        fd = -1;
+        goto Finally;
+    }
+    fd = -1;
+
+    if (rename(tmpPath, aPath))
+        goto Finally;
+
+    free(tmpPath);
+    tmpPath = 0;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (-1 != fd)
+            close(fd);
+
+        if (tmpPath)
+            unlink(tmpPath);
+
+        free(tmpPath);
+        free(entries);
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleCache *
+initScheduleCache(struct ScheduleCache *self, const char *aPath)
+{
+    int rc = -1;
+
+    int fd = -1;
+
+    self->mMap = MAP_FAILED;
+    self->mSize = 0;
+    self->mEntries = 0;
+    self->mLength = 0;
+
+    fd = open(aPath, O_RDONLY | O_CLOEXEC);
+    if (-1 == fd)
+        goto Finally;
+
+    struct stat st;
+    if (fstat(fd, &st))
+        goto Finally;
+
+    const struct ScheduleCacheHeader *header;
+
+    if (st.st_size < (off_t) sizeof(*header)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    self->mSize = st.st_size;
+    self->mMap = mmap(0, self->mSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == self->mMap)
+        goto Finally;
+
+    /* Verify the header, and that the size of the file matches the
+     * number of entries, before verifying the checksum of the entries.
+     */
+
+    header = self->mMap;
+
+    if (memcmp(header->mMagic, ScheduleCacheMagic, sizeof(header->mMagic)) ||
+            ScheduleCacheVersion != le32toh(header->mVersion) ||
+            sizeof(*self->mEntries) != le32toh(header->mEntrySize)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    uint64_t length = le64toh(header->mLength);
+
+    if ((self->mSize - sizeof(*header)) / sizeof(*self->mEntries) != length ||
+            (self->mSize - sizeof(*header)) % sizeof(*self->mEntries)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    self->mEntries = (const void *) (header + 1);
+    self->mLength = length;
+
+    if (le64toh(header->mChecksum) != queryFnvHash(
+            FNV_OFFSET_BASIS,
+            self->mEntries, self->mLength * sizeof(*self->mEntries))) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (-1 != fd)
+            close(fd);
+
+        if (rc && MAP_FAILED != self->mMap)
+            munmap(self->mMap, self->mSize);
+    });
+
+    return rc ? 0 : self;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+closeScheduleCache(struct ScheduleCache *self)
+{
+    if (MAP_FAILED != self->mMap)
+        munmap(self->mMap, self->mSize);
+
+    self->mMap = MAP_FAILED;
+    self->mSize = 0;
+    self->mEntries = 0;
+    self->mLength = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+struct SchedulePack *
+queryScheduleCachePack(
+    const struct ScheduleCache *self,
+    size_t aEntry,
+    struct SchedulePack *aPack)
+{
+    int rc = -1;
+
+    if (aEntry >= self->mLength) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    const uint32_t *words = self->mEntries[aEntry].mPack;
+
+    aPack->mMinutes[0] = le32toh(words[0]);
+    aPack->mMinutes[1] = le32toh(words[1]);
+    aPack->mHours = le32toh(words[2]);
+    aPack->mDays = le32toh(words[3]);
+    aPack->mMonths = le32toh(words[4]);
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : aPack;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+matchScheduleCache(
+    const struct ScheduleCache *self,
+    const char * const *aExpressions,
+    size_t aLength)
+{
+    /* The cache only needs to be regenerated if the expressions from which
+     * it was compiled have changed.
+     */
+
+    int match = aLength == self->mLength;
+
+    for (size_t ex = 0; match && ex < aLength; ++ex) {
+        match =
+            le64toh(self->mEntries[ex].mHash) ==
+            queryScheduleExpressionHash(aExpressions[ex]);
+    }
+
+    return match;
+}
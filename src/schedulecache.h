@@ -0,0 +1,108 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCHEDULECACHE_H
+#define SCHEDULECACHE_H
+
+#include "schedulepack.h"
+
+#include "compiler.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/* -------------------------------------------------------------------------- */
+BEGIN_C_SCOPE;
+
+/* A schedule cache file holds a header followed by an array of entries.
+ * Every field is stored little-endian, so that the file can be mapped and
+ * used in place. Each entry holds a packed schedule, and the hash of the
+ * expression that was compiled to produce it.
+ */
+
+enum {
+    ScheduleCacheVersion = 1,
+};
+
+struct ScheduleCacheHeader
+{
+    char mMagic[8];      /* CRONTIME */
+    uint32_t mVersion;
+    uint32_t mEntrySize;
+    uint64_t mLength;    /* Number of entries */
+    uint64_t mChecksum;  /* FNV-1a of the entries */
+};
+
+struct ScheduleCacheEntry
+{
+    uint64_t mHash;      /* FNV-1a of the expression */
+    uint32_t mPack[5];   /* Words of struct SchedulePack */
+    uint32_t mReserved;
+};
+
+struct ScheduleCache
+{
+    void *mMap;
+    size_t mSize;
+
+    const struct ScheduleCacheEntry *mEntries;
+    size_t mLength;
+};
+
+/* -------------------------------------------------------------------------- */
+uint64_t
+queryScheduleExpressionHash(const char *aExpression);
+
+int
+writeScheduleCache(
+    const char *aPath, const char * const *aExpressions, size_t aLength);
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleCache *
+initScheduleCache(struct ScheduleCache *self, const char *aPath);
+
+void
+closeScheduleCache(struct ScheduleCache *self);
+
+/* -------------------------------------------------------------------------- */
+struct SchedulePack *
+queryScheduleCachePack(
+    const struct ScheduleCache *self,
+    size_t aEntry,
+    struct SchedulePack *aPack);
+
+int
+matchScheduleCache(
+    const struct ScheduleCache *self,
+    const char * const *aExpressions,
+    size_t aLength);
+
+/* -------------------------------------------------------------------------- */
+END_C_SCOPE;
+
+#endif /* SCHEDULECACHE_H */
@@ -0,0 +1,571 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "schedulecomposite.h"
+
+#include "civiltime.h"
+#include "macros.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+/* -------------------------------------------------------------------------- */
+static const char CompositeOperators[] = "&|!()";
+static const char CompositeSpace[] = "\t ";
+
+/* -------------------------------------------------------------------------- */
+static ssize_t
+addScheduleCompositeNode_(
+    struct ScheduleComposite *self,
+    enum ScheduleCompositeKind aKind,
+    size_t aLhs,
+    size_t aRhs)
+{
+    int rc = -1;
+
+    if (self->mLength == self->mSize) {
+        size_t size = self->mSize ? 2 * self->mSize : 8;
+
+        struct ScheduleCompositeNode *nodes = realloc(
+            self->mNodes, size * sizeof(*nodes));
+        if (!nodes)
+            goto Finally;
+
+        self->mNodes = nodes;
+        self->mSize = size;
+    }
+
+    size_t node = self->mLength++;
+
+    self->mNodes[node].mKind = aKind;
+    self->mNodes[node].mLhs = aLhs;
+    self->mNodes[node].mRhs = aRhs;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : (ssize_t) node;
+}
+
+/* -------------------------------------------------------------------------- */
+static const char *
+skipScheduleCompositeSpace_(const char *aExpression)
+{
+    return aExpression + strspn(aExpression, CompositeSpace);
+}
+
+/* -------------------------------------------------------------------------- */
+static ssize_t
+parseScheduleCompositeOr_(
+    struct ScheduleComposite *self, const char **aExpression);
+
+static ssize_t
+parseScheduleCompositeSchedule_(
+    struct ScheduleComposite *self, const char **aExpression)
+{
+    int rc = -1;
+
+    char *schedule = 0;
+
+    ssize_t node = -1;
+
+    /* A schedule extends to the next operator, and its fields are
+     * collapsed so that they are separated by single spaces.
+     */
+
+    const char *expression = *aExpression;
+
+    size_t length = strcspn(expression, CompositeOperators);
+
+    schedule = malloc(length + 1);
+    if (!schedule)
+        goto Finally;
+
+    char *schedulePtr = schedule;
+
+    for (size_t ix = 0; ix < length; ) {
+        size_t spaces = strspn(expression + ix, CompositeSpace);
+
+        if (spaces) {
+            if (schedulePtr != schedule && ix + spaces < length)
+                *schedulePtr++ = ' ';
+            ix += spaces;
+        } else {
+            *schedulePtr++ = expression[ix++];
+        }
+    }
+
+    *schedulePtr = 0;
+
+    node = addScheduleCompositeNode_(self, ScheduleCompositeSchedule, 0, 0);
+    if (-1 == node)
+        goto Finally;
+
+    if (!initSchedule(&self->mNodes[node].mSchedule, schedule))
+        goto Finally;
+
+    /* Composite schedules are combined minute by minute, so they cannot
+     * include schedules that select seconds.
+     */
+
+    if (queryBitRingPopulation(&self->mNodes[node].mSchedule.mSeconds)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    *aExpression = expression + length;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        free(schedule);
+    });
+
+    return rc ? -1 : node;
+}
+
+static ssize_t
+parseScheduleCompositeNot_(
+    struct ScheduleComposite *self, const char **aExpression)
+{
+    int rc = -1;
+
+    ssize_t node = -1;
+
+    const char *expression = skipScheduleCompositeSpace_(*aExpression);
+
+    if ('!' == *expression) {
+        ++expression;
+
+        ssize_t lhs = parseScheduleCompositeNot_(self, &expression);
+        if (-1 == lhs)
+            goto Finally;
+
+        node = addScheduleCompositeNode_(self, ScheduleCompositeNot, lhs, 0);
+        if (-1 == node)
+            goto Finally;
+
+    } else if ('(' == *expression) {
+        ++expression;
+
+        node = parseScheduleCompositeOr_(self, &expression);
+        if (-1 == node)
+            goto Finally;
+
+        expression = skipScheduleCompositeSpace_(expression);
+
+        if (')' != *expression) {
+            errno = EINVAL;
+            goto Finally;
+        }
+
+        ++expression;
+
+    } else {
+
+        node = parseScheduleCompositeSchedule_(self, &expression);
+        if (-1 == node)
+            goto Finally;
+    }
+
+    *aExpression = expression;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : node;
+}
+
+static ssize_t
+parseScheduleCompositeBinary_(
+    struct ScheduleComposite *self,
+    const char **aExpression,
+    char aOperator,
+    enum ScheduleCompositeKind aKind,
+    ssize_t (*aParseOperand)(struct ScheduleComposite *, const char **))
+{
+    int rc = -1;
+
+    const char *expression = *aExpression;
+
+    ssize_t node = aParseOperand(self, &expression);
+    if (-1 == node)
+        goto Finally;
+
+    while (1) {
+        expression = skipScheduleCompositeSpace_(expression);
+
+        if (aOperator != *expression)
+            break;
+
+        ++expression;
+
+        ssize_t rhs = aParseOperand(self, &expression);
+        if (-1 == rhs)
+            goto Finally;
+
+        node = addScheduleCompositeNode_(self, aKind, node, rhs);
+        if (-1 == node)
+            goto Finally;
+    }
+
+    *aExpression = expression;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : node;
+}
+
+static ssize_t
+parseScheduleCompositeAnd_(
+    struct ScheduleComposite *self, const char **aExpression)
+{
+    return parseScheduleCompositeBinary_(
+        self,
+        aExpression, '&', ScheduleCompositeAnd, parseScheduleCompositeNot_);
+}
+
+static ssize_t
+parseScheduleCompositeOr_(
+    struct ScheduleComposite *self, const char **aExpression)
+{
+    return parseScheduleCompositeBinary_(
+        self,
+        aExpression, '|', ScheduleCompositeOr, parseScheduleCompositeAnd_);
+}
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleComposite *
+initScheduleComposite(struct ScheduleComposite *self, const char *aExpression)
+{
+    int rc = -1;
+
+    self->mNodes = 0;
+    self->mLength = 0;
+    self->mSize = 0;
+    self->mRoot = 0;
+
+    const char *expression = aExpression;
+
+    ssize_t root = parseScheduleCompositeOr_(self, &expression);
+    if (-1 == root)
+        goto Finally;
+
+    if (*skipScheduleCompositeSpace_(expression)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    self->mRoot = root;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (rc)
+            closeScheduleComposite(self);
+    });
+
+    return rc ? 0 : self;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+closeScheduleComposite(struct ScheduleComposite *self)
+{
+    free(self->mNodes);
+
+    self->mNodes = 0;
+    self->mLength = 0;
+    self->mSize = 0;
+    self->mRoot = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+matchScheduleCompositeNode_(
+    const struct ScheduleComposite *self,
+    size_t aNode,
+    const struct CivilTime *aCivilTime)
+{
+    const struct ScheduleCompositeNode *node = &self->mNodes[aNode];
+
+    int match = 0;
+
+    switch (node->mKind) {
+    case ScheduleCompositeSchedule:
+        match = matchSchedule(&node->mSchedule, aCivilTime);
+        break;
+
+    case ScheduleCompositeAnd:
+        match =
+            matchScheduleCompositeNode_(self, node->mLhs, aCivilTime) &&
+            matchScheduleCompositeNode_(self, node->mRhs, aCivilTime);
+        break;
+
+    case ScheduleCompositeOr:
+        match =
+            matchScheduleCompositeNode_(self, node->mLhs, aCivilTime) ||
+            matchScheduleCompositeNode_(self, node->mRhs, aCivilTime);
+        break;
+
+    case ScheduleCompositeNot:
+        match = !matchScheduleCompositeNode_(self, node->mLhs, aCivilTime);
+        break;
+    }
+
+    return match;
+}
+
+int
+matchScheduleComposite(
+    const struct ScheduleComposite *self, const struct CivilTime *aCivilTime)
+{
+    return matchScheduleCompositeNode_(self, self->mRoot, aCivilTime);
+}
+
+/* -------------------------------------------------------------------------- */
+static time_t
+queryScheduleCompositeNode_(
+    const struct ScheduleComposite *self,
+    size_t aNode,
+    time_t aSince,
+    time_t aHorizon,
+    int aMatch);
+
+static time_t
+queryScheduleCompositeSchedule_(
+    const struct Schedule *aSchedule,
+    time_t aSince,
+    time_t aHorizon,
+    int aMatch)
+{
+    int rc = -1;
+
+    time_t scheduled = -1;
+
+    if (-1 != aHorizon && aSince > aHorizon) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    struct CivilTime civilTime;
+
+    if (!initCivilTime(&civilTime, aSince))
+        goto Finally;
+
+    /* A horizon of zero is unlimited, so use a horizon of one second
+     * to limit the search to the first minute. Both the occurrences,
+     * and the minutes at which the schedule does not match, are found
+     * directly from the fields of the schedule.
+     */
+
+    time_t horizon = -1 == aHorizon ? 0 : aHorizon - aSince;
+
+    if (-1 != aHorizon && !horizon)
+        horizon = 1;
+
+    scheduled = aMatch
+        ? querySchedule(aSchedule, &civilTime, horizon, 0, 0)
+        : queryScheduleGap(aSchedule, &civilTime, horizon);
+    if (-1 == scheduled)
+        goto Finally;
+
+    if (-1 != aHorizon && scheduled > aHorizon) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : scheduled;
+}
+
+static time_t
+queryScheduleCompositeEither_(
+    const struct ScheduleComposite *self,
+    const struct ScheduleCompositeNode *aNode,
+    time_t aSince,
+    time_t aHorizon,
+    int aMatch)
+{
+    int rc = -1;
+
+    /* The earliest time at which either operand is satisfied. An operand
+     * that cannot be satisfied within the horizon is ignored, unless
+     * neither operand can be satisfied.
+     */
+
+    time_t lhs = queryScheduleCompositeNode_(
+        self, aNode->mLhs, aSince, aHorizon, aMatch);
+    if (-1 == lhs && ENOENT != errno)
+        goto Finally;
+
+    time_t rhs = queryScheduleCompositeNode_(
+        self, aNode->mRhs, aSince, -1 == lhs ? aHorizon : lhs, aMatch);
+    if (-1 == rhs && ENOENT != errno)
+        goto Finally;
+
+    if (-1 == lhs && -1 == rhs) {
+        errno = ENOENT;
+        goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : (-1 == lhs || (-1 != rhs && rhs < lhs) ? rhs : lhs);
+}
+
+static time_t
+queryScheduleCompositeBoth_(
+    const struct ScheduleComposite *self,
+    const struct ScheduleCompositeNode *aNode,
+    time_t aSince,
+    time_t aHorizon,
+    int aMatch)
+{
+    int rc = -1;
+
+    /* Leapfrog the operands, advancing the candidate to the earliest
+     * time that satisfies each operand in turn, until the candidate
+     * satisfies both operands. This skips over the times that do not
+     * satisfy one or other operand without examining them.
+     */
+
+    time_t candidate = aSince;
+
+    while (1) {
+        time_t lhs = queryScheduleCompositeNode_(
+            self, aNode->mLhs, candidate, aHorizon, aMatch);
+        if (-1 == lhs)
+            goto Finally;
+
+        time_t rhs = queryScheduleCompositeNode_(
+            self, aNode->mRhs, lhs, aHorizon, aMatch);
+        if (-1 == rhs)
+            goto Finally;
+
+        candidate = rhs;
+
+        if (lhs == rhs)
+            break;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : candidate;
+}
+
+static time_t
+queryScheduleCompositeNode_(
+    const struct ScheduleComposite *self,
+    size_t aNode,
+    time_t aSince,
+    time_t aHorizon,
+    int aMatch)
+{
+    const struct ScheduleCompositeNode *node = &self->mNodes[aNode];
+
+    /* Find the earliest time at or after the specified time at which
+     * the node matches, or does not match. By De Morgan, the times
+     * at which a conjunction does not match are those at which either
+     * operand does not match, and conversely for a disjunction.
+     */
+
+    time_t scheduled = -1;
+
+    switch (node->mKind) {
+    case ScheduleCompositeSchedule:
+        scheduled = queryScheduleCompositeSchedule_(
+            &node->mSchedule, aSince, aHorizon, aMatch);
+        break;
+
+    case ScheduleCompositeAnd:
+        scheduled = aMatch
+            ? queryScheduleCompositeBoth_(self, node, aSince, aHorizon, 1)
+            : queryScheduleCompositeEither_(self, node, aSince, aHorizon, 0);
+        break;
+
+    case ScheduleCompositeOr:
+        scheduled = aMatch
+            ? queryScheduleCompositeEither_(self, node, aSince, aHorizon, 1)
+            : queryScheduleCompositeBoth_(self, node, aSince, aHorizon, 0);
+        break;
+
+    case ScheduleCompositeNot:
+        scheduled = queryScheduleCompositeNode_(
+            self, node->mLhs, aSince, aHorizon, !aMatch);
+        break;
+    }
+
+    return scheduled;
+}
+
+/* -------------------------------------------------------------------------- */
+time_t
+queryScheduleComposite(
+    const struct ScheduleComposite *self,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon)
+{
+    int rc = -1;
+
+    if (0 > aHorizon) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    time_t since = queryCivilTimeUtc(aCivilTime);
+
+    time_t scheduled = queryScheduleCompositeNode_(
+        self, self->mRoot, since, aHorizon ? since + aHorizon : -1, 1);
+    if (-1 == scheduled)
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : scheduled;
+}
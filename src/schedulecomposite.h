@@ -0,0 +1,97 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCHEDULECOMPOSITE_H
+#define SCHEDULECOMPOSITE_H
+
+#include "schedule.h"
+
+#include "compiler.h"
+
+#include <stddef.h>
+#include <time.h>
+
+/* -------------------------------------------------------------------------- */
+BEGIN_C_SCOPE;
+
+/* A composite schedule combines crontab(5) schedules using the operators
+ * & (and), | (or), ! (not), and parentheses, with the conventional
+ * precedence. For example, every minute of business hours on weekdays,
+ * excluding the 12:00 hour:
+ *
+ *     * 9-17 * * 1-5 & !* 12 * * *
+ */
+
+enum ScheduleCompositeKind {
+    ScheduleCompositeSchedule,
+    ScheduleCompositeAnd,
+    ScheduleCompositeOr,
+    ScheduleCompositeNot,
+};
+
+struct ScheduleCompositeNode
+{
+    enum ScheduleCompositeKind mKind;
+
+    struct Schedule mSchedule; /* ScheduleCompositeSchedule */
+
+    size_t mLhs; /* ScheduleCompositeAnd, Or, and Not */
+    size_t mRhs; /* ScheduleCompositeAnd, and Or */
+};
+
+struct ScheduleComposite
+{
+    struct ScheduleCompositeNode *mNodes;
+    size_t mLength;
+    size_t mSize;
+
+    size_t mRoot;
+};
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleComposite *
+initScheduleComposite(struct ScheduleComposite *self, const char *aExpression);
+
+void
+closeScheduleComposite(struct ScheduleComposite *self);
+
+/* -------------------------------------------------------------------------- */
+int
+matchScheduleComposite(
+    const struct ScheduleComposite *self, const struct CivilTime *aCivilTime);
+
+time_t
+queryScheduleComposite(
+    const struct ScheduleComposite *self,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon);
+
+/* -------------------------------------------------------------------------- */
+END_C_SCOPE;
+
+#endif /* SCHEDULECOMPOSITE_H */
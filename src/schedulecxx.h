@@ -0,0 +1,347 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCHEDULECXX_H
+#define SCHEDULECXX_H
+
+#include "civiltime.h"
+#include "schedule.h"
+
+#include <chrono>
+#include <cerrno>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#if __cplusplus >= 202002L
+#include <ranges>
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* Header only C++ wrappers for schedules. Times are represented using
+ * std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds>,
+ * which is std::chrono::sys_seconds in C++20. Failures are reported by
+ * throwing std::system_error carrying the errno value.
+ *
+ * Occurrences are computed lazily by an input range that holds the
+ * schedule iterator in place, so that stepping through the occurrences
+ * does not allocate. In C++20 the range is a view, and composes with
+ * std::views::take and std::views::take_while:
+ *
+ *     for (auto scheduled :
+ *             schedule.occurrences(now) | std::views::take(10)) ...
+ */
+
+namespace crontime
+{
+
+typedef std::chrono::time_point<
+    std::chrono::system_clock, std::chrono::seconds> Seconds;
+
+/* -------------------------------------------------------------------------- */
+namespace cxx_
+{
+
+inline void
+throwErrno(const char *aWhat)
+{
+    throw std::system_error(errno, std::generic_category(), aWhat);
+}
+
+/* Crontab schedules have a granularity of 1 minute, so round the time
+ * up to the next minute, as is done by crontime. A schedule that selects
+ * seconds is instead searched from the specified second.
+ */
+
+inline struct CivilTime
+initCivilTime(const struct Schedule &aSchedule, Seconds aTime)
+{
+    struct CivilTime civilTime;
+
+    time_t time = aTime.time_since_epoch().count();
+    int second = (time % 60 + 60) % 60;
+
+    if (queryBitRingPopulation(&aSchedule.mSeconds)) {
+        if (!::initCivilTime(&civilTime, time - second))
+            throwErrno("initCivilTime");
+
+        if (second && advanceCivilTimeSecond(&civilTime, second))
+            throwErrno("advanceCivilTimeSecond");
+    } else {
+        if (second)
+            time += 60 - second;
+
+        if (!::initCivilTime(&civilTime, time))
+            throwErrno("initCivilTime");
+    }
+
+    return civilTime;
+}
+
+} // namespace cxx_
+
+/* -------------------------------------------------------------------------- */
+class Occurrences
+#if __cplusplus >= 202002L
+    : public std::ranges::view_base
+#endif
+{
+public:
+
+    class iterator
+    {
+    public:
+
+        typedef std::input_iterator_tag iterator_category;
+        typedef Seconds value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Seconds *pointer;
+        typedef const Seconds &reference;
+
+        iterator()
+        : mOccurrences(0)
+        { }
+
+        explicit iterator(Occurrences *aOccurrences)
+        : mOccurrences(aOccurrences)
+        { }
+
+        reference operator*() const
+        {
+            return mOccurrences->mScheduled;
+        }
+
+        pointer operator->() const
+        {
+            return &mOccurrences->mScheduled;
+        }
+
+        iterator &operator++()
+        {
+            mOccurrences->next_();
+            return *this;
+        }
+
+        /* Like other input iterators, the postfix increment yields the
+         * value preceding the increment.
+         */
+
+        class postfix
+        {
+        public:
+
+            explicit postfix(Seconds aValue)
+            : mValue(aValue)
+            { }
+
+            const Seconds &operator*() const
+            {
+                return mValue;
+            }
+
+        private:
+
+            Seconds mValue;
+        };
+
+        postfix operator++(int)
+        {
+            postfix prev(**this);
+            ++*this;
+            return prev;
+        }
+
+        /* All iterators that have reached the end of the occurrences
+         * compare equal, and any other iterator compares unequal.
+         */
+
+        bool operator==(const iterator &aOther) const
+        {
+            return end_() && aOther.end_();
+        }
+
+        bool operator!=(const iterator &aOther) const
+        {
+            return !(*this == aOther);
+        }
+
+    private:
+
+        bool end_() const
+        {
+            return !mOccurrences || mOccurrences->mEnd;
+        }
+
+        Occurrences *mOccurrences;
+    };
+
+    Occurrences()
+    : mEnd(true)
+    { }
+
+    Occurrences(
+        const struct Schedule &aSchedule,
+        Seconds aFrom,
+        std::chrono::seconds aHorizon = std::chrono::seconds(0))
+    : mSchedule(aSchedule),
+      mEnd(false),
+      mStarted(false)
+    {
+        struct CivilTime civilTime = cxx_::initCivilTime(aSchedule, aFrom);
+
+        initScheduleIterator(&mIterator, &mSchedule, &civilTime);
+
+        if (aHorizon.count()) {
+            if (!limitScheduleIterator(&mIterator, aHorizon.count(), 0))
+                cxx_::throwErrno("limitScheduleIterator");
+        }
+    }
+
+    /* The occurrences are computed lazily on demand, starting when
+     * the first iterator is obtained.
+     */
+
+    iterator begin()
+    {
+        if (!mEnd && !mStarted) {
+            mStarted = true;
+            next_();
+        }
+
+        return iterator(this);
+    }
+
+    iterator end()
+    {
+        return iterator();
+    }
+
+private:
+
+    void next_()
+    {
+        /* Refer to the schedule from the iterator afresh, since the
+         * occurrences might have been moved since the last step.
+         */
+
+        mIterator.mSchedule = &mSchedule;
+
+        time_t scheduled = nextScheduleOccurrence(&mIterator);
+
+        if (-1 != scheduled) {
+            mScheduled = Seconds(std::chrono::seconds(scheduled));
+        } else if (ENOENT == errno) {
+            mEnd = true;
+        } else {
+            mEnd = true;
+            cxx_::throwErrno("nextScheduleOccurrence");
+        }
+    }
+
+    struct Schedule mSchedule;
+    struct ScheduleIterator mIterator;
+
+    Seconds mScheduled;
+    bool mEnd;
+    bool mStarted;
+};
+
+/* -------------------------------------------------------------------------- */
+class CronSchedule
+{
+public:
+
+    explicit CronSchedule(const char *aSchedule)
+    {
+        if (!initSchedule(&mSchedule, aSchedule))
+            cxx_::throwErrno("initSchedule");
+    }
+
+    explicit CronSchedule(const std::string &aSchedule)
+    {
+        if (!initSchedule(&mSchedule, aSchedule.c_str()))
+            cxx_::throwErrno("initSchedule");
+    }
+
+    CronSchedule(const std::string &aSchedule, const std::string &aKey)
+    {
+        if (!initScheduleKey(&mSchedule, aSchedule.c_str(), aKey.c_str()))
+            cxx_::throwErrno("initScheduleKey");
+    }
+
+    explicit CronSchedule(const struct Schedule &aSchedule)
+    : mSchedule(aSchedule)
+    { }
+
+    const struct Schedule &schedule() const
+    {
+        return mSchedule;
+    }
+
+    Seconds next(
+        Seconds aTime,
+        std::chrono::seconds aHorizon = std::chrono::seconds(0)) const
+    {
+        struct CivilTime civilTime = cxx_::initCivilTime(mSchedule, aTime);
+
+        time_t scheduled = querySchedule(
+            &mSchedule, &civilTime, aHorizon.count(), 0, 0);
+        if (-1 == scheduled)
+            cxx_::throwErrno("querySchedule");
+
+        return Seconds(std::chrono::seconds(scheduled));
+    }
+
+    bool match(Seconds aTime) const
+    {
+        struct CivilTime civilTime = cxx_::initCivilTime(mSchedule, aTime);
+
+        return queryCivilTimeUtc(&civilTime) == aTime.time_since_epoch().count()
+            && matchSchedule(&mSchedule, &civilTime);
+    }
+
+    Occurrences occurrences(
+        Seconds aFrom,
+        std::chrono::seconds aHorizon = std::chrono::seconds(0)) const
+    {
+        return Occurrences(mSchedule, aFrom, aHorizon);
+    }
+
+private:
+
+    struct Schedule mSchedule;
+};
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace crontime
+
+/* -------------------------------------------------------------------------- */
+
+#endif /* SCHEDULECXX_H */
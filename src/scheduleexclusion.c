@@ -0,0 +1,366 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "scheduleexclusion.h"
+
+#include "macros.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+enum {
+    ScheduleExclusionFirstYear_ = 1,
+    ScheduleExclusionLastYear_ = 9999,
+};
+
+/* -------------------------------------------------------------------------- */
+static int
+queryScheduleExclusionDays_(int aYear, int aMonth)
+{
+    static const int Days[] = {
+        31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31,
+    };
+
+    int leapYear =
+        !(aYear % 4) && (aYear % 100 || !(aYear % 400));
+
+    return Days[aMonth-1] + (2 == aMonth && leapYear);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+validScheduleExclusionDate_(int aYear, int aMonth, int aDay)
+{
+    return
+        aYear >= ScheduleExclusionFirstYear_ &&
+        aYear <= ScheduleExclusionLastYear_ &&
+        aMonth >= 1 && aMonth <= 12 &&
+        aDay >= 1 && aDay <= queryScheduleExclusionDays_(aYear, aMonth);
+}
+
+/* -------------------------------------------------------------------------- */
+static size_t
+findScheduleExclusionYear_(const struct ScheduleExclusion *self, int aYear)
+{
+    /* Find the first year that is not earlier than the specified year,
+     * or the end of the calendar if there is none.
+     */
+
+    size_t lo = 0;
+    size_t hi = self->mLength;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (self->mYears[mid].mYear < aYear)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleExclusion *
+initScheduleExclusion(struct ScheduleExclusion *self)
+{
+    self->mYears = 0;
+    self->mLength = 0;
+
+    return self;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+closeScheduleExclusion(struct ScheduleExclusion *self)
+{
+    free(self->mYears);
+
+    self->mYears = 0;
+    self->mLength = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+addScheduleExclusionDate(
+    struct ScheduleExclusion *self, int aYear, int aMonth, int aDay)
+{
+    int rc = -1;
+
+    if (!validScheduleExclusionDate_(aYear, aMonth, aDay)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    size_t yx = findScheduleExclusionYear_(self, aYear);
+
+    if (yx == self->mLength || self->mYears[yx].mYear != aYear) {
+
+        struct ScheduleExclusionYear *years = realloc(
+            self->mYears, (self->mLength + 1) * sizeof(*years));
+        if (!years)
+            goto Finally;
+
+        memmove(
+            &years[yx+1],
+            &years[yx],
+            (self->mLength - yx) * sizeof(*years));
+
+        memset(&years[yx], 0, sizeof(years[yx]));
+        years[yx].mYear = aYear;
+
+        self->mYears = years;
+        self->mLength += 1;
+    }
+
+    self->mYears[yx].mMonths[aMonth-1] |= (uint32_t) 1 << (aDay - 1);
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static const char *
+parseScheduleExclusionNumber_(int *aValue, const char *aString, int aDigits)
+{
+    int rc = -1;
+
+    int value = 0;
+
+    for (int dx = 0; dx < aDigits; ++dx) {
+        if (!isdigit((unsigned char) aString[dx])) {
+            errno = EINVAL;
+            goto Finally;
+        }
+        value = value * 10 + aString[dx] - '0';
+    }
+
+    *aValue = value;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : aString + aDigits;
+}
+
+static const char *
+parseScheduleExclusionDate_(
+    int *aYear, int *aMonth, int *aDay, const char *aString)
+{
+    int rc = -1;
+
+    /* Dates are written as YYYY-MM-DD. */
+
+    const char *string = aString;
+
+    string = parseScheduleExclusionNumber_(aYear, string, 4);
+    if (!string)
+        goto Finally;
+
+    if ('-' == *string)
+        string = parseScheduleExclusionNumber_(aMonth, string + 1, 2);
+    else
+        string = 0;
+    if (!string)
+        goto Finally;
+
+    if ('-' == *string)
+        string = parseScheduleExclusionNumber_(aDay, string + 1, 2);
+    else
+        string = 0;
+    if (!string)
+        goto Finally;
+
+    if (!validScheduleExclusionDate_(*aYear, *aMonth, *aDay))
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    if (rc)
+        errno = EINVAL;
+
+    return rc ? 0 : string;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+addScheduleExclusionDates(struct ScheduleExclusion *self, const char *aDates)
+{
+    int rc = -1;
+
+    /* Accept either a single date, or an inclusive range of dates
+     * written as YYYY-MM-DD..YYYY-MM-DD.
+     */
+
+    int year, month, day;
+
+    const char *datesPtr =
+        parseScheduleExclusionDate_(&year, &month, &day, aDates);
+    if (!datesPtr)
+        goto Finally;
+
+    int lastYear = year;
+    int lastMonth = month;
+    int lastDay = day;
+
+    if (!strncmp(datesPtr, "..", 2)) {
+        datesPtr = parseScheduleExclusionDate_(
+            &lastYear, &lastMonth, &lastDay, datesPtr + 2);
+        if (!datesPtr)
+            goto Finally;
+    }
+
+    if (*datesPtr) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    if (lastYear < year ||
+            (lastYear == year && (lastMonth < month ||
+                                  (lastMonth == month && lastDay < day)))) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    while (1) {
+        if (addScheduleExclusionDate(self, year, month, day))
+            goto Finally;
+
+        if (year == lastYear && month == lastMonth && day == lastDay)
+            break;
+
+        if (day < queryScheduleExclusionDays_(year, month)) {
+            ++day;
+        } else if (month < 12) {
+            ++month;
+            day = 1;
+        } else {
+            ++year;
+            month = 1;
+            day = 1;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+readScheduleExclusion(
+    struct ScheduleExclusion *self, FILE *aFile, unsigned long *aLineNo)
+{
+    int rc = -1;
+
+    char *linePtr = 0;
+    size_t allocLen = 0;
+
+    unsigned long lineNo;
+
+    for (lineNo = 1; ; ++lineNo) {
+
+        errno = 0;
+        ssize_t lineLen = getline(&linePtr, &allocLen, aFile);
+        if (-1 == lineLen) {
+            if (errno)
+                goto Finally;
+            break;
+        }
+
+        /* Skip blank lines and comments, and ignore the whitespace
+         * surrounding each date or range of dates.
+         */
+
+        while (lineLen && isspace((unsigned char) linePtr[lineLen-1]))
+            linePtr[--lineLen] = 0;
+
+        const char *textPtr = linePtr + strspn(linePtr, "\t ");
+        if (!*textPtr || '#' == *textPtr)
+            continue;
+
+        if (addScheduleExclusionDates(self, textPtr))
+            goto Finally;
+    }
+
+    lineNo = 0;
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        free(linePtr);
+        if (aLineNo)
+            *aLineNo = lineNo;
+    });
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+uint32_t
+queryScheduleExclusionMonth(
+    const struct ScheduleExclusion *self, int aYear, int aMonth)
+{
+    uint32_t days = 0;
+
+    if (aMonth >= 1 && aMonth <= 12) {
+        size_t yx = findScheduleExclusionYear_(self, aYear);
+
+        if (yx != self->mLength && self->mYears[yx].mYear == aYear)
+            days = self->mYears[yx].mMonths[aMonth-1];
+    }
+
+    return days;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+matchScheduleExclusion(
+    const struct ScheduleExclusion *self, int aYear, int aMonth, int aDay)
+{
+    return
+        aDay >= 1 && aDay <= 31 &&
+        (queryScheduleExclusionMonth(self, aYear, aMonth) >> (aDay - 1) & 1);
+}
+
+/* -------------------------------------------------------------------------- */
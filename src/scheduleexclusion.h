@@ -0,0 +1,90 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCHEDULEEXCLUSION_H
+#define SCHEDULEEXCLUSION_H
+
+#include "compiler.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* -------------------------------------------------------------------------- */
+BEGIN_C_SCOPE;
+
+/* An exclusion calendar holds the local dates on which schedules must
+ * not run, such as holidays or change freezes. Each year holds a bitmap
+ * of the days of each month, so that a date is excluded if its bit
+ * is set.
+ */
+
+struct ScheduleExclusionYear
+{
+    int mYear;
+    uint32_t mMonths[12]; /* Excluded days, with bit 0 for the 1st */
+};
+
+struct ScheduleExclusion
+{
+    struct ScheduleExclusionYear *mYears; /* Ordered by year */
+    size_t mLength;
+};
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleExclusion *
+initScheduleExclusion(struct ScheduleExclusion *self);
+
+void
+closeScheduleExclusion(struct ScheduleExclusion *self);
+
+/* -------------------------------------------------------------------------- */
+int
+addScheduleExclusionDate(
+    struct ScheduleExclusion *self, int aYear, int aMonth, int aDay);
+
+int
+addScheduleExclusionDates(struct ScheduleExclusion *self, const char *aDates);
+
+int
+readScheduleExclusion(
+    struct ScheduleExclusion *self, FILE *aFile, unsigned long *aLineNo);
+
+/* -------------------------------------------------------------------------- */
+uint32_t
+queryScheduleExclusionMonth(
+    const struct ScheduleExclusion *self, int aYear, int aMonth);
+
+int
+matchScheduleExclusion(
+    const struct ScheduleExclusion *self, int aYear, int aMonth, int aDay);
+
+/* -------------------------------------------------------------------------- */
+END_C_SCOPE;
+
+#endif /* SCHEDULEEXCLUSION_H */
@@ -0,0 +1,397 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "scheduleindex.h"
+
+#include "civiltime.h"
+#include "macros.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+/* Each field value has a row holding a bit for each job selected by that
+ * value. A job that does not constrain a field is present in every row
+ * of the field, and also in the wildcard row of the field. The wildcard
+ * row is used when the civil time masks a field that was repeated by
+ * a daylight savings change, so that only wildcards match.
+ *
+ * Days of the month and days of the week are combined, so a job that
+ * constrains neither is placed in every row of the days of the month, and
+ * in the wildcard row for the days of the month.
+ *
+ * The index does not hold the seconds, so a job that selects seconds
+ * is matched by each minute in which it runs. Nor does it hold the years,
+ * the validity window, or the excluded dates, so a job is matched as if
+ * it runs every year. Similarly a job that selects days by the month
+ * days is matched as if it runs every day.
+ */
+
+enum ScheduleIndexRow {
+    ScheduleIndexMinutes = 0,
+    ScheduleIndexHours = ScheduleIndexMinutes + 60,
+    ScheduleIndexDays = ScheduleIndexHours + 24,
+    ScheduleIndexMonths = ScheduleIndexDays + 31,
+    ScheduleIndexWeekDays = ScheduleIndexMonths + 12,
+    ScheduleIndexWildcards = ScheduleIndexWeekDays + DaysInWeek,
+    ScheduleIndexMatches = ScheduleIndexWildcards + ScheduleKinds,
+    ScheduleIndexRows,
+};
+
+static const struct {
+    int mRow;
+    int mMin;
+    int mMax;
+} ScheduleIndexFields[ScheduleKinds] = {
+    [ScheduleMinutes]  = { ScheduleIndexMinutes,  0, 59 },
+    [ScheduleHours]    = { ScheduleIndexHours,    0, 23 },
+    [ScheduleDays]     = { ScheduleIndexDays,     1, 31 },
+    [ScheduleMonths]   = { ScheduleIndexMonths,   1, 12 },
+    [ScheduleWeekDays] = { ScheduleIndexWeekDays, 0, DaysInWeek - 1 },
+};
+
+#define SCHEDULEINDEX_BITS (sizeof(ScheduleIndexT) * 8)
+
+/* -------------------------------------------------------------------------- */
+static ScheduleIndexT *
+scheduleIndexRow_(const struct ScheduleIndex *self, int aRow)
+{
+    return self->mRows + aRow * self->mWords;
+}
+
+/* -------------------------------------------------------------------------- */
+static ScheduleIndexT *
+scheduleIndexFieldRow_(
+    const struct ScheduleIndex *self,
+    enum ScheduleKind aScheduleKind,
+    int aValue)
+{
+    int row = aValue < 0
+        ? ScheduleIndexWildcards + aScheduleKind
+        : ScheduleIndexFields[aScheduleKind].mRow +
+            aValue - ScheduleIndexFields[aScheduleKind].mMin;
+
+    return scheduleIndexRow_(self, row);
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+setScheduleIndexJob_(
+    struct ScheduleIndex *self,
+    enum ScheduleKind aScheduleKind,
+    int aValue,
+    size_t aJob)
+{
+    ScheduleIndexT *row = scheduleIndexFieldRow_(self, aScheduleKind, aValue);
+
+    row[aJob / SCHEDULEINDEX_BITS] |=
+        (ScheduleIndexT) 1 << (aJob % SCHEDULEINDEX_BITS);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+growScheduleIndex_(struct ScheduleIndex *self, size_t aJob)
+{
+    int rc = -1;
+
+    size_t words = self->mWords ? self->mWords : 1;
+
+    while (aJob / SCHEDULEINDEX_BITS >= words)
+        words *= 2;
+
+    if (words != self->mWords) {
+
+        ScheduleIndexT *rows = calloc(ScheduleIndexRows * words, sizeof(*rows));
+        if (!rows)
+            goto Finally;
+
+        if (self->mWords) {
+            for (int rx = 0; rx < ScheduleIndexRows; ++rx) {
+                memcpy(
+                    rows + rx * words,
+                    scheduleIndexRow_(self, rx),
+                    self->mWords * sizeof(*rows));
+            }
+        }
+
+        free(self->mRows);
+
+        self->mRows = rows;
+        self->mWords = words;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleIndex *
+initScheduleIndex(struct ScheduleIndex *self)
+{
+    self->mRows = 0;
+    self->mWords = 0;
+
+    return self;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+closeScheduleIndex(struct ScheduleIndex *self)
+{
+    free(self->mRows);
+
+    self->mRows = 0;
+    self->mWords = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+addScheduleIndexJob(
+    struct ScheduleIndex *self, size_t aJob, const struct Schedule *aSchedule)
+{
+    int rc = -1;
+
+    if (growScheduleIndex_(self, aJob))
+        goto Finally;
+
+    removeScheduleIndexJob(self, aJob);
+
+    const struct BitRing *days = &aSchedule->mSchedules[ScheduleDays];
+    const struct BitRing *weekDays = &aSchedule->mSchedules[ScheduleWeekDays];
+
+    int anyDay =
+        queryScheduleMonthDaysPopulation(&aSchedule->mMonthDays) ||
+        (!queryBitRingPopulation(days) && !queryBitRingPopulation(weekDays));
+
+    for (unsigned kx = 0; kx < NUMBEROF(ScheduleIndexFields); ++kx) {
+
+        const struct BitRing *bitring = &aSchedule->mSchedules[kx];
+
+        /* A wildcard for the days of the month only selects every day
+         * if the days of the week are also a wildcard, and a wildcard
+         * for the days of the week never selects any day by itself.
+         */
+
+        int wildcard = !queryBitRingPopulation(bitring);
+
+        if (ScheduleDays == kx)
+            wildcard = anyDay;
+        else if (ScheduleWeekDays == kx)
+            wildcard = 0;
+
+        if (wildcard)
+            setScheduleIndexJob_(self, kx, -1, aJob);
+
+        for (int value = ScheduleIndexFields[kx].mMin;
+                value <= ScheduleIndexFields[kx].mMax;
+                ++value) {
+
+            if (wildcard || queryBitRingMembership(bitring, value))
+                setScheduleIndexJob_(self, kx, value, aJob);
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+removeScheduleIndexJob(struct ScheduleIndex *self, size_t aJob)
+{
+    size_t word = aJob / SCHEDULEINDEX_BITS;
+
+    if (word < self->mWords) {
+
+        ScheduleIndexT mask =
+            ~((ScheduleIndexT) 1 << (aJob % SCHEDULEINDEX_BITS));
+
+        for (int rx = 0; rx < ScheduleIndexRows; ++rx)
+            scheduleIndexRow_(self, rx)[word] &= mask;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+matchScheduleIndexTime_(
+    const struct ScheduleIndex *self,
+    struct Calendar aCalendar,
+    struct Clock aClock,
+    ScheduleIndexT *aMatches)
+{
+    /* Masked fields select the wildcard rows. The days of the week are
+     * never masked, and a job matches the day if it is selected by
+     * either the day of the month, or the day of the week.
+     */
+
+    const ScheduleIndexT *minutes =
+        scheduleIndexFieldRow_(self, ScheduleMinutes, aClock.mMinute);
+    const ScheduleIndexT *hours =
+        scheduleIndexFieldRow_(self, ScheduleHours, aClock.mHour);
+    const ScheduleIndexT *days =
+        scheduleIndexFieldRow_(self, ScheduleDays, aCalendar.mDay);
+    const ScheduleIndexT *months =
+        scheduleIndexFieldRow_(self, ScheduleMonths, aCalendar.mMonth);
+    const ScheduleIndexT *weekDays =
+        scheduleIndexFieldRow_(self, ScheduleWeekDays, aCalendar.mWeekDay);
+
+    for (size_t wx = 0; wx < self->mWords; ++wx) {
+        aMatches[wx] |=
+            minutes[wx] & hours[wx] & months[wx] & (days[wx] | weekDays[wx]);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+const ScheduleIndexT *
+matchScheduleIndex(
+    struct ScheduleIndex *self, const struct CivilTime *aCivilTime)
+{
+    ScheduleIndexT *matches = scheduleIndexRow_(self, ScheduleIndexMatches);
+
+    for (size_t wx = 0; wx < self->mWords; ++wx)
+        matches[wx] = 0;
+
+    matchScheduleIndexTime_(
+        self,
+        queryCivilTimeCalendar(aCivilTime),
+        queryCivilTimeClock(aCivilTime),
+        matches);
+
+    /* As for matchSchedule(), in the period skipped by a daylight savings
+     * change, a job matches either the artificial time or the local time
+     * that actually applies.
+     */
+
+    struct Calendar calendar;
+    struct Clock clock;
+
+    if (1 == queryCivilTimeArtificial(aCivilTime, &calendar, &clock))
+        matchScheduleIndexTime_(self, calendar, clock, matches);
+
+    return matches;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+mergeScheduleIndexRows_(
+    const struct ScheduleIndex *self,
+    enum ScheduleKind aScheduleKind,
+    const struct BitRing *aBitRing,
+    ScheduleIndexT *aMerged)
+{
+    /* Merge the rows of each value selected by the field, treating
+     * a wildcard as selecting every value.
+     */
+
+    int wildcard = !aBitRing || !queryBitRingPopulation(aBitRing);
+
+    for (int value = ScheduleIndexFields[aScheduleKind].mMin;
+            value <= ScheduleIndexFields[aScheduleKind].mMax;
+            ++value) {
+
+        if (wildcard || queryBitRingMembership(aBitRing, value)) {
+            const ScheduleIndexT *row =
+                scheduleIndexFieldRow_(self, aScheduleKind, value);
+
+            for (size_t wx = 0; wx < self->mWords; ++wx)
+                aMerged[wx] |= row[wx];
+        }
+    }
+}
+
+size_t
+queryScheduleIndexCandidates(
+    struct ScheduleIndex *self,
+    const struct Schedule *aSchedule,
+    ScheduleIndexT *aCandidates)
+{
+    ScheduleIndexT *merged = scheduleIndexRow_(self, ScheduleIndexMatches);
+
+    for (size_t wx = 0; wx < self->mWords; ++wx)
+        aCandidates[wx] = ~(ScheduleIndexT) 0;
+
+    /* A job is a candidate if it shares a value with the schedule in
+     * each of the minutes, hours, and months. Wildcards are already
+     * present in every row of the field.
+     */
+
+    static const enum ScheduleKind Kinds[] = {
+        ScheduleMinutes, ScheduleHours, ScheduleMonths,
+    };
+
+    for (unsigned kx = 0; kx < NUMBEROF(Kinds); ++kx) {
+        memset(merged, 0, self->mWords * sizeof(*merged));
+
+        mergeScheduleIndexRows_(
+            self, Kinds[kx], &aSchedule->mSchedules[Kinds[kx]], merged);
+
+        for (size_t wx = 0; wx < self->mWords; ++wx)
+            aCandidates[wx] &= merged[wx];
+    }
+
+    /* The days are approximated by considering the days of the month
+     * and the days of the week separately. A schedule that constrains
+     * the days of the week can fall on any day of the month, and a
+     * schedule that constrains the days of the month can fall on any
+     * day of the week. A schedule that selects days by the month days
+     * can fall on any day at all.
+     */
+
+    const struct BitRing *days = &aSchedule->mSchedules[ScheduleDays];
+    const struct BitRing *weekDays = &aSchedule->mSchedules[ScheduleWeekDays];
+
+    int anyDays = !!queryBitRingPopulation(weekDays);
+    int anyWeekDays = !!queryBitRingPopulation(days);
+
+    if (queryScheduleMonthDaysPopulation(&aSchedule->mMonthDays) ||
+            (!anyDays && !anyWeekDays))
+        anyDays = anyWeekDays = 1;
+
+    memset(merged, 0, self->mWords * sizeof(*merged));
+
+    mergeScheduleIndexRows_(self, ScheduleDays, anyDays ? 0 : days, merged);
+    mergeScheduleIndexRows_(
+        self, ScheduleWeekDays, anyWeekDays ? 0 : weekDays, merged);
+
+    size_t population = 0;
+
+    for (size_t wx = 0; wx < self->mWords; ++wx) {
+        aCandidates[wx] &= merged[wx];
+        population += __builtin_popcountll(aCandidates[wx]);
+    }
+
+    return population;
+}
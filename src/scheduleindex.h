@@ -0,0 +1,80 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCHEDULEINDEX_H
+#define SCHEDULEINDEX_H
+
+#include "schedule.h"
+
+#include "compiler.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/* -------------------------------------------------------------------------- */
+BEGIN_C_SCOPE;
+
+typedef uint64_t ScheduleIndexT;
+
+struct ScheduleIndex
+{
+    ScheduleIndexT *mRows;
+    size_t mWords;  /* Words in each row */
+};
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleIndex *
+initScheduleIndex(struct ScheduleIndex *self);
+
+void
+closeScheduleIndex(struct ScheduleIndex *self);
+
+/* -------------------------------------------------------------------------- */
+int
+addScheduleIndexJob(
+    struct ScheduleIndex *self, size_t aJob, const struct Schedule *aSchedule);
+
+void
+removeScheduleIndexJob(struct ScheduleIndex *self, size_t aJob);
+
+/* -------------------------------------------------------------------------- */
+const ScheduleIndexT *
+matchScheduleIndex(
+    struct ScheduleIndex *self, const struct CivilTime *aCivilTime);
+
+/* -------------------------------------------------------------------------- */
+size_t
+queryScheduleIndexCandidates(
+    struct ScheduleIndex *self,
+    const struct Schedule *aSchedule,
+    ScheduleIndexT *aCandidates);
+
+/* -------------------------------------------------------------------------- */
+END_C_SCOPE;
+
+#endif /* SCHEDULEINDEX_H */
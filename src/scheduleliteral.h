@@ -0,0 +1,642 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCHEDULELITERAL_H
+#define SCHEDULELITERAL_H
+
+#include "schedule.h"
+
+/* -------------------------------------------------------------------------- */
+/* Parse crontab(5) expressions at compile time, producing the same rings as
+ * initBitRing() and initSchedule(). The parser is written using C++11
+ * constexpr functions, each comprising a single return statement, so that
+ * it can be used by the C++11 test suite as well as newer compilers.
+ *
+ * Use CRONTIME_SCHEDULE() to obtain a constant struct Schedule, with
+ * invalid expressions rejected by static_assert:
+ *
+ *     constexpr struct Schedule Backup = CRONTIME_SCHEDULE("30 2 * * *");
+ *
+ * The shape of the schedule is also a constant expression, and can be
+ * used to select a template specialisation.
+ */
+
+namespace crontime
+{
+
+/* -------------------------------------------------------------------------- */
+struct BitRingLiteral
+{
+    struct BitRing mBitRing;
+    bool mValid;
+};
+
+struct ScheduleLiteral
+{
+    struct Schedule mSchedule;
+    bool mValid;
+};
+
+/* -------------------------------------------------------------------------- */
+namespace literal_
+{
+
+/* Numbers larger than any field are saturated, and are rejected as lying
+ * outside the range of the field.
+ */
+
+static constexpr unsigned long long NumberLimit = 1ULL << 32;
+
+constexpr bool
+isDigit(const char *aString, unsigned aBegin, unsigned aEnd)
+{
+    return aBegin < aEnd && '0' <= aString[aBegin] && '9' >= aString[aBegin];
+}
+
+constexpr unsigned
+scanNumber(const char *aString, unsigned aBegin, unsigned aEnd)
+{
+    return
+        isDigit(aString, aBegin, aEnd)
+            ? scanNumber(aString, aBegin + 1, aEnd)
+            : aBegin;
+}
+
+constexpr bool
+validNumber(const char *aString, unsigned aBegin, unsigned aEnd)
+{
+    return
+        isDigit(aString, aBegin, aEnd) &&
+        !('0' == aString[aBegin] && isDigit(aString, aBegin + 1, aEnd));
+}
+
+constexpr unsigned long long
+valueNumber(
+    const char *aString,
+    unsigned aBegin,
+    unsigned aEnd,
+    unsigned long long aValue = 0)
+{
+    return
+        aBegin == aEnd
+            ? aValue
+            : valueNumber(
+                aString, aBegin + 1, aEnd,
+                aValue > NumberLimit
+                    ? aValue
+                    : aValue * 10 + (aString[aBegin] - '0'));
+}
+
+/* -------------------------------------------------------------------------- */
+constexpr BitRingLiteral
+invalidBitRing(int aMin, int aMax)
+{
+    return BitRingLiteral{ { 0, aMin, aMax }, false };
+}
+
+constexpr BitRingLiteral
+mergeBitRing(BitRingLiteral aLhs, BitRingLiteral aRhs)
+{
+    return BitRingLiteral{
+        {
+            aLhs.mBitRing.mRing | aRhs.mBitRing.mRing,
+            aLhs.mBitRing.mMin,
+            aLhs.mBitRing.mMax,
+        },
+        aLhs.mValid && aRhs.mValid,
+    };
+}
+
+constexpr BitRingT
+rangeBitRing(
+    unsigned long long aLhs,
+    unsigned long long aRhs,
+    unsigned long long aPeriod,
+    int aMin)
+{
+    return
+        ((BitRingT) 1 << (aLhs - aMin)) |
+        (aPeriod > aRhs - aLhs
+            ? 0
+            : rangeBitRing(aLhs + aPeriod, aRhs, aPeriod, aMin));
+}
+
+constexpr BitRingLiteral
+parseBitRingRange(
+    unsigned long long aLhs,
+    unsigned long long aRhs,
+    unsigned long long aPeriod,
+    bool aValid,
+    int aMin,
+    int aMax)
+{
+    return
+        aValid && aPeriod && aLhs <= aRhs &&
+        aLhs >= (unsigned long long) aMin &&
+        aRhs <= (unsigned long long) aMax
+            ? BitRingLiteral{
+                { rangeBitRing(aLhs, aRhs, aPeriod, aMin), aMin, aMax }, true }
+            : invalidBitRing(aMin, aMax);
+}
+
+/* -------------------------------------------------------------------------- */
+constexpr BitRingLiteral
+parseBitRingList(
+    const char *aString, unsigned aBegin, unsigned aEnd, int aMin, int aMax);
+
+constexpr BitRingLiteral
+parseBitRingNext(
+    const char *aString,
+    unsigned aNext,
+    unsigned aEnd,
+    BitRingLiteral aItem,
+    int aMin,
+    int aMax)
+{
+    return
+        aNext == aEnd
+            ? aItem
+            : ',' == aString[aNext]
+                ? mergeBitRing(
+                    aItem,
+                    parseBitRingList(aString, aNext + 1, aEnd, aMin, aMax))
+                : invalidBitRing(aMin, aMax);
+}
+
+constexpr BitRingLiteral
+parseBitRingPeriod(
+    const char *aString,
+    unsigned aLhs,
+    unsigned aLhsEnd,
+    unsigned aRhsEnd,
+    unsigned aEnd,
+    int aMin,
+    int aMax)
+{
+    return
+        aRhsEnd < aEnd && '/' == aString[aRhsEnd]
+            ? parseBitRingNext(
+                aString,
+                scanNumber(aString, aRhsEnd + 1, aEnd),
+                aEnd,
+                parseBitRingRange(
+                    valueNumber(aString, aLhs, aLhsEnd),
+                    valueNumber(aString, aLhsEnd + 1, aRhsEnd),
+                    valueNumber(
+                        aString,
+                        aRhsEnd + 1, scanNumber(aString, aRhsEnd + 1, aEnd)),
+                    validNumber(aString, aLhs, aEnd) &&
+                    validNumber(aString, aLhsEnd + 1, aEnd) &&
+                    validNumber(aString, aRhsEnd + 1, aEnd),
+                    aMin, aMax),
+                aMin, aMax)
+            : parseBitRingNext(
+                aString,
+                aRhsEnd,
+                aEnd,
+                parseBitRingRange(
+                    valueNumber(aString, aLhs, aLhsEnd),
+                    valueNumber(aString, aLhsEnd + 1, aRhsEnd),
+                    1,
+                    validNumber(aString, aLhs, aEnd) &&
+                    validNumber(aString, aLhsEnd + 1, aEnd),
+                    aMin, aMax),
+                aMin, aMax);
+}
+
+constexpr BitRingLiteral
+parseBitRingItem(
+    const char *aString,
+    unsigned aBegin,
+    unsigned aLhsEnd,
+    unsigned aEnd,
+    int aMin,
+    int aMax)
+{
+    return
+        aLhsEnd < aEnd && '-' == aString[aLhsEnd]
+            ? parseBitRingPeriod(
+                aString,
+                aBegin,
+                aLhsEnd,
+                scanNumber(aString, aLhsEnd + 1, aEnd),
+                aEnd,
+                aMin, aMax)
+            : parseBitRingNext(
+                aString,
+                aLhsEnd,
+                aEnd,
+                parseBitRingRange(
+                    valueNumber(aString, aBegin, aLhsEnd),
+                    valueNumber(aString, aBegin, aLhsEnd),
+                    1,
+                    validNumber(aString, aBegin, aEnd),
+                    aMin, aMax),
+                aMin, aMax);
+}
+
+constexpr BitRingLiteral
+parseBitRingList(
+    const char *aString, unsigned aBegin, unsigned aEnd, int aMin, int aMax)
+{
+    return parseBitRingItem(
+        aString, aBegin, scanNumber(aString, aBegin, aEnd), aEnd, aMin, aMax);
+}
+
+/* -------------------------------------------------------------------------- */
+constexpr BitRingLiteral
+parseBitRingStep(
+    const char *aString,
+    unsigned aBegin,
+    unsigned aStepEnd,
+    unsigned aEnd,
+    int aMin,
+    int aMax)
+{
+    return
+        aStepEnd == aEnd
+            ? parseBitRingRange(
+                aMin,
+                aMax,
+                valueNumber(aString, aBegin, aStepEnd),
+                validNumber(aString, aBegin, aEnd),
+                aMin, aMax)
+            : invalidBitRing(aMin, aMax);
+}
+
+constexpr BitRingLiteral
+parseBitRingField(
+    const char *aString, unsigned aBegin, unsigned aEnd, int aMin, int aMax)
+{
+    return
+        aMax < aMin || aMax - aMin >= 64
+            ? invalidBitRing(aMin, aMax)
+            : isDigit(aString, aBegin, aEnd)
+                ? parseBitRingList(aString, aBegin, aEnd, aMin, aMax)
+                : !(aBegin < aEnd && '*' == aString[aBegin])
+                    ? invalidBitRing(aMin, aMax)
+                    : aBegin + 1 == aEnd
+                        ? BitRingLiteral{ { 0, aMin, aMax }, true }
+                        : '/' != aString[aBegin + 1]
+                            ? invalidBitRing(aMin, aMax)
+                            : parseBitRingStep(
+                                aString,
+                                aBegin + 2,
+                                scanNumber(aString, aBegin + 2, aEnd),
+                                aEnd,
+                                aMin, aMax);
+}
+
+/* -------------------------------------------------------------------------- */
+constexpr unsigned
+scanString(const char *aString, unsigned aBegin = 0)
+{
+    return aString[aBegin] ? scanString(aString, aBegin + 1) : aBegin;
+}
+
+constexpr bool
+isSeparator(char aChar)
+{
+    return ' ' == aChar || '\t' == aChar;
+}
+
+constexpr unsigned
+scanField(const char *aString, unsigned aBegin)
+{
+    return
+        aString[aBegin] && !isSeparator(aString[aBegin])
+            ? scanField(aString, aBegin + 1)
+            : aBegin;
+}
+
+/* Find the beginning of the specified field, with each field separated
+ * by a single separator as for initSchedule(). The beginning of a missing
+ * field lies beyond the end of the string.
+ */
+
+constexpr unsigned
+beginField(const char *aString, unsigned aField, unsigned aBegin = 0)
+{
+    return
+        !aField
+            ? aBegin
+            : !aString[scanField(aString, aBegin)]
+                ? scanString(aString) + 1
+                : beginField(
+                    aString, aField - 1, scanField(aString, aBegin) + 1);
+}
+
+constexpr unsigned
+endField(const char *aString, unsigned aField)
+{
+    return
+        beginField(aString, aField) > scanString(aString)
+            ? beginField(aString, aField)
+            : scanField(aString, beginField(aString, aField));
+}
+
+constexpr BitRingLiteral
+parseScheduleField(const char *aString, unsigned aField, int aMin, int aMax)
+{
+    return
+        beginField(aString, aField) > scanString(aString)
+            ? invalidBitRing(aMin, aMax)
+            : parseBitRingField(
+                aString,
+                beginField(aString, aField),
+                endField(aString, aField),
+                aMin, aMax);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Transfer the selected days of the week from the 0-7 range to the
+ * canonical 0-6 range.
+ */
+
+constexpr BitRingLiteral
+foldWeekDays(BitRingLiteral aWeekDays)
+{
+    return BitRingLiteral{
+        {
+            (aWeekDays.mBitRing.mRing & (((BitRingT) 1 << DaysInWeek) - 1)) |
+            (aWeekDays.mBitRing.mRing >> DaysInWeek),
+            0,
+            DaysInWeek - 1,
+        },
+        aWeekDays.mValid,
+    };
+}
+
+constexpr enum ScheduleShape
+classifySchedule(
+    BitRingT aHours,
+    BitRingT aDays,
+    BitRingT aMonths,
+    BitRingT aWeekDays,
+    BitRingT aYears)
+{
+    return
+        aDays || aMonths || aYears
+            ? ScheduleShapeGeneral
+            : aWeekDays
+                ? ScheduleShapeWeekDays
+                : aHours
+                    ? ScheduleShapeHours
+                    : ScheduleShapeMinutes;
+}
+
+/* As for initSchedule(), a wildcard selects every second, and only
+ * selecting the start of each minute is the same as omitting the seconds.
+ */
+
+constexpr BitRingLiteral
+canonicalSeconds(BitRingLiteral aSeconds)
+{
+    return BitRingLiteral{
+        {
+            !aSeconds.mBitRing.mRing
+                ? ((BitRingT) 1 << 60) - 1
+                : 1 == aSeconds.mBitRing.mRing
+                    ? 0
+                    : aSeconds.mBitRing.mRing,
+            0,
+            59,
+        },
+        aSeconds.mValid,
+    };
+}
+
+/* As for initSchedule(), the ring of years starts at the first selected
+ * year, so find the first year before parsing the field. Only a plain
+ * wildcard is accepted, and selects every year.
+ */
+
+static constexpr int FirstYear = 1970;
+static constexpr int LastYear = 2099;
+static constexpr int YearSpan = 64;
+
+constexpr unsigned
+scanItem(const char *aString, unsigned aBegin, unsigned aEnd)
+{
+    return
+        aBegin < aEnd && ',' != aString[aBegin]
+            ? scanItem(aString, aBegin + 1, aEnd)
+            : aBegin;
+}
+
+constexpr unsigned long long
+firstYear(
+    const char *aString,
+    unsigned aBegin,
+    unsigned aEnd,
+    unsigned long long aFirst = NumberLimit)
+{
+    return
+        aBegin >= aEnd
+            ? aFirst
+            : firstYear(
+                aString,
+                scanItem(aString, aBegin, aEnd) + 1,
+                aEnd,
+                valueNumber(
+                    aString, aBegin, scanNumber(aString, aBegin, aEnd))
+                        < aFirst
+                    ? valueNumber(
+                        aString, aBegin, scanNumber(aString, aBegin, aEnd))
+                    : aFirst);
+}
+
+constexpr BitRingLiteral
+parseYearsList(
+    const char *aString,
+    unsigned aBegin,
+    unsigned aEnd,
+    unsigned long long aFirst)
+{
+    return
+        aFirst < (unsigned long long) FirstYear ||
+        aFirst > (unsigned long long) LastYear
+            ? invalidBitRing(FirstYear, FirstYear + YearSpan - 1)
+            : parseBitRingList(
+                aString, aBegin, aEnd,
+                (int) aFirst,
+                aFirst + YearSpan - 1 > (unsigned long long) LastYear
+                    ? LastYear
+                    : (int) aFirst + YearSpan - 1);
+}
+
+constexpr BitRingLiteral
+everyYear()
+{
+    return BitRingLiteral{ { 0, FirstYear, FirstYear + YearSpan - 1 }, true };
+}
+
+constexpr BitRingLiteral
+parseYearsField(const char *aString, unsigned aBegin, unsigned aEnd)
+{
+    return
+        isDigit(aString, aBegin, aEnd)
+            ? parseYearsList(
+                aString, aBegin, aEnd, firstYear(aString, aBegin, aEnd))
+            : aBegin + 1 == aEnd && '*' == aString[aBegin]
+                ? everyYear()
+                : invalidBitRing(FirstYear, FirstYear + YearSpan - 1);
+}
+
+constexpr ScheduleLiteral
+parseSchedule(
+    BitRingLiteral aSeconds,
+    BitRingLiteral aMinutes,
+    BitRingLiteral aHours,
+    BitRingLiteral aDays,
+    BitRingLiteral aMonths,
+    BitRingLiteral aWeekDays,
+    BitRingLiteral aYears,
+    bool aValid)
+{
+    return ScheduleLiteral{
+        {
+            {
+                aMinutes.mBitRing,
+                aHours.mBitRing,
+                aDays.mBitRing,
+                aMonths.mBitRing,
+                aWeekDays.mBitRing,
+            },
+            aSeconds.mBitRing,
+            classifySchedule(
+                aHours.mBitRing.mRing,
+                aDays.mBitRing.mRing,
+                aMonths.mBitRing.mRing,
+                aWeekDays.mBitRing.mRing,
+                aYears.mBitRing.mRing),
+            aYears.mBitRing,
+            0,
+            0,
+            0,
+            {},
+        },
+        aValid &&
+        aSeconds.mValid &&
+        aYears.mValid &&
+        aMinutes.mValid &&
+        aHours.mValid &&
+        aDays.mValid &&
+        aMonths.mValid &&
+        aWeekDays.mValid,
+    };
+}
+
+/* The five crontab(5) fields are optionally preceded by a field for the
+ * seconds, which can in turn be followed by a field for the years. The
+ * crontab(5) fields are numbered from the first, and the last field
+ * must end the schedule.
+ */
+
+constexpr ScheduleLiteral
+parseScheduleFields(const char *aSchedule, unsigned aFirst, unsigned aLast)
+{
+    return parseSchedule(
+        aFirst
+            ? canonicalSeconds(parseScheduleField(aSchedule, 0, 0, 59))
+            : BitRingLiteral{ { 0, 0, 59 }, true },
+        parseScheduleField(aSchedule, aFirst + 0, 0, 59),
+        parseScheduleField(aSchedule, aFirst + 1, 0, 23),
+        parseScheduleField(aSchedule, aFirst + 2, 1, 31),
+        parseScheduleField(aSchedule, aFirst + 3, 1, 12),
+        foldWeekDays(
+            parseScheduleField(aSchedule, aFirst + 4, 0, DaysInWeek)),
+        6 == aLast
+            ? parseYearsField(
+                aSchedule,
+                beginField(aSchedule, aLast),
+                endField(aSchedule, aLast))
+            : everyYear(),
+        beginField(aSchedule, aLast) <= scanString(aSchedule) &&
+        !aSchedule[endField(aSchedule, aLast)]);
+}
+
+/* -------------------------------------------------------------------------- */
+template <bool Valid>
+constexpr struct BitRing
+checkBitRing(BitRingLiteral aBitRing)
+{
+    static_assert(Valid, "Invalid crontab field");
+    return aBitRing.mBitRing;
+}
+
+template <bool Valid>
+constexpr struct Schedule
+checkSchedule(ScheduleLiteral aSchedule)
+{
+    static_assert(Valid, "Invalid crontab schedule");
+    return aSchedule.mSchedule;
+}
+
+} // namespace literal_
+
+/* -------------------------------------------------------------------------- */
+constexpr BitRingLiteral
+parseBitRing(int aMin, int aMax, const char *aMembership)
+{
+    return literal_::parseBitRingField(
+        aMembership, 0, literal_::scanString(aMembership), aMin, aMax);
+}
+
+constexpr ScheduleLiteral
+parseSchedule(const char *aSchedule)
+{
+    return literal_::parseScheduleFields(
+        aSchedule,
+        literal_::beginField(aSchedule, 5) <= literal_::scanString(aSchedule)
+            ? 1 : 0,
+        literal_::beginField(aSchedule, 6) <= literal_::scanString(aSchedule)
+            ? 6
+            : literal_::beginField(aSchedule, 5) <=
+                    literal_::scanString(aSchedule)
+                ? 5 : 4);
+}
+
+/* -------------------------------------------------------------------------- */
+
+} // namespace crontime
+
+/* -------------------------------------------------------------------------- */
+#define CRONTIME_BITRING(aMin, aMax, aMembership)                       \
+    (::crontime::literal_::checkBitRing<                                \
+        ::crontime::parseBitRing((aMin), (aMax), (aMembership)).mValid>( \
+            ::crontime::parseBitRing((aMin), (aMax), (aMembership))))
+
+#define CRONTIME_SCHEDULE(aSchedule)                                    \
+    (::crontime::literal_::checkSchedule<                               \
+        ::crontime::parseSchedule((aSchedule)).mValid>(                 \
+            ::crontime::parseSchedule((aSchedule))))
+
+/* -------------------------------------------------------------------------- */
+
+#endif /* SCHEDULELITERAL_H */
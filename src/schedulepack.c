@@ -0,0 +1,247 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "schedulepack.h"
+
+#include "civiltime.h"
+#include "macros.h"
+
+#include <errno.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+enum {
+    SchedulePackWeekDayShift = 24,
+    SchedulePackShapeShift = 12,
+};
+
+static const uint32_t SchedulePackHours =
+    ((uint32_t) 1 << SchedulePackWeekDayShift) - 1;
+static const uint32_t SchedulePackMonths =
+    ((uint32_t) 1 << SchedulePackShapeShift) - 1;
+
+/* -------------------------------------------------------------------------- */
+static uint64_t
+querySchedulePackMinutes_(const struct SchedulePack *self)
+{
+    return (uint64_t) self->mMinutes[1] << 32 | self->mMinutes[0];
+}
+
+/* -------------------------------------------------------------------------- */
+struct SchedulePack *
+initSchedulePack(struct SchedulePack *self, const struct Schedule *aSchedule)
+{
+    int rc = -1;
+
+    const struct BitRing *rings = aSchedule->mSchedules;
+
+    /* There is no room for the month days, the seconds, the years, the
+     * validity window, or the excluded dates, so only schedules that
+     * select the start of each minute of every year can be packed.
+     */
+
+    if (queryBitRingPopulation(&aSchedule->mSeconds) ||
+            queryBitRingPopulation(&aSchedule->mYears) ||
+            aSchedule->mBegin || aSchedule->mEnd ||
+            aSchedule->mExclusion ||
+            queryScheduleMonthDaysPopulation(&aSchedule->mMonthDays)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    BitRingT minutes = rings[ScheduleMinutes].mRing;
+
+    self->mMinutes[0] = minutes;
+    self->mMinutes[1] = minutes >> 32;
+
+    self->mHours =
+        rings[ScheduleHours].mRing |
+        rings[ScheduleWeekDays].mRing << SchedulePackWeekDayShift;
+
+    self->mDays = rings[ScheduleDays].mRing;
+
+    self->mMonths =
+        rings[ScheduleMonths].mRing |
+        (uint32_t) aSchedule->mShape << SchedulePackShapeShift;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : self;
+}
+
+/* -------------------------------------------------------------------------- */
+struct Schedule *
+querySchedulePackSchedule(
+    const struct SchedulePack *self, struct Schedule *aSchedule)
+{
+    int rc = -1;
+
+    static const struct {
+        int mMin;
+        int mMax;
+    } Fields[ScheduleKinds] = {
+        [ScheduleMinutes]  = { 0, 59 },
+        [ScheduleHours]    = { 0, 23 },
+        [ScheduleDays]     = { 1, 31 },
+        [ScheduleMonths]   = { 1, 12 },
+        [ScheduleWeekDays] = { 0, DaysInWeek - 1 },
+    };
+
+    struct BitRing *rings = aSchedule->mSchedules;
+
+    for (unsigned kx = 0; kx < NUMBEROF(Fields); ++kx) {
+        if (!initBitRing(&rings[kx], Fields[kx].mMin, Fields[kx].mMax, 0))
+            goto Finally;
+    }
+
+    if (!initBitRing(&aSchedule->mSeconds, 0, 59, 0))
+        goto Finally;
+
+    if (!initBitRing(&aSchedule->mYears, 0, 0, 0))
+        goto Finally;
+
+    aSchedule->mBegin = 0;
+    aSchedule->mEnd = 0;
+
+    aSchedule->mExclusion = 0;
+
+    memset(&aSchedule->mMonthDays, 0, sizeof(aSchedule->mMonthDays));
+
+    rings[ScheduleMinutes].mRing = querySchedulePackMinutes_(self);
+    rings[ScheduleHours].mRing = self->mHours & SchedulePackHours;
+    rings[ScheduleDays].mRing = self->mDays;
+    rings[ScheduleMonths].mRing = self->mMonths & SchedulePackMonths;
+    rings[ScheduleWeekDays].mRing = self->mHours >> SchedulePackWeekDayShift;
+
+    aSchedule->mShape = self->mMonths >> SchedulePackShapeShift;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? 0 : aSchedule;
+}
+
+/* -------------------------------------------------------------------------- */
+time_t
+querySchedulePack(
+    const struct SchedulePack *self,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon,
+    time_t aJitterPeriod,
+    int *aJitter)
+{
+    int rc = -1;
+
+    /* The search is not performed on the packed rings. Instead, the
+     * schedule is reconstructed on the stack, which is cheap compared
+     * to the search, and the search computes the next scheduled time.
+     * The packed form saves storage, not search time.
+     */
+
+    struct Schedule schedule;
+
+    if (!querySchedulePackSchedule(self, &schedule))
+        goto Finally;
+
+    time_t scheduled = querySchedule(
+        &schedule, aCivilTime, aHorizon, aJitterPeriod, aJitter);
+    if (-1 == scheduled)
+        goto Finally;
+
+    rc = 0;
+
+Finally:
+
+    return rc ? -1 : scheduled;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+matchSchedulePackRing_(uint64_t aRing, int aMember)
+{
+    /* Fields masked by a daylight savings change are negative, and only
+     * match a wildcard.
+     */
+
+    return !aRing || (aMember >= 0 && aMember < 64 && (aRing >> aMember & 1));
+}
+
+static int
+matchSchedulePackTime_(
+    const struct SchedulePack *self,
+    struct Calendar aCalendar,
+    struct Clock aClock)
+{
+    uint32_t days = self->mDays;
+    uint32_t weekDays = self->mHours >> SchedulePackWeekDayShift;
+
+    /* If either the days of the week, or the days of the month, are
+     * constrained, the day matches if it is selected by either. Packed
+     * schedules have no seconds, so only match the start of each minute.
+     */
+
+    int matchDay =
+        (!days && !weekDays) ||
+        (weekDays && matchSchedulePackRing_(weekDays, aCalendar.mWeekDay)) ||
+        (days && matchSchedulePackRing_(days, aCalendar.mDay - 1));
+
+    return
+        0 == aClock.mSecond &&
+        matchDay &&
+        matchSchedulePackRing_(
+            self->mMonths & SchedulePackMonths, aCalendar.mMonth - 1) &&
+        matchSchedulePackRing_(
+            self->mHours & SchedulePackHours, aClock.mHour) &&
+        matchSchedulePackRing_(
+            querySchedulePackMinutes_(self), aClock.mMinute);
+}
+
+int
+matchSchedulePack(
+    const struct SchedulePack *self, const struct CivilTime *aCivilTime)
+{
+    /* As for matchSchedule(), in the period skipped by a daylight savings
+     * change, the schedule matches either the artificial time or the
+     * local time that actually applies.
+     */
+
+    struct Calendar calendar;
+    struct Clock clock;
+
+    return
+        matchSchedulePackTime_(
+            self,
+            queryCivilTimeCalendar(aCivilTime),
+            queryCivilTimeClock(aCivilTime)) ||
+        (1 == queryCivilTimeArtificial(aCivilTime, &calendar, &clock) &&
+         matchSchedulePackTime_(self, calendar, clock));
+}
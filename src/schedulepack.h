@@ -0,0 +1,83 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCHEDULEPACK_H
+#define SCHEDULEPACK_H
+
+#include "schedule.h"
+
+#include "compiler.h"
+
+#include <inttypes.h>
+
+/* -------------------------------------------------------------------------- */
+BEGIN_C_SCOPE;
+
+/* A packed schedule holds the rings of a schedule without the bounds
+ * that are fixed for each field. The 134 bits of the rings do not fit
+ * in two words, so the rings are packed into five 32-bit words. As in
+ * struct BitRing, an empty ring is a wildcard.
+ *
+ * The packed form reduces storage only. querySchedulePack() unpacks
+ * the schedule and searches that, so it is no faster than
+ * querySchedule(). matchSchedulePack() uses the packed rings directly.
+ */
+
+struct SchedulePack
+{
+    uint32_t mMinutes[2]; /* Minutes 0-31, and 32-59 */
+    uint32_t mHours;      /* Hours 0-23, and weekdays 0-6 from bit 24 */
+    uint32_t mDays;       /* Days 1-31 */
+    uint32_t mMonths;     /* Months 1-12, and shape from bit 12 */
+};
+
+/* -------------------------------------------------------------------------- */
+struct SchedulePack *
+initSchedulePack(struct SchedulePack *self, const struct Schedule *aSchedule);
+
+struct Schedule *
+querySchedulePackSchedule(
+    const struct SchedulePack *self, struct Schedule *aSchedule);
+
+/* -------------------------------------------------------------------------- */
+time_t
+querySchedulePack(
+    const struct SchedulePack *self,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon,
+    time_t aJitterPeriod,
+    int *aJitter);
+
+int
+matchSchedulePack(
+    const struct SchedulePack *self, const struct CivilTime *aCivilTime);
+
+/* -------------------------------------------------------------------------- */
+END_C_SCOPE;
+
+#endif /* SCHEDULEPACK_H */
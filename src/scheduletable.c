@@ -0,0 +1,1017 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "scheduletable.h"
+
+#include "civiltime.h"
+#include "macros.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCHEDULETABLE_AVX2
+#include <immintrin.h>
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* The rings of each field are stored in columns, with the bit for each
+ * value offset by the minimum value of the field as in struct BitRing. An
+ * empty ring is a wildcard.
+ */
+
+static const BitRingT AllMinutes = ((BitRingT) 1 << 60) - 1;
+static const uint32_t AllHours = ((uint32_t) 1 << 24) - 1;
+static const uint32_t AllDays = ((uint32_t) 1 << 31) - 1;
+static const uint32_t AllMonths = ((uint32_t) 1 << 12) - 1;
+
+enum {
+    MaxCalendarDays = 366,
+    GregorianCycleDays = 146097,
+};
+
+/* Each day of the window holds the bits that select it in the rings
+ * of the months, the days of the month, and the days of the week, and
+ * the index of the first day of the following month in the window.
+ */
+
+struct CalendarDay
+{
+    uint32_t mMonth;
+    uint32_t mDay;
+    uint32_t mWeekDay;
+    int mNextMonth;
+};
+
+struct ScheduleTableRings
+{
+    BitRingT mMinutes;
+    uint32_t mHours;
+    uint32_t mDays;
+    uint32_t mMonths;
+    uint32_t mWeekDays;
+};
+
+struct ScheduleTableWindow
+{
+    time_t mSince;
+    time_t mTransition;
+
+    struct Clock mWallClock;
+
+    int mDays;
+    struct CalendarDay mCalendarDays[MaxCalendarDays];
+};
+
+/* -------------------------------------------------------------------------- */
+static int
+daysInMonth_(int aYear, int aMonth)
+{
+    static const int MonthDays[] = {
+        31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31,
+    };
+
+    int leapYear =
+        ! (aYear % 4) && (aYear % 100 || ! (aYear % 400));
+
+    return MonthDays[aMonth - 1] + (2 == aMonth && leapYear);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+growScheduleTable_(struct ScheduleTable *self)
+{
+    int rc = -1;
+
+    size_t size = self->mSize ? 2 * self->mSize : 64;
+
+    /* Place the widest columns first so that each column is aligned. */
+
+    size_t columnSize =
+        sizeof(*self->mMinutes) +
+        sizeof(*self->mHours) +
+        sizeof(*self->mDays) +
+        sizeof(*self->mMonths) +
+        sizeof(*self->mWeekDays) +
+        sizeof(*self->mShapes);
+
+    char *arena = malloc(size * columnSize);
+    if (!arena)
+        goto Finally;
+
+    struct ScheduleTable table = {
+        .mArena = arena,
+        .mLength = self->mLength,
+        .mSize = size,
+        .mKernel = self->mKernel,
+    };
+
+    table.mMinutes = (void *) arena;
+    table.mHours = (void *) (table.mMinutes + size);
+    table.mDays = (void *) (table.mHours + size);
+    table.mMonths = (void *) (table.mDays + size);
+    table.mWeekDays = (void *) (table.mMonths + size);
+    table.mShapes = (void *) (table.mWeekDays + size);
+
+    if (self->mLength) {
+        size_t length = self->mLength;
+
+        memcpy(
+            table.mMinutes, self->mMinutes, length * sizeof(*self->mMinutes));
+        memcpy(table.mHours, self->mHours, length * sizeof(*self->mHours));
+        memcpy(table.mDays, self->mDays, length * sizeof(*self->mDays));
+        memcpy(table.mMonths, self->mMonths, length * sizeof(*self->mMonths));
+        memcpy(
+            table.mWeekDays,
+            self->mWeekDays,
+            length * sizeof(*self->mWeekDays));
+        memcpy(table.mShapes, self->mShapes, length * sizeof(*self->mShapes));
+    }
+
+    free(self->mArena);
+
+    *self = table;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+queryScheduleTableEntry_(
+    const struct ScheduleTable *self,
+    size_t aEntry,
+    const struct CivilTime *aCivilTime,
+    time_t aHorizon,
+    time_t *aScheduled)
+{
+    int rc = -1;
+
+    /* Reconstruct the schedule from the columns, and use the search to
+     * compute the next scheduled time.
+     */
+
+    struct Schedule schedule;
+
+    static const struct {
+        int mMin;
+        int mMax;
+    } Fields[ScheduleKinds] = {
+        [ScheduleMinutes]  = { 0, 59 },
+        [ScheduleHours]    = { 0, 23 },
+        [ScheduleDays]     = { 1, 31 },
+        [ScheduleMonths]   = { 1, 12 },
+        [ScheduleWeekDays] = { 0, DaysInWeek - 1 },
+    };
+
+    for (unsigned kx = 0; kx < NUMBEROF(Fields); ++kx) {
+        if (!initBitRing(
+                &schedule.mSchedules[kx], Fields[kx].mMin, Fields[kx].mMax, 0))
+            goto Finally;
+    }
+
+    if (!initBitRing(&schedule.mSeconds, 0, 59, 0))
+        goto Finally;
+
+    if (!initBitRing(&schedule.mYears, 0, 0, 0))
+        goto Finally;
+
+    schedule.mBegin = 0;
+    schedule.mEnd = 0;
+
+    schedule.mExclusion = 0;
+
+    memset(&schedule.mMonthDays, 0, sizeof(schedule.mMonthDays));
+
+    schedule.mSchedules[ScheduleMinutes].mRing = self->mMinutes[aEntry];
+    schedule.mSchedules[ScheduleHours].mRing = self->mHours[aEntry];
+    schedule.mSchedules[ScheduleDays].mRing = self->mDays[aEntry];
+    schedule.mSchedules[ScheduleMonths].mRing = self->mMonths[aEntry];
+    schedule.mSchedules[ScheduleWeekDays].mRing = self->mWeekDays[aEntry];
+    schedule.mShape = self->mShapes[aEntry];
+
+    time_t scheduled = querySchedule(&schedule, aCivilTime, aHorizon, 0, 0);
+    if (-1 == scheduled)
+        goto Finally;
+
+    *aScheduled = scheduled;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+supportScheduleTableKernel_(enum ScheduleTableKernel aKernel)
+{
+    int supported = 0;
+
+    switch (aKernel) {
+    case ScheduleTableKernelScalar:
+        supported = 1;
+        break;
+
+    case ScheduleTableKernelAvx2:
+#ifdef SCHEDULETABLE_AVX2
+        supported = !! __builtin_cpu_supports("avx2");
+#endif
+        break;
+    }
+
+    return supported;
+}
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleTable *
+initScheduleTable(struct ScheduleTable *self)
+{
+    *self = (struct ScheduleTable) {
+        .mArena = 0,
+        .mLength = 0,
+        .mSize = 0,
+        .mKernel = ScheduleTableKernelScalar,
+    };
+
+    if (supportScheduleTableKernel_(ScheduleTableKernelAvx2))
+        self->mKernel = ScheduleTableKernelAvx2;
+
+    return self;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+closeScheduleTable(struct ScheduleTable *self)
+{
+    free(self->mArena);
+
+    initScheduleTable(self);
+}
+
+/* -------------------------------------------------------------------------- */
+int
+selectScheduleTableKernel(
+    struct ScheduleTable *self, enum ScheduleTableKernel aKernel)
+{
+    int rc = -1;
+
+    if (!supportScheduleTableKernel_(aKernel)) {
+        errno = ENOTSUP;
+        goto Finally;
+    }
+
+    self->mKernel = aKernel;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+addScheduleTableEntry(
+    struct ScheduleTable *self, const struct Schedule *aSchedule)
+{
+    int rc = -1;
+
+    /* The columns have no room for the month days, the seconds, the
+     * years, the validity window, or the excluded dates, so only schedules
+     * that select the start of each minute of every year can be added.
+     */
+
+    if (queryBitRingPopulation(&aSchedule->mSeconds) ||
+            queryBitRingPopulation(&aSchedule->mYears) ||
+            aSchedule->mBegin || aSchedule->mEnd ||
+            aSchedule->mExclusion ||
+            queryScheduleMonthDaysPopulation(&aSchedule->mMonthDays)) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    if (self->mLength == self->mSize) {
+        if (growScheduleTable_(self))
+            goto Finally;
+    }
+
+    size_t entry = self->mLength++;
+
+    self->mMinutes[entry] = aSchedule->mSchedules[ScheduleMinutes].mRing;
+    self->mHours[entry] = aSchedule->mSchedules[ScheduleHours].mRing;
+    self->mDays[entry] = aSchedule->mSchedules[ScheduleDays].mRing;
+    self->mMonths[entry] = aSchedule->mSchedules[ScheduleMonths].mRing;
+    self->mWeekDays[entry] = aSchedule->mSchedules[ScheduleWeekDays].mRing;
+    self->mShapes[entry] = aSchedule->mShape;
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static void
+initScheduleTableWindow_(
+    struct ScheduleTableWindow *self, const struct CivilTime *aCivilTime)
+{
+    struct Calendar wallCalendar = queryCivilTimeWallCalendar(aCivilTime);
+
+    self->mSince = queryCivilTimeUtc(aCivilTime);
+    self->mTransition = queryCivilTimeTransition(aCivilTime);
+    self->mWallClock = queryCivilTimeWallClock(aCivilTime);
+
+    /* The schedules in the table only select the start of each minute,
+     * so a civil time part way through a minute is first scheduled at
+     * the start of the next minute, which might lie on the next day.
+     */
+
+    int nextDay = 0;
+
+    if (self->mWallClock.mSecond) {
+        self->mSince += 60 - self->mWallClock.mSecond;
+        self->mWallClock.mSecond = 0;
+
+        if (60 == ++self->mWallClock.mMinute) {
+            self->mWallClock.mMinute = 0;
+            if (24 == ++self->mWallClock.mHour) {
+                self->mWallClock.mHour = 0;
+                nextDay = 1;
+            }
+        }
+    }
+
+    /* While there is no daylight savings change, local time advances in
+     * step with UTC, so the calendar of each day up to the transition is
+     * shared by all schedules.
+     */
+
+    self->mDays = 0;
+
+    if (self->mSince < self->mTransition) {
+
+        time_t minutes =
+            (self->mTransition - self->mSince) / 60 +
+            self->mWallClock.mHour * 60 + self->mWallClock.mMinute;
+
+        self->mDays = MaxCalendarDays;
+        if (minutes / (24 * 60) < self->mDays)
+            self->mDays = minutes / (24 * 60) + 1;
+    }
+
+    int year = wallCalendar.mYear;
+    int month = wallCalendar.mMonth;
+    int day = wallCalendar.mDay;
+    int weekDay = wallCalendar.mWeekDay;
+
+    for (int dx = -nextDay; dx < self->mDays; ++dx) {
+
+        if (0 <= dx) {
+            self->mCalendarDays[dx] = (struct CalendarDay) {
+                .mMonth = (uint32_t) 1 << (month - 1),
+                .mDay = (uint32_t) 1 << (day - 1),
+                .mWeekDay = (uint32_t) 1 << weekDay,
+            };
+        }
+
+        weekDay = (weekDay + 1) % DaysInWeek;
+
+        if (++day > daysInMonth_(year, month)) {
+            day = 1;
+            if (++month > 12) {
+                month = 1;
+                ++year;
+            }
+        }
+    }
+
+    /* Link each day to the first day of the following month, which
+     * is found from the bit of the first day of the month.
+     */
+
+    for (int dx = self->mDays, nextMonth = dx; dx--; ) {
+        self->mCalendarDays[dx].mNextMonth = nextMonth;
+        if (1 == self->mCalendarDays[dx].mDay)
+            nextMonth = dx;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+static struct ScheduleTableRings
+queryScheduleTableRings_(const struct ScheduleTable *self, size_t aEntry)
+{
+    /* Replace each wildcard by a ring of every value so that the rings
+     * can be tested without considering wildcards. If neither the days
+     * of the month, nor the days of the week, are constrained, every
+     * day of the month is selected.
+     */
+
+    struct ScheduleTableRings rings = {
+        .mMinutes = self->mMinutes[aEntry],
+        .mHours = self->mHours[aEntry],
+        .mDays = self->mDays[aEntry],
+        .mMonths = self->mMonths[aEntry],
+        .mWeekDays = self->mWeekDays[aEntry],
+    };
+
+    if (!rings.mMinutes)
+        rings.mMinutes = AllMinutes;
+    if (!rings.mHours)
+        rings.mHours = AllHours;
+    if (!rings.mMonths)
+        rings.mMonths = AllMonths;
+    if (!rings.mDays && !rings.mWeekDays)
+        rings.mDays = AllDays;
+
+    return rings;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+matchScheduleTableDay_(
+    const struct ScheduleTableRings *aRings,
+    const struct CalendarDay *aCalendarDay)
+{
+    return
+        (aRings->mMonths & aCalendarDay->mMonth) &&
+        ((aRings->mDays & aCalendarDay->mDay) ||
+         (aRings->mWeekDays & aCalendarDay->mWeekDay));
+}
+
+/* -------------------------------------------------------------------------- */
+static long
+queryScheduleTableElapsed_(
+    const struct ScheduleTableRings *aRings,
+    const struct Clock *aWallClock,
+    int aDay)
+{
+    /* Find the first matching hour and minute on a matching day of the
+     * window, and return the minutes elapsed since the wall clock. Only
+     * the first day of the window might have no hour and minute left.
+     */
+
+    long elapsed = -1;
+
+    int firstHour = aDay ? 0 : aWallClock->mHour;
+
+    for (uint32_t hours = aRings->mHours & ~(((uint32_t) 1 << firstHour) - 1);
+            hours;
+            hours &= hours - 1) {
+
+        int hour = __builtin_ctz(hours);
+
+        int firstMinute =
+            aDay || hour != aWallClock->mHour ? 0 : aWallClock->mMinute;
+
+        BitRingT minutes =
+            aRings->mMinutes & ~(((BitRingT) 1 << firstMinute) - 1);
+
+        if (minutes) {
+            int minute = __builtin_ctzll(minutes);
+
+            elapsed =
+                (aDay * 24L + hour - aWallClock->mHour) * 60 +
+                minute - aWallClock->mMinute;
+            break;
+        }
+    }
+
+    return elapsed;
+}
+
+/* -------------------------------------------------------------------------- */
+static time_t
+queryScheduleTableWindowTime_(
+    const struct ScheduleTableWindow *aWindow, long aElapsed)
+{
+    /* The result is only valid if it precedes the transition. */
+
+    time_t scheduled = aWindow->mSince + aElapsed * 60;
+
+    return -1 == aElapsed || scheduled >= aWindow->mTransition ? -1 : scheduled;
+}
+
+/* -------------------------------------------------------------------------- */
+static time_t
+queryScheduleTableWindowScalar_(
+    const struct ScheduleTable *self,
+    size_t aEntry,
+    const struct ScheduleTableWindow *aWindow)
+{
+    struct ScheduleTableRings rings = queryScheduleTableRings_(self, aEntry);
+
+    /* Find the first matching day, then the first matching hour and
+     * minute on that day.
+     */
+
+    long elapsed = -1;
+
+    for (int dx = 0; -1 == elapsed && dx < aWindow->mDays; ++dx) {
+
+        if (matchScheduleTableDay_(&rings, &aWindow->mCalendarDays[dx]))
+            elapsed = queryScheduleTableElapsed_(
+                &rings, &aWindow->mWallClock, dx);
+    }
+
+    return queryScheduleTableWindowTime_(aWindow, elapsed);
+}
+
+/* -------------------------------------------------------------------------- */
+#ifdef SCHEDULETABLE_AVX2
+enum {
+    ScheduleTableAvx2Lanes = 8,
+};
+
+__attribute__((__target__("avx2")))
+static __inline__ __m256i
+ctzScheduleTableAvx2_(__m256i aBits)
+{
+    /* There is no instruction to count trailing zeros in each lane, so
+     * isolate the lowest bit, and use the exponent of its conversion to
+     * floating point. The result is negative for an empty lane.
+     */
+
+    __m256i lowest = _mm256_and_si256(
+        aBits, _mm256_sub_epi32(_mm256_setzero_si256(), aBits));
+
+    __m256i exponent = _mm256_and_si256(
+        _mm256_srli_epi32(
+            _mm256_castps_si256(_mm256_cvtepi32_ps(lowest)), 23),
+        _mm256_set1_epi32(0xff));
+
+    return _mm256_sub_epi32(exponent, _mm256_set1_epi32(127));
+}
+
+__attribute__((__target__("avx2")))
+static __inline__ __m256i
+ctz64ScheduleTableAvx2_(__m256i aLow, __m256i aHigh)
+{
+    return _mm256_blendv_epi8(
+        ctzScheduleTableAvx2_(aLow),
+        _mm256_add_epi32(ctzScheduleTableAvx2_(aHigh), _mm256_set1_epi32(32)),
+        _mm256_cmpeq_epi32(aLow, _mm256_setzero_si256()));
+}
+
+__attribute__((__target__("avx2")))
+static void
+queryScheduleTableWindowAvx2_(
+    const struct ScheduleTable *self,
+    size_t aEntry,
+    const struct ScheduleTableWindow *aWindow,
+    time_t *aScheduled)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_cmpeq_epi32(zero, zero);
+
+    int wallHour = aWindow->mWallClock.mHour;
+    int wallMinute = aWindow->mWallClock.mMinute;
+
+    /* Load the columns of eight entries, replacing wildcards as described
+     * for queryScheduleTableRings_(). The minutes are split into their
+     * low and high words so that each lane holds one entry.
+     */
+
+    __m256i hours = _mm256_loadu_si256(
+        (const __m256i *) (self->mHours + aEntry));
+    __m256i days = _mm256_loadu_si256(
+        (const __m256i *) (self->mDays + aEntry));
+    __m256i months = _mm256_cvtepu16_epi32(_mm_loadu_si128(
+        (const __m128i *) (self->mMonths + aEntry)));
+    __m256i weekDays = _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+        (const __m128i *) (self->mWeekDays + aEntry)));
+
+    __m256 minutes0 = _mm256_castsi256_ps(_mm256_loadu_si256(
+        (const __m256i *) (self->mMinutes + aEntry)));
+    __m256 minutes1 = _mm256_castsi256_ps(_mm256_loadu_si256(
+        (const __m256i *) (self->mMinutes + aEntry + 4)));
+
+    __m256i lowMinutes = _mm256_permute4x64_epi64(
+        _mm256_castps_si256(_mm256_shuffle_ps(
+            minutes0, minutes1, _MM_SHUFFLE(2, 0, 2, 0))),
+        _MM_SHUFFLE(3, 1, 2, 0));
+    __m256i highMinutes = _mm256_permute4x64_epi64(
+        _mm256_castps_si256(_mm256_shuffle_ps(
+            minutes0, minutes1, _MM_SHUFFLE(3, 1, 3, 1))),
+        _MM_SHUFFLE(3, 1, 2, 0));
+
+    __m256i anyMinute = _mm256_cmpeq_epi32(
+        _mm256_or_si256(lowMinutes, highMinutes), zero);
+
+    lowMinutes = _mm256_or_si256(lowMinutes, _mm256_and_si256(
+        anyMinute, _mm256_set1_epi32((uint32_t) AllMinutes)));
+    highMinutes = _mm256_or_si256(highMinutes, _mm256_and_si256(
+        anyMinute, _mm256_set1_epi32((uint32_t) (AllMinutes >> 32))));
+
+    hours = _mm256_or_si256(hours, _mm256_and_si256(
+        _mm256_cmpeq_epi32(hours, zero), _mm256_set1_epi32(AllHours)));
+    months = _mm256_or_si256(months, _mm256_and_si256(
+        _mm256_cmpeq_epi32(months, zero), _mm256_set1_epi32(AllMonths)));
+    days = _mm256_or_si256(days, _mm256_and_si256(
+        _mm256_cmpeq_epi32(_mm256_or_si256(days, weekDays), zero),
+        _mm256_set1_epi32(AllDays)));
+
+    /* On the first day of the window, an entry either runs later in the
+     * hour of the wall clock, or in a later hour. If it does neither,
+     * it cannot run on the first day.
+     */
+
+    BitRingT laterMinuteMask = ~(((BitRingT) 1 << wallMinute) - 1);
+
+    __m256i laterLowMinutes = _mm256_and_si256(
+        lowMinutes, _mm256_set1_epi32((uint32_t) laterMinuteMask));
+    __m256i laterHighMinutes = _mm256_and_si256(
+        highMinutes, _mm256_set1_epi32((uint32_t) (laterMinuteMask >> 32)));
+
+    __m256i laterHours = _mm256_and_si256(
+        hours, _mm256_set1_epi32(~(((uint32_t) 2 << wallHour) - 1)));
+
+    __m256i sameHour = _mm256_andnot_si256(
+        _mm256_or_si256(
+            _mm256_cmpeq_epi32(
+                _mm256_and_si256(
+                    hours, _mm256_set1_epi32((uint32_t) 1 << wallHour)),
+                zero),
+            _mm256_cmpeq_epi32(
+                _mm256_or_si256(laterLowMinutes, laterHighMinutes), zero)),
+        ones);
+
+    __m256i firstDayMissing = _mm256_andnot_si256(
+        sameHour, _mm256_cmpeq_epi32(laterHours, zero));
+
+    /* Scan the days of the window for the first matching day of each
+     * entry, skipping the remainder of a month that no entry still
+     * missing a day can match.
+     */
+
+    __m256i firstDay = zero;
+    __m256i missing = ones;
+
+    for (int dx = 0; dx < aWindow->mDays; ) {
+
+        const struct CalendarDay *calendarDay = &aWindow->mCalendarDays[dx];
+
+        __m256i wanted = _mm256_andnot_si256(
+            _mm256_cmpeq_epi32(
+                _mm256_and_si256(
+                    months, _mm256_set1_epi32(calendarDay->mMonth)),
+                zero),
+            missing);
+
+        if (!dx)
+            wanted = _mm256_andnot_si256(firstDayMissing, wanted);
+
+        if (_mm256_testz_si256(wanted, wanted)) {
+            dx = dx ? calendarDay->mNextMonth : dx + 1;
+            continue;
+        }
+
+        __m256i day = _mm256_or_si256(
+            _mm256_and_si256(days, _mm256_set1_epi32(calendarDay->mDay)),
+            _mm256_and_si256(
+                weekDays, _mm256_set1_epi32(calendarDay->mWeekDay)));
+
+        __m256i match = _mm256_andnot_si256(
+            _mm256_cmpeq_epi32(day, zero), wanted);
+
+        firstDay = _mm256_blendv_epi8(firstDay, _mm256_set1_epi32(dx), match);
+
+        missing = _mm256_andnot_si256(match, missing);
+
+        if (_mm256_testz_si256(missing, missing))
+            break;
+
+        ++dx;
+    }
+
+    /* Run at the first matching hour and minute of the matching day,
+     * taking care to run no earlier than the wall clock on the first
+     * day of the window.
+     */
+
+    __m256i onFirstDay = _mm256_cmpeq_epi32(firstDay, zero);
+    __m256i inSameHour = _mm256_and_si256(onFirstDay, sameHour);
+
+    __m256i hour = _mm256_blendv_epi8(
+        ctzScheduleTableAvx2_(hours),
+        ctzScheduleTableAvx2_(laterHours),
+        onFirstDay);
+    hour = _mm256_blendv_epi8(hour, _mm256_set1_epi32(wallHour), inSameHour);
+
+    __m256i minute = _mm256_blendv_epi8(
+        ctz64ScheduleTableAvx2_(lowMinutes, highMinutes),
+        ctz64ScheduleTableAvx2_(laterLowMinutes, laterHighMinutes),
+        inSameHour);
+
+    __m256i elapsed = _mm256_add_epi32(
+        _mm256_mullo_epi32(
+            _mm256_add_epi32(
+                _mm256_mullo_epi32(firstDay, _mm256_set1_epi32(24)),
+                _mm256_sub_epi32(hour, _mm256_set1_epi32(wallHour))),
+            _mm256_set1_epi32(60)),
+        _mm256_sub_epi32(minute, _mm256_set1_epi32(wallMinute)));
+
+    elapsed = _mm256_or_si256(elapsed, missing);
+
+    int elapsedMinutes[ScheduleTableAvx2Lanes];
+
+    _mm256_storeu_si256((__m256i *) elapsedMinutes, elapsed);
+
+    for (unsigned lx = 0; lx < ScheduleTableAvx2Lanes; ++lx)
+        aScheduled[lx] = queryScheduleTableWindowTime_(
+            aWindow, elapsedMinutes[lx]);
+}
+#endif
+
+/* -------------------------------------------------------------------------- */
+static void
+queryScheduleTableWindow_(
+    const struct ScheduleTable *self,
+    size_t aEntry,
+    size_t aLength,
+    const struct ScheduleTableWindow *aWindow,
+    time_t *aScheduled)
+{
+    /* Compute the scheduled times of a run of entries, or -1 for those
+     * entries that are not scheduled within the window.
+     */
+
+    size_t ex = 0;
+
+#ifdef SCHEDULETABLE_AVX2
+    if (ScheduleTableKernelAvx2 == self->mKernel) {
+        for ( ; ex + ScheduleTableAvx2Lanes <= aLength;
+                ex += ScheduleTableAvx2Lanes)
+            queryScheduleTableWindowAvx2_(
+                self, aEntry + ex, aWindow, aScheduled + ex);
+    }
+#endif
+
+    for ( ; ex < aLength; ++ex)
+        aScheduled[ex] = queryScheduleTableWindowScalar_(
+            self, aEntry + ex, aWindow);
+}
+
+/* -------------------------------------------------------------------------- */
+int
+queryScheduleTable(
+    const struct ScheduleTable *self,
+    const struct CivilTime *aCivilTime,
+    time_t *aScheduled)
+{
+    int rc = -1;
+
+    /* Compute the next scheduled time of each schedule directly from
+     * the columns, and only search for those schedules that are not
+     * scheduled before the transition.
+     */
+
+    struct ScheduleTableWindow window;
+
+    initScheduleTableWindow_(&window, aCivilTime);
+
+    queryScheduleTableWindow_(self, 0, self->mLength, &window, aScheduled);
+
+    for (size_t ex = 0; ex < self->mLength; ++ex) {
+
+        if (-1 == aScheduled[ex]) {
+            if (queryScheduleTableEntry_(
+                    self, ex, aCivilTime, 0, &aScheduled[ex]))
+                goto Finally;
+        }
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+compareScheduleTableFire_(
+    const struct ScheduleTableFire *aLhs, const struct ScheduleTableFire *aRhs)
+{
+    return
+        aLhs->mScheduled != aRhs->mScheduled
+            ? (aLhs->mScheduled < aRhs->mScheduled ? -1 : +1)
+            : (aLhs->mEntry != aRhs->mEntry
+                ? (aLhs->mEntry < aRhs->mEntry ? -1 : +1)
+                : 0);
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+sortScheduleTableFire_(const void *aLhs, const void *aRhs)
+{
+    return compareScheduleTableFire_(aLhs, aRhs);
+}
+
+/* -------------------------------------------------------------------------- */
+static size_t
+offerScheduleTableFire_(
+    struct ScheduleTableFire *aFires,
+    size_t aLength,
+    size_t aCount,
+    struct ScheduleTableFire aFire)
+{
+    /* Keep the earliest fires in a heap with the latest at the root, so
+     * that the latest is replaced when an earlier fire is found.
+     */
+
+    size_t ix;
+
+    if (aLength < aCount) {
+
+        for (ix = aLength++; ix; ) {
+            size_t parent = (ix - 1) / 2;
+
+            if (0 <= compareScheduleTableFire_(&aFires[parent], &aFire))
+                break;
+
+            aFires[ix] = aFires[parent];
+            ix = parent;
+        }
+
+    } else {
+
+        if (0 <= compareScheduleTableFire_(&aFire, &aFires[0]))
+            return aLength;
+
+        for (ix = 0; ; ) {
+            size_t child = 2 * ix + 1;
+
+            if (child >= aLength)
+                break;
+
+            if (child + 1 < aLength && 0 > compareScheduleTableFire_(
+                    &aFires[child], &aFires[child + 1]))
+                ++child;
+
+            if (0 <= compareScheduleTableFire_(&aFire, &aFires[child]))
+                break;
+
+            aFires[ix] = aFires[child];
+            ix = child;
+        }
+    }
+
+    aFires[ix] = aFire;
+
+    return aLength;
+}
+
+/* -------------------------------------------------------------------------- */
+ssize_t
+queryScheduleTableEarliest(
+    const struct ScheduleTable *self,
+    const struct CivilTime *aCivilTime,
+    struct ScheduleTableFire *aFires,
+    size_t aCount)
+{
+    int rc = -1;
+
+    size_t length = 0;
+
+    size_t *deferred = 0;
+    size_t deferredLength = 0;
+
+    if (!aCount) {
+        rc = 0;
+        goto Finally;
+    }
+
+    deferred = malloc((self->mLength ? self->mLength : 1) * sizeof(*deferred));
+    if (!deferred)
+        goto Finally;
+
+    /* Most schedules are scheduled before the next daylight savings
+     * change, and their scheduled times are computed directly from the
+     * columns. The remaining schedules are not scheduled before the
+     * end of the window, which bounds their scheduled times from below,
+     * so they are only searched if they might displace an earlier fire.
+     */
+
+    struct ScheduleTableWindow window;
+
+    initScheduleTableWindow_(&window, aCivilTime);
+
+    time_t runScheduled[64];
+
+    for (size_t ex = 0; ex < self->mLength; ex += NUMBEROF(runScheduled)) {
+
+        size_t run = self->mLength - ex;
+
+        if (run > NUMBEROF(runScheduled))
+            run = NUMBEROF(runScheduled);
+
+        queryScheduleTableWindow_(self, ex, run, &window, runScheduled);
+
+        for (size_t rx = 0; rx < run; ++rx) {
+
+            if (-1 == runScheduled[rx]) {
+                deferred[deferredLength++] = ex + rx;
+            } else {
+                struct ScheduleTableFire fire = {
+                    .mEntry = ex + rx,
+                    .mScheduled = runScheduled[rx],
+                };
+
+                length = offerScheduleTableFire_(aFires, length, aCount, fire);
+            }
+        }
+    }
+
+    time_t bound = window.mSince;
+
+    if (window.mDays) {
+        bound += 60 * (
+            window.mDays * 24L * 60 -
+            window.mWallClock.mHour * 60 - window.mWallClock.mMinute);
+
+        if (bound > window.mTransition)
+            bound = window.mTransition;
+    }
+
+    for (size_t dx = 0; dx < deferredLength; ++dx) {
+
+        /* Schedules that do not occur within a Gregorian cycle never
+         * occur, so search no further than that.
+         */
+
+        time_t horizon = GregorianCycleDays * 24L * 60 * 60;
+
+        if (length == aCount) {
+            struct ScheduleTableFire fire = {
+                .mEntry = deferred[dx],
+                .mScheduled = bound,
+            };
+
+            if (0 <= compareScheduleTableFire_(&fire, &aFires[0]))
+                break;
+
+            horizon = aFires[0].mScheduled - window.mSince;
+            if (!horizon)
+                horizon = 1;
+        }
+
+        time_t scheduled;
+
+        if (queryScheduleTableEntry_(
+                self, deferred[dx], aCivilTime, horizon, &scheduled)) {
+            if (ENOENT != errno)
+                goto Finally;
+            continue;
+        }
+
+        struct ScheduleTableFire fire = {
+            .mEntry = deferred[dx],
+            .mScheduled = scheduled,
+        };
+
+        length = offerScheduleTableFire_(aFires, length, aCount, fire);
+    }
+
+    qsort(aFires, length, sizeof(*aFires), sortScheduleTableFire_);
+
+    rc = 0;
+
+Finally:
+
+    free(deferred);
+
+    return rc ? -1 : length;
+}
@@ -0,0 +1,111 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef SCHEDULETABLE_H
+#define SCHEDULETABLE_H
+
+#include "schedule.h"
+
+#include "compiler.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* -------------------------------------------------------------------------- */
+BEGIN_C_SCOPE;
+
+/* The scheduled times of the entries are computed by a kernel that
+ * either considers each entry in turn, or uses AVX2 to consider eight
+ * entries at once. The AVX2 kernel is used by default wherever it is
+ * supported.
+ */
+
+enum ScheduleTableKernel
+{
+    ScheduleTableKernelScalar,
+    ScheduleTableKernelAvx2,
+};
+
+struct ScheduleTable
+{
+    void *mArena;
+    size_t mLength;
+    size_t mSize;
+
+    enum ScheduleTableKernel mKernel;
+
+    BitRingT *mMinutes;
+    uint32_t *mHours;
+    uint32_t *mDays;
+    uint16_t *mMonths;
+    uint8_t *mWeekDays;
+    uint8_t *mShapes;
+};
+
+struct ScheduleTableFire
+{
+    size_t mEntry;
+    time_t mScheduled;
+};
+
+/* -------------------------------------------------------------------------- */
+struct ScheduleTable *
+initScheduleTable(struct ScheduleTable *self);
+
+void
+closeScheduleTable(struct ScheduleTable *self);
+
+/* -------------------------------------------------------------------------- */
+int
+selectScheduleTableKernel(
+    struct ScheduleTable *self, enum ScheduleTableKernel aKernel);
+
+/* -------------------------------------------------------------------------- */
+int
+addScheduleTableEntry(
+    struct ScheduleTable *self, const struct Schedule *aSchedule);
+
+/* -------------------------------------------------------------------------- */
+int
+queryScheduleTable(
+    const struct ScheduleTable *self,
+    const struct CivilTime *aCivilTime,
+    time_t *aScheduled);
+
+ssize_t
+queryScheduleTableEarliest(
+    const struct ScheduleTable *self,
+    const struct CivilTime *aCivilTime,
+    struct ScheduleTableFire *aFires,
+    size_t aCount);
+
+/* -------------------------------------------------------------------------- */
+END_C_SCOPE;
+
+#endif /* SCHEDULETABLE_H */
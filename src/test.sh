@@ -189,6 +189,291 @@ test_stdin()
         } | crontime -j 0 975481140)" ]
 }
 
+test_horizon()
+{
+    local SCHEDULE='1-58 1-22 2-28 2-11 *'
+
+    # Sat Jan  1 00:00:00 PST 2000
+    # Wed Feb  2 01:01:00 PST 2000
+    check [ '949482060 0' = "$(
+        crontime -j 0 -H $((949482060-946713600)) 946713600 "$SCHEDULE")" ]
+
+    check [ '-' = "$(
+        crontime -j 0 -H $((949482060-946713600-60)) 946713600 "$SCHEDULE")" ]
+
+    check [ '-' = "$(
+        crontime -j 0 --horizon 31622400 946713600 '0 0 30 2 *')" ]
+}
+
+test_previous()
+{
+    local SCHEDULE='0,30 1,2 1,2 4,5 *'
+
+    # Sun Apr  2 03:00:00 PDT 2000
+    # Sun Apr  2 03:00:00 PDT 2000
+    check [ '954669600 0' = "$(crontime --previous 954669600 '0 * * * *')" ]
+
+    # Sun Apr  2 03:00:59 PDT 2000
+    # Sun Apr  2 03:00:00 PDT 2000
+    check [ '954669600 0' = "$(crontime -p $((954669600+59)) '0 * * * *')" ]
+
+    # Sun Apr  2 03:29:00 PDT 2000
+    # Sun Apr  2 02:00:00 PDT 2000 Artificial
+    check [ '954669600 0' = "$(crontime -p $((954669600+29*60)) "$SCHEDULE")" ]
+
+    # Sun Apr  2 01:59:00 PST 2000
+    # Sun Apr  2 01:30:00 PST 2000
+    check [ '954667800 0' = "$(crontime -p $((954669600-60)) "$SCHEDULE")" ]
+
+    # Sun Oct 29 01:59:00 PST 2000
+    # Sun Oct 29 01:30:00 PDT 2000 Skipped
+    check [ '972808200 0' = "$(
+        crontime -p $((972813600-60)) '0,30 1,2,3 29 10 *')" ]
+
+    # Sun Oct 29 01:59:00 PST 2000
+    # Sun Oct 29 01:30:00 PST 2000 Not Skipped
+    check [ '972811800 0' = "$(
+        crontime -p $((972813600-60)) '30 * * * *')" ]
+
+    check [ '-' = "$(crontime -p -H 3600 $((954669600-60)) '0 0 * * *')" ]
+}
+
+test_seconds()
+{
+    # Sat Jan  1 00:00:01 PST 2000
+    # Sat Jan  1 00:00:10 PST 2000
+    check [ '946713610 0' = "$(crontime -j 0 946713601 '*/10 * * * * *')" ]
+
+    # Sat Jan  1 00:00:10 PST 2000
+    # Sat Jan  1 00:00:10 PST 2000
+    check [ '946713610 0' = "$(crontime -j 0 946713610 '*/10 * * * * *')" ]
+
+    # Sat Jan  1 00:00:51 PST 2000
+    # Sat Jan  1 00:01:00 PST 2000
+    check [ '946713660 0' = "$(crontime -j 0 946713651 '0 * * * * *')" ]
+
+    # Sat Jan  1 00:00:51 PST 2000
+    # Sat Jan  1 00:00:50 PST 2000
+    check [ '946713650 0' = "$(crontime -p 946713651 '*/10 * * * * *')" ]
+
+    # Sat Jan  1 00:00:05 PST 2000
+    # Fri Dec 31 23:59:30 PST 1999
+    check [ '946713570 0' = "$(crontime -p 946713605 '30 * * * * *')" ]
+}
+
+test_window()
+{
+    # Sat Jan  1 00:07:00 PST 2000 Begin
+    # Sat Jan  1 00:15:00 PST 2000
+    check [ '946714500 0' = "$(
+        crontime -j 0 -b $((946713600+7*60)) 946713600 '*/15 * * * *')" ]
+
+    # Sat Jan  1 00:50:00 PST 2000 End
+    check [ '-' = "$(
+        crontime -j 0 -e $((946713600+50*60)) $((946713600+51*60)) \
+            '*/15 * * * *')" ]
+
+    # Sat Jan  1 00:45:00 PST 2000
+    check [ '946716300 0' = "$(
+        crontime -p -e $((946713600+50*60)) $((946713600+60*60)) \
+            '*/15 * * * *')" ]
+
+    check [ 1 = "$(
+        crontime -b 946713660 -e 946713600 946713600 '* * * * *' \
+            >/dev/null 2>&1 ; say $?)" ]
+
+    # Mon Jan  1 00:00:00 PST 2001
+    check [ '978336000 0' = "$(
+        crontime -j 0 946713600 '0 0 0 1 1 * 2001')" ]
+
+    check [ '-' = "$(crontime -j 0 978336060 '0 0 0 1 1 * 2001')" ]
+}
+
+test_month_days()
+{
+    # Mon Jan 31 00:00:00 PST 2000
+    check [ '949305600 0' = "$(crontime -j 0 946713600 '0 0 L * *')" ]
+
+    # Fri Jan 14 00:00:00 PST 2000
+    check [ '947836800 0' = "$(crontime -j 0 946713600 '0 0 15W * *')" ]
+
+    # Fri Mar 31 00:00:00 PST 2000
+    check [ '954489600 0' = "$(crontime -j 0 951897600 '0 0 LW * *')" ]
+
+    # Fri Jan 21 00:00:00 PST 2000
+    check [ '948441600 0' = "$(crontime -j 0 946713600 '0 0 * * 5#3')" ]
+
+    # Fri Jan 28 00:00:00 PST 2000
+    check [ '949046400 0' = "$(crontime -p 949132800 '0 0 * * 5L')" ]
+
+    check [ 1 = "$(
+        crontime 946713600 '0 0 * * 5#6' >/dev/null 2>&1 ; say $?)" ]
+}
+
+test_hash()
+{
+    # Sat Jan  1 07:56:00 PST 2000
+    check [ '946742160 0' = "$(
+        crontime -j 0 -k backup 946713600 'H H * * *')" ]
+
+    # Sat Jan  1 00:11:00 PST 2000
+    check [ '946714260 0' = "$(
+        crontime -j 0 -k backup 946713600 'H/15 * * * *')" ]
+
+    check [ 1 = "$(
+        crontime 946713600 'H * * * *' >/dev/null 2>&1 ; say $?)" ]
+
+    # Jobs in a crontab are keyed by name
+    check [ "$(printf '946742160\tbackup\thourly')" = "$(
+        printf '%s\n' 'H H * * * backup' '56 * * * * hourly' |
+        crontime --horizon 86400 collisions 946713600)" ]
+}
+
+test_exclude()
+{
+    local CALENDAR
+
+    CALENDAR=$(
+        say '# Winter holidays'
+        say ''
+        say '2000-12-25..2001-01-01'
+        say '2001-01-02'
+    )
+
+    # Fri Dec 22 09:00:00 PST 2000
+    check [ '977504400 0' = "$(
+        crontime -j 0 -x <(say "$CALENDAR") 977472000 '0 9 * * 1-5')" ]
+
+    # Wed Jan  3 09:00:00 PST 2001
+    check [ '978541200 0' = "$(
+        crontime -j 0 -x <(say "$CALENDAR") 977504460 '0 9 * * 1-5')" ]
+
+    # Sun Dec 24 09:00:00 PST 2000
+    check [ '977677200 0' = "$(
+        crontime -p -x <(say "$CALENDAR") 978422400 '0 9 * * *')" ]
+
+    check [ 1 = "$(
+        crontime -x <(say '2001-02-29') 977472000 '* * * * *' \
+            >/dev/null 2>&1 ; say $?)" ]
+}
+
+test_emit_c()
+{
+    local CRONTAB
+
+    CRONTAB=$(
+        say '# Comment'
+        say ''
+        say '*/15  *  * * *  poll'
+        say '30 2 * * * backup'
+    )
+
+    # The jobs are sorted by name, and refer to their schedules.
+    check [ "$(
+        say '    { "backup", &Schedule_0 },'
+        say '    { "poll", &Schedule_1 },'
+    )" = "$(say "$CRONTAB" | crontime --emit-c | grep '&Schedule_')" ]
+
+    check [ '        [ScheduleMinutes] = { UINT64_C(0x200040008001), 0, 59 },' = \
+        "$(say "$CRONTAB" | crontime --emit-c | grep -A2 '^static.*_1 ' |
+            grep ScheduleMinutes)" ]
+
+    check [ 'const size_t ScheduleJobsLength = 2;' = \
+        "$(say "$CRONTAB" | crontime --emit-c | grep ScheduleJobsLength)" ]
+
+    check [ 'const size_t ScheduleJobsLength = 2;' = \
+        "$(crontime --emit-c -c <(say "$CRONTAB") </dev/null |
+            grep ScheduleJobsLength)" ]
+
+    check [ 1 = "$(
+        crontime --emit-c -c <(say "$CRONTAB") <(say "$CRONTAB") \
+            >/dev/null 2>&1 ; say $?)" ]
+
+    # Duplicate job names, and jobs without names, are rejected.
+    check [ 1 = "$(
+        {
+            say '* * * * * a'
+            say '0 * * * * a'
+        } | crontime --emit-c >/dev/null 2>&1 ; say $?)" ]
+
+    check [ 1 = "$(
+        say '* * * * *' | crontime --emit-c >/dev/null 2>&1 ; say $?)" ]
+
+    # Emitted schedules cannot be bounded, nor exclude dates.
+    check [ 1 = "$(
+        say "$CRONTAB" |
+        crontime -b 946713600 --emit-c >/dev/null 2>&1 ; say $?)" ]
+
+    check [ 1 = "$(
+        say "$CRONTAB" |
+        crontime -x <(say '2000-01-01') --emit-c >/dev/null 2>&1 ; say $?)" ]
+}
+
+test_collisions()
+{
+    local CRONTAB
+
+    CRONTAB=$(
+        say '30 1 * * * a'
+        say '30 * * * * b'
+        say '0  * * * * c'
+        say '0  2 * * * d'
+    )
+
+    # Sat Oct 28 22:00:00 PDT 2000
+    # Sun Oct 29 01:30:00 PDT 2000
+    # Sun Oct 29 02:00:00 PST 2000
+    check [ "$(
+        say "972808200	a	b"
+        say "972813600	c	d"
+    )" = "$(say "$CRONTAB" | crontime -H 21600 collisions 972795600)" ]
+
+    check [ "$(
+        say "972808200	a	b"
+    )" = "$(crontime -H 14400 --crontab <(say "$CRONTAB") collisions 972795600)" ]
+
+    # Jobs that select days by the month days collide regardless
+    # of the order of the jobs in the crontab.
+    #
+    # Fri Mar 17 00:00:00 PST 2000
+
+    check [ "953280000	a	b" = "$(
+        {
+            say '0 0 15 * 5#3 a'
+            say '0 0 17 * *   b'
+        } | crontime -H 31622400 collisions 946713600)" ]
+
+    check [ "953280000	a	b" = "$(
+        {
+            say '0 0 17 * *   b'
+            say '0 0 15 * 5#3 a'
+        } | crontime -H 31622400 collisions 946713600)" ]
+
+    # The validity window and excluded dates apply to every job.
+    #
+    # Sat Jan  1 00:00:00 PST 2000
+
+    CRONTAB=$(
+        say '0 0 1 1 * a'
+        say '0 0 * * 6 b'
+    )
+
+    check [ "946713600	a	b" = "$(
+        say "$CRONTAB" | crontime -H 31622400 collisions 946713600)" ]
+
+    check [ -z "$(
+        say "$CRONTAB" |
+        crontime -H 31622400 -x <(say '2000-01-01') collisions 946713600)" ]
+
+    check [ -z "$(
+        say "$CRONTAB" |
+        crontime -H 31622400 -b 946713660 collisions 946713600)" ]
+
+    # Collisions are only sought within a horizon.
+    check [ 1 = "$(
+        say "$CRONTAB" | crontime collisions 972795600 >/dev/null 2>&1 ; say $?)" ]
+}
+
 test_jitter()
 {
     local SCHEDULE='* * * * *'
@@ -226,6 +511,15 @@ main()
     test_spring_dst
     test_fall_dst
     test_jitter
+    test_horizon
+    test_previous
+    test_seconds
+    test_window
+    test_month_days
+    test_hash
+    test_exclude
+    test_emit_c
+    test_collisions
 
     test_stdin
 }
@@ -0,0 +1,229 @@
+/* -*- c-basic-offset:4; indent-tabs-mode:nil -*- vi: set sw=4 et: */
+/*
+// Copyright (c) 2021, Earl Chew
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the names of the authors of source code nor the names
+//       of the contributors to the source code may be used to endorse or
+//       promote products derived from this software without specific
+//       prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL EARL CHEW BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "widebitring.h"
+
+#include "macros.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+
+/* -------------------------------------------------------------------------- */
+enum {
+    WideBitRingWordBits = sizeof(BitRingT) * CHAR_BIT,
+};
+
+/* -------------------------------------------------------------------------- */
+static int
+addWideBitRingMember_(void *self, int aMember)
+{
+    return addWideBitRingMember(self, aMember);
+}
+
+/* -------------------------------------------------------------------------- */
+struct WideBitRing *
+initWideBitRing(
+    struct WideBitRing *self, int aMin, int aMax, const char *aMembership)
+{
+    int rc = -1;
+
+    self->mRing = 0;
+    self->mWords = 0;
+    self->mMin = aMin;
+    self->mMax = aMax;
+
+    if (aMax < aMin) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    unsigned long long members = (long long) aMax - aMin + 1;
+
+    self->mWords = (members + WideBitRingWordBits - 1) / WideBitRingWordBits;
+
+    self->mRing = calloc(self->mWords, sizeof(*self->mRing));
+    if (!self->mRing)
+        goto Finally;
+
+    if (aMembership) {
+        if (parseBitRingMembership(
+                aMembership, aMin, aMax, addWideBitRingMember_, self))
+            goto Finally;
+    }
+
+    rc = 0;
+
+Finally:
+
+    FINALLY({
+        if (rc) {
+            free(self->mRing);
+            self->mRing = 0;
+        }
+    });
+
+    return rc ? 0 : self;
+}
+
+/* -------------------------------------------------------------------------- */
+void
+closeWideBitRing(struct WideBitRing *self)
+{
+    free(self->mRing);
+    self->mRing = 0;
+    self->mWords = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+addWideBitRingMember(struct WideBitRing *self, int aMember)
+{
+    int rc = -1;
+
+    if (aMember < self->mMin || aMember > self->mMax) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    unsigned offset = aMember - self->mMin;
+
+    self->mRing[offset / WideBitRingWordBits] |=
+        (BitRingT) 1 << (offset % WideBitRingWordBits);
+
+    rc = 0;
+
+Finally:
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+queryWideBitRingMin(const struct WideBitRing *self)
+{
+    return self->mMin;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+queryWideBitRingMax(const struct WideBitRing *self)
+{
+    return self->mMax;
+}
+
+/* -------------------------------------------------------------------------- */
+unsigned
+queryWideBitRingPopulation(const struct WideBitRing *self)
+{
+    unsigned population = 0;
+
+    for (unsigned wx = 0; wx < self->mWords; ++wx)
+        population += __builtin_popcountll(self->mRing[wx]);
+
+    return population;
+}
+
+/* -------------------------------------------------------------------------- */
+int
+queryWideBitRingMembership(const struct WideBitRing *self, int aMember)
+{
+    int rc;
+
+    if (aMember < self->mMin || aMember > self->mMax) {
+        rc = 0;
+    } else {
+        unsigned offset = aMember - self->mMin;
+
+        rc = !! (self->mRing[offset / WideBitRingWordBits] &
+                 ((BitRingT) 1 << (offset % WideBitRingWordBits)));
+    }
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+static int
+queryWideBitRingNext_(const struct WideBitRing *self, unsigned aOffset)
+{
+    /* Find the offset of the first member at or after the specified
+     * offset, scanning a whole word of members at each step, or return
+     * -1 if there is none.
+     */
+
+    unsigned wx = aOffset / WideBitRingWordBits;
+
+    if (wx >= self->mWords)
+        return -1;
+
+    BitRingT word =
+        self->mRing[wx] & (~(BitRingT) 0 << (aOffset % WideBitRingWordBits));
+
+    while (!word) {
+        if (++wx == self->mWords)
+            return -1;
+        word = self->mRing[wx];
+    }
+
+    return wx * WideBitRingWordBits + __builtin_ctzll(word);
+}
+
+int
+queryWideBitRingMemberSeparation(const struct WideBitRing *self, int aMember)
+{
+    int rc = -1;
+
+    if (aMember < self->mMin || aMember > self->mMax) {
+        errno = EINVAL;
+        goto Finally;
+    }
+
+    unsigned offset = aMember - self->mMin;
+
+    int nextMember = queryWideBitRingNext_(self, offset + 1);
+
+    int separation;
+
+    if (-1 != nextMember) {
+        separation = nextMember - offset;
+    } else {
+        int firstMember = queryWideBitRingNext_(self, 0);
+
+        if (-1 != firstMember)
+            separation = firstMember + (self->mMax - aMember + 1);
+        else
+            separation = 0;
+    }
+
+    rc = 0;
+
+Finally:
+
+    return rc ? rc : separation;
+}